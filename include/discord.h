@@ -102,16 +102,66 @@ extern "C" {
 
 typedef struct discord *discord_handle_t;
 
+/**
+ * @brief Reconnect policy. Reconnection after op 7 (Reconnect) or after close codes which ask for it
+ *        happens immediately, while network errors use exponential backoff with jitter.
+ *        Authentication failure and invalid shard/intents close codes stop the client permanently
+ */
+typedef struct
+{
+    uint32_t min_delay_ms; /*<! Initial delay of exponential backoff. Doubles with every consecutive failed attempt */
+    uint32_t max_delay_ms; /*<! Upper limit of backoff delay */
+    uint16_t max_attempts; /*<! Give up after this many consecutive failed attempts. 0 means never give up */
+} discord_reconnect_config_t;
+
+/**
+ * @brief Shards run by one client. Each shard has its own gateway connection, heartbeat and sequence number,
+ *        while events of all shards go through the same queue and event loop.
+ *        Bigger bots can split shards across multiple clients (or devices) using first and total
+ */
+typedef struct
+{
+    uint16_t first; /*<! Id of the first shard run by this client */
+    uint16_t count; /*<! Number of shards run by this client, with consecutive ids. Default: 1 */
+    uint16_t total; /*<! Total number of shards of the bot. Default: first + count */
+} discord_shard_config_t;
+
+/**
+ * @brief What to do with received event when the event queue is full.
+ *        Gateway control messages (and READY/RESUMED) are never dropped in favour of events, they always wait
+ */
+typedef enum
+{
+    DISCORD_QUEUE_POLICY_BLOCK,       /*<! Wait up to 5 seconds for free space, then drop the event. Stalls reading */
+    DISCORD_QUEUE_POLICY_DROP_NEWEST, /*<! Drop the received event immediately */
+    DISCORD_QUEUE_POLICY_DROP_OLDEST, /*<! Drop the oldest queued event to make room */
+    DISCORD_QUEUE_POLICY_COALESCE,    /*<! Drop queued update of the same object (MESSAGE_UPDATED of the same message,
+                                           VOICE_STATE_UPDATED of the same user) or the oldest queued event otherwise */
+} discord_queue_policy_t;
+
 typedef struct
 {
     char *token;
     int intents;
     size_t gateway_buffer_size;
-    size_t api_buffer_size;
+    size_t api_buffer_size; /*<! Holds whole response, except for lists which only need to fit their largest element */
     size_t api_timeout_ms;
+    uint8_t api_connections; /*<! Keep-alive connections for REST requests in parallel, each with its own buffer
+                                  of api_buffer_size and its own worker task for asynchronous requests. Default: 1 */
     uint8_t queue_size;
+    discord_queue_policy_t queue_policy; /*<! Default: DISCORD_QUEUE_POLICY_BLOCK */
     size_t task_stack_size;
     uint8_t task_priority;
+    bool gateway_compression; /*<! Enable zlib-stream compression of gateway traffic. Requires ~43 KB of RAM */
+    bool gateway_zero_copy;   /*<! Decode gateway events in place, without copying strings out of the receive buffer.
+                                   Each queued message and event keeps its own receive buffer
+                                   (up to queue_size + shards.count + 6 buffers) */
+    discord_reconnect_config_t reconnect;
+    discord_shard_config_t shards;
+    bool session_persist;     /*<! Checkpoint gateway session to NVS and try to RESUME it on the next login, even after
+                                   reboot, OTA or deep sleep. Requires nvs_flash_init() and wall clock
+                                   synchronized (e.g. by SNTP) before login, otherwise the checkpoint is not resumed */
+    uint32_t session_max_age; /*<! Seconds. Older checkpoint is not resumed. Default: 300 */
 } discord_config_t;
 
 typedef enum
@@ -151,8 +201,107 @@ typedef enum
                                             specify an intent that you have not enabled or are not whitelisted for. */
 } discord_close_code_t;
 
+#define DISCORD_GATEWAY_LATENCY_BUCKETS (7)
+
+/**
+ * @brief Heartbeat round-trip time statistics. Kept across reconnections and collected from all shards
+ */
+typedef struct
+{
+    uint32_t samples; /*!< Number of acknowledged heartbeats */
+    uint32_t last_ms; /*!< RTT of the latest acknowledged heartbeat */
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t avg_ms;
+    uint32_t ewma_ms; /*!< Exponentially weighted moving average (alpha = 1/8), reacts faster than avg_ms */
+    uint32_t histogram[DISCORD_GATEWAY_LATENCY_BUCKETS]; /*!< RTT below 50, 100, 200, 400, 800, 1600 ms and the rest */
+} discord_gateway_latency_t;
+
+/**
+ * @brief Events lost because the event queue was full. Kept across reconnections
+ */
+typedef struct
+{
+    uint32_t dropped_newest; /*!< Received events dropped because there was no room for them */
+    uint32_t dropped_oldest; /*!< Queued events dropped to make room for newer ones */
+    uint32_t coalesced;      /*!< Queued updates dropped because newer update of the same object has been received */
+} discord_queue_stats_t;
+
 ESP_EVENT_DECLARE_BASE(DISCORD_EVENTS);
 
+/**
+ * @brief Dispatch events known by their gateway names, DISCORD_EVENT_<NAME>. They can be subscribed to like any other
+ *        event. Guild (GUILD_CREATE/UPDATE/DELETE) and channel (CHANNEL_CREATE/UPDATE/DELETE) events carry
+ *        discord_guild_t and discord_channel_t, the others have no model yet and are fired with NULL data
+ */
+#define DISCORD_EVENT_CATALOGUE(X)                                                                                     \
+    X(APPLICATION_COMMAND_PERMISSIONS_UPDATE)                                                                          \
+    X(AUTO_MODERATION_RULE_CREATE)                                                                                     \
+    X(AUTO_MODERATION_RULE_UPDATE)                                                                                     \
+    X(AUTO_MODERATION_RULE_DELETE)                                                                                     \
+    X(AUTO_MODERATION_ACTION_EXECUTION)                                                                                \
+    X(CHANNEL_CREATE)                                                                                                  \
+    X(CHANNEL_UPDATE)                                                                                                  \
+    X(CHANNEL_DELETE)                                                                                                  \
+    X(CHANNEL_PINS_UPDATE)                                                                                             \
+    X(THREAD_CREATE)                                                                                                   \
+    X(THREAD_UPDATE)                                                                                                   \
+    X(THREAD_DELETE)                                                                                                   \
+    X(THREAD_LIST_SYNC)                                                                                                \
+    X(THREAD_MEMBER_UPDATE)                                                                                            \
+    X(THREAD_MEMBERS_UPDATE)                                                                                           \
+    X(ENTITLEMENT_CREATE)                                                                                              \
+    X(ENTITLEMENT_UPDATE)                                                                                              \
+    X(ENTITLEMENT_DELETE)                                                                                              \
+    X(GUILD_CREATE)                                                                                                    \
+    X(GUILD_UPDATE)                                                                                                    \
+    X(GUILD_DELETE)                                                                                                    \
+    X(GUILD_AUDIT_LOG_ENTRY_CREATE)                                                                                    \
+    X(GUILD_BAN_ADD)                                                                                                   \
+    X(GUILD_BAN_REMOVE)                                                                                                \
+    X(GUILD_EMOJIS_UPDATE)                                                                                             \
+    X(GUILD_STICKERS_UPDATE)                                                                                           \
+    X(GUILD_INTEGRATIONS_UPDATE)                                                                                       \
+    X(GUILD_MEMBER_ADD)                                                                                                \
+    X(GUILD_MEMBER_REMOVE)                                                                                             \
+    X(GUILD_MEMBER_UPDATE)                                                                                             \
+    X(GUILD_ROLE_CREATE)                                                                                               \
+    X(GUILD_ROLE_UPDATE)                                                                                               \
+    X(GUILD_ROLE_DELETE)                                                                                               \
+    X(GUILD_SCHEDULED_EVENT_CREATE)                                                                                    \
+    X(GUILD_SCHEDULED_EVENT_UPDATE)                                                                                    \
+    X(GUILD_SCHEDULED_EVENT_DELETE)                                                                                    \
+    X(GUILD_SCHEDULED_EVENT_USER_ADD)                                                                                  \
+    X(GUILD_SCHEDULED_EVENT_USER_REMOVE)                                                                               \
+    X(GUILD_SOUNDBOARD_SOUND_CREATE)                                                                                   \
+    X(GUILD_SOUNDBOARD_SOUND_UPDATE)                                                                                   \
+    X(GUILD_SOUNDBOARD_SOUND_DELETE)                                                                                   \
+    X(GUILD_SOUNDBOARD_SOUNDS_UPDATE)                                                                                  \
+    X(SOUNDBOARD_SOUNDS)                                                                                               \
+    X(INTEGRATION_CREATE)                                                                                              \
+    X(INTEGRATION_UPDATE)                                                                                              \
+    X(INTEGRATION_DELETE)                                                                                              \
+    X(INTERACTION_CREATE)                                                                                              \
+    X(INVITE_CREATE)                                                                                                   \
+    X(INVITE_DELETE)                                                                                                   \
+    X(MESSAGE_DELETE_BULK)                                                                                             \
+    X(MESSAGE_REACTION_REMOVE_ALL)                                                                                     \
+    X(MESSAGE_REACTION_REMOVE_EMOJI)                                                                                   \
+    X(MESSAGE_POLL_VOTE_ADD)                                                                                           \
+    X(MESSAGE_POLL_VOTE_REMOVE)                                                                                        \
+    X(PRESENCE_UPDATE)                                                                                                 \
+    X(STAGE_INSTANCE_CREATE)                                                                                           \
+    X(STAGE_INSTANCE_UPDATE)                                                                                           \
+    X(STAGE_INSTANCE_DELETE)                                                                                           \
+    X(SUBSCRIPTION_CREATE)                                                                                             \
+    X(SUBSCRIPTION_UPDATE)                                                                                             \
+    X(SUBSCRIPTION_DELETE)                                                                                             \
+    X(TYPING_START)                                                                                                    \
+    X(USER_UPDATE)                                                                                                     \
+    X(VOICE_CHANNEL_EFFECT_SEND)                                                                                       \
+    X(VOICE_SERVER_UPDATE)                                                                                             \
+    X(WEBHOOKS_UPDATE)
+
 typedef enum
 {
     DISCORD_EVENT_ANY = ESP_EVENT_ANY_ID,
@@ -169,6 +318,13 @@ typedef enum
     DISCORD_EVENT_MESSAGE_REACTION_ADDED,   /*<! Reaction added to message */
     DISCORD_EVENT_MESSAGE_REACTION_REMOVED, /*<! Reaction removed from message */
     DISCORD_EVENT_VOICE_STATE_UPDATED,      /*<! Voice state updated */
+    DISCORD_EVENT_RESUMED,                  /*<! This event will never be fired. Use CONNECTED instead */
+    DISCORD_EVENT_GUILD_MEMBERS_CHUNK,      /*<! Chunk of members requested with discord_member_request has been
+                                               received. Members themselves are delivered to the request handler */
+#define _DISCORD_EVENT_ENUM(name) DISCORD_EVENT_##name,
+    DISCORD_EVENT_CATALOGUE(_DISCORD_EVENT_ENUM)
+#undef _DISCORD_EVENT_ENUM
+    DISCORD_EVENT_MAX, /*<! Number of events. Not an event */
 } discord_event_t;
 
 typedef void *discord_event_data_ptr_t;
@@ -176,6 +332,7 @@ typedef void *discord_event_data_ptr_t;
 typedef struct
 {
     discord_handle_t client;
+    uint16_t shard_id; /*<! Shard which received the event. DISCONNECTED event carries the first shard of the client */
     discord_event_data_ptr_t ptr;
 } discord_event_data_t;
 
@@ -189,6 +346,15 @@ typedef struct
 
 typedef esp_err_t (*discord_download_handler_t)(discord_download_info_t *info, void *arg);
 
+/**
+ * @brief Completion of asynchronous request. Called from the REST worker task,
+ *        so discord_logout and discord_destroy fail with ESP_FAIL there
+ * @param err ESP_OK if request succeeded, ESP_ERR_INVALID_RESPONSE if Discord rejected it, or other error
+ * @param result Object returned by Discord (e.g. sent message) or NULL. It is owned by the callback
+ *        and must be freed with the matching free function
+ */
+typedef void (*discord_request_callback_t)(discord_handle_t client, esp_err_t err, void *result, void *arg);
+
 discord_handle_t discord_create(const discord_config_t *config);
 /**
  * @brief Cannot be called from event handler
@@ -197,14 +363,29 @@ esp_err_t discord_login(discord_handle_t client);
 esp_err_t discord_register_events(
     discord_handle_t client, discord_event_t event, esp_event_handler_t event_handler, void *event_handler_arg);
 esp_err_t discord_unregister_events(discord_handle_t client, discord_event_t event, esp_event_handler_t event_handler);
+/**
+ * @brief Get gateway state. With multiple shards, state of the shard furthest from CONNECTED is reported
+ */
 esp_err_t discord_get_state(discord_handle_t client, discord_gateway_state_t *out_state);
+/**
+ * @brief Get close code of the last closed connection (of any shard)
+ */
 esp_err_t discord_get_close_code(discord_handle_t client, discord_close_code_t *out_code);
 /**
- * @brief Cannot be called from event handler
+ * @brief Get heartbeat round-trip time statistics
+ * @return ESP_ERR_NOT_FOUND if no heartbeat has been acknowledged yet (out_latency is filled anyway)
+ */
+esp_err_t discord_get_gateway_latency(discord_handle_t client, discord_gateway_latency_t *out_latency);
+/**
+ * @brief Get counters of events lost because of the queue policy
+ */
+esp_err_t discord_get_queue_stats(discord_handle_t client, discord_queue_stats_t *out_stats);
+/**
+ * @brief Cannot be called from event handler or from completion of asynchronous request
  */
 esp_err_t discord_logout(discord_handle_t client);
 /**
- * @brief Cannot be called from event handler
+ * @brief Cannot be called from event handler or from completion of asynchronous request
  */
 esp_err_t discord_destroy(discord_handle_t client);
 
@@ -7,21 +7,64 @@ extern "C" {
 
 #include "discord.h"
 #include "discord/role.h"
+#include "discord/user.h"
 
 typedef struct
 {
+    discord_user_t *user; /*!< Not included in members of MESSAGE_CREATE and MESSAGE_UPDATE events */
     char *nick;
     char *permissions;
     char **roles;
     discord_role_len_t _roles_len;
 } discord_member_t;
 
+typedef struct
+{
+    char *guild_id;
+    char **user_ids;      /*!< Fetch members with these ids. If set, query is ignored. Limit: 100 */
+    uint8_t _user_ids_len;
+    char *query;          /*!< Fetch members whose username starts with the query. Empty string means all members */
+    int limit;            /*!< Maximum number of members to fetch for the query. 0 means no limit */
+} discord_member_request_t;
+
+typedef struct
+{
+    char *guild_id;
+    char *nonce;
+    int chunk_index;
+    int chunk_count;
+} discord_member_chunk_t;
+
+/**
+ * @brief Receives members of discord_member_request one by one, as they are decoded.
+ *        Member and everything it points to is freed once the handler returns.
+ *        Handler is called from the gateway decoder task. It should return quickly, other events wait meanwhile.
+ *        After all chunks are received, handler is called once more with NULL member, from the discord task
+ */
+typedef void (*discord_member_handler_t)(discord_handle_t client, discord_member_t *member, void *arg);
+
 esp_err_t discord_member_get(discord_handle_t client, char *guild_id, char *user_id, discord_member_t **out_member);
+/**
+ * @brief Same as discord_member_get, but queued like discord_message_send_async.
+ *        Callback receives discord_member_t (free with discord_member_free)
+ */
+esp_err_t discord_member_get_async(discord_handle_t client, const char *guild_id, const char *user_id,
+    discord_request_callback_t callback, void *arg);
 esp_err_t discord_member_has_permissions(
     discord_handle_t client, discord_member_t *member, char *guild_id, uint64_t permissions, bool *out_result);
 esp_err_t discord_member_has_role_name(
     discord_handle_t client, discord_member_t *member, const char *guild_id, const char *role_name, bool *out_result);
+/**
+ * @brief Request guild members over the gateway (Request Guild Members, op 8). Function never blocks.
+ *        Members are streamed to the handler one at a time and never held in the memory all together.
+ *        Only one request can be in progress at a time.
+ *        Fetching all members (empty query with no limit) requires GUILD_MEMBERS privileged intent
+ * @return ESP_ERR_INVALID_STATE if previous request is still in progress
+ */
+esp_err_t discord_member_request(
+    discord_handle_t client, discord_member_request_t *request, discord_member_handler_t handler, void *arg);
 void discord_member_free(discord_member_t *member);
+void discord_member_chunk_free(discord_member_chunk_t *chunk);
 
 #ifdef __cplusplus
 }
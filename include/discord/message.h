@@ -90,6 +90,21 @@ typedef struct
 
 esp_err_t discord_message_send(discord_handle_t client, discord_message_t *message, discord_message_t **out_result);
 esp_err_t discord_message_react(discord_handle_t client, discord_message_t *message, const char *emoji);
+/**
+ * @brief Send message without waiting for Discord. Request is queued for the REST worker task and function returns
+ *        immediately, so it is safe to call from event handler. Message can be freed after the call.
+ *        Attachment data owned by the message is moved into the queued request (attachment _data becomes NULL),
+ *        data not owned by it is copied. If request is not queued, message keeps its data
+ * @param callback Receives sent message (discord_message_t, free with discord_message_free). Can be NULL
+ * @return ESP_OK if request is queued. Callback is called only in that case
+ */
+esp_err_t discord_message_send_async(
+    discord_handle_t client, discord_message_t *message, discord_request_callback_t callback, void *arg);
+/**
+ * @brief Same as discord_message_react, but queued like discord_message_send_async. Callback result is always NULL
+ */
+esp_err_t discord_message_react_async(discord_handle_t client, discord_message_t *message, const char *emoji,
+    discord_request_callback_t callback, void *arg);
 esp_err_t discord_message_download_attachment(discord_handle_t client, discord_message_t *message,
     uint8_t attachment_index, discord_download_handler_t download_handler, void *arg);
 esp_err_t discord_message_word_parse(const char *word, discord_message_word_t **out_word);
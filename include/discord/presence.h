@@ -0,0 +1,56 @@
+#ifndef _DISCORD_PRESENCE_H_
+#define _DISCORD_PRESENCE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "discord.h"
+
+typedef enum
+{
+    DISCORD_PRESENCE_ONLINE,
+    DISCORD_PRESENCE_DND, /*!< Do Not Disturb */
+    DISCORD_PRESENCE_IDLE,
+    DISCORD_PRESENCE_INVISIBLE, /*!< Shown as offline */
+    DISCORD_PRESENCE_OFFLINE,
+} discord_presence_status_t;
+
+typedef enum
+{
+    DISCORD_ACTIVITY_GAME,      /*!< Playing {name} */
+    DISCORD_ACTIVITY_STREAMING, /*!< Streaming {details} */
+    DISCORD_ACTIVITY_LISTENING, /*!< Listening to {name} */
+    DISCORD_ACTIVITY_WATCHING,  /*!< Watching {name} */
+    DISCORD_ACTIVITY_CUSTOM,    /*!< {emoji} {state} */
+    DISCORD_ACTIVITY_COMPETING, /*!< Competing in {name} */
+} discord_activity_type_t;
+
+typedef struct
+{
+    char *name; /*!< Activity name. Ignored by Discord for custom status, but it still has to be set */
+    discord_activity_type_t type;
+    char *state; /*!< Custom status text (e.g. "sensor: 23.4°C"), or additional info for other types */
+    char *url;   /*!< Stream url, only for DISCORD_ACTIVITY_STREAMING */
+} discord_activity_t;
+
+typedef struct
+{
+    discord_presence_status_t status;
+    discord_activity_t *activity; /*!< NULL to clear activity */
+    bool afk;
+} discord_presence_t;
+
+/**
+ * @brief Update presence of the bot. Function never blocks, presence is serialized and sent by the discord task.
+ *        Presence updates are rate limited, so if another update arrives before the previous one is sent,
+ *        the previous one is dropped and only the latest goes out
+ * @param presence Presence to set. It is not used after the function returns
+ */
+esp_err_t discord_presence_update(discord_handle_t client, discord_presence_t *presence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
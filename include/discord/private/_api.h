@@ -7,6 +7,8 @@ extern "C" {
 
 #include "esp_http_client.h"
 #include "discord.h"
+#include "_ratelimit.h"
+#include "_json_splitter.h"
 
 #define DCAPI_REQUEST_BOUNDARY "esp-discord"
 
@@ -33,6 +35,17 @@ typedef struct
     bool data_should_be_freed; /*<! Set to true if data should be freed by discord_api_multipart_free function */
 } discord_api_multipart_t;
 
+/**
+ * @brief Decode response of asynchronous request into the object passed to the request callback,
+ *        or decode single element of list response
+ */
+typedef void *(*dcapi_result_parser_t)(const char *data, int data_len);
+
+/**
+ * @brief Free object decoded by dcapi_result_parser_t
+ */
+typedef void (*dcapi_result_free_t)(void *result);
+
 typedef struct
 {
     char *uri;
@@ -40,15 +53,53 @@ typedef struct
     uint8_t multiparts_len;
     bool disable_auto_uri_free;
     bool disable_auto_payload_free;
+    bool async;                        /*<! Sent by api worker, which can wait for rate limits longer */
+    dcapi_result_parser_t list_parser; /*<! Decode successful response as JSON array, element by element */
+    dcapi_result_free_t list_free;     /*<! Free element decoded by list_parser */
 } discord_api_request_t;
 
+/**
+ * @brief Keep-alive connection of the pool. Connection is busy from the start of the request
+ *        until its response, which points to the connection buffer, is freed
+ */
+typedef struct dcapi_connection
+{
+    discord_handle_t client;
+    esp_http_client_handle_t http;
+    bool busy;
+    char *buffer;
+    int buffer_size;
+    bool buffer_record;
+    esp_err_t buffer_record_status;
+    discord_ratelimit_headers_t ratelimit_headers; /*<! Headers of the response being received */
+    discord_json_splitter_handle_t splitter;       /*<! List request only. Recorded chunks go through it */
+    bool download_mode;
+    char *host; /*<! Download connection only. Scheme and host the connection is open to */
+    discord_download_handler_t download_handler;
+    void *download_arg;
+    size_t download_total;
+    size_t download_offset;
+} dcapi_connection_t;
+
 typedef struct
 {
     int code;
     char *data;
     int data_len;
+    dcapi_connection_t *connection; /*<! Connection which holds data. NULL if response has no data */
+    void **list;                    /*<! List request only. Decoded elements, owned by the caller */
+    int list_len;
 } discord_api_response_t;
 
+typedef struct
+{
+    esp_http_client_method_t method;
+    discord_api_request_t *request; /*<! NULL stops the worker */
+    dcapi_result_parser_t parser;
+    discord_request_callback_t callback;
+    void *arg;
+} dcapi_job_t;
+
 bool dcapi_response_is_success(discord_api_response_t *res);
 esp_err_t dcapi_response_to_esp_err(discord_api_response_t *res);
 esp_err_t dcapi_response_free(discord_handle_t client, discord_api_response_t *res);
@@ -81,7 +132,48 @@ esp_err_t dcapi_post(discord_handle_t client, char *uri, char *data, discord_api
  * @note data will be automatically freed
  */
 esp_err_t dcapi_put(discord_handle_t client, char *uri, char *data, discord_api_response_t **out_response);
+/**
+ * @brief GET request of JSON array. Response chunks are decoded element by element as they arrive,
+ *        so the whole response is never buffered. Only a single element must fit into api_buffer_size,
+ *        otherwise request fails with ESP_ERR_INVALID_SIZE. Partial list is never returned
+ *
+ * @param out_list Decoded elements, NULL if array is empty. Set, together with out_length, only on ESP_OK
+ * @return ESP_ERR_INVALID_RESPONSE if response is not successful
+ * @note uri will be automatically freed
+ */
+esp_err_t dcapi_get_list(discord_handle_t client, char *uri, dcapi_result_parser_t parser, dcapi_result_free_t free_fnc,
+    void ***out_list, int *out_length);
 
+/**
+ * @brief Queue request for the api worker task and return immediately. Request is freed once it is done
+ * @param parser Decodes successful response into the result of the callback. Can be NULL
+ * @param callback Called from the worker task once request is done. Can be NULL
+ * @return ESP_OK if request is queued. Callback is not called otherwise, but request is freed anyway
+ */
+esp_err_t dcapi_request_async(discord_handle_t client, esp_http_client_method_t method, discord_api_request_t *request,
+    dcapi_result_parser_t parser, discord_request_callback_t callback, void *arg);
+/**
+ * @brief Same as dcapi_request_async, but request stays with the caller if it is not queued,
+ *        so the caller can take back what it has moved into the request
+ */
+esp_err_t dcapi_request_async_keep(discord_handle_t client, esp_http_client_method_t method,
+    discord_api_request_t *request, dcapi_result_parser_t parser, discord_request_callback_t callback, void *arg);
+/**
+ * @brief Create connection pool (connections themselves open lazily) and start worker tasks
+ */
+esp_err_t dcapi_init(discord_handle_t client);
+/**
+ * @brief Close idle connections of the pool and the idle download connection. Busy ones are left open,
+ *        so it never waits for requests in progress. Pool stays usable
+ */
+esp_err_t dcapi_close(discord_handle_t client);
+/**
+ * @brief Check if the calling task is one of the workers (e.g. completion callback runs on it)
+ */
+bool dcapi_is_worker(discord_handle_t client);
+/**
+ * @brief Stop worker tasks and free the pool. Queued requests are not sent, their callbacks get ESP_ERR_INVALID_STATE
+ */
 esp_err_t dcapi_destroy(discord_handle_t client);
 
 #ifdef __cplusplus
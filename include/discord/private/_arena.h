@@ -0,0 +1,79 @@
+#ifndef _DISCORD_PRIVATE_ARENA_H_
+#define _DISCORD_PRIVATE_ARENA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include "esp_err.h"
+
+/**
+ * @brief Bump allocator. Everything allocated from the arena is released at once with discord_arena_release.
+ *        If arena is full, additional blocks are allocated from heap and freed on release
+ */
+typedef struct discord_arena *discord_arena_handle_t;
+
+/**
+ * @brief Pool of reusable arenas
+ */
+typedef struct discord_arena_pool *discord_arena_pool_handle_t;
+
+/**
+ * @brief Create pool of arenas. Arenas are created on demand (up to capacity) and reused after release
+ * @param capacity Maximum number of arenas in use at the same time
+ * @param arena_size Size of the main block of each arena
+ * @return Handle or NULL if there is no memory
+ */
+discord_arena_pool_handle_t discord_arena_pool_create(size_t capacity, size_t arena_size);
+
+/**
+ * @brief Take an arena from the pool. Never blocks
+ * @return Arena or NULL if all arenas are in use (caller should fall back to the heap)
+ */
+discord_arena_handle_t discord_arena_pool_acquire(discord_arena_pool_handle_t pool);
+
+/**
+ * @brief Free the pool and all idle arenas. All arenas must be released before calling this function
+ */
+void discord_arena_pool_free(discord_arena_pool_handle_t pool);
+
+/**
+ * @brief Allocate zero-initialized memory from the arena
+ * @return Pointer aligned to 8 bytes or NULL if there is no memory
+ */
+void *discord_arena_alloc(discord_arena_handle_t arena, size_t size);
+
+/**
+ * @brief Copy string into the arena
+ */
+char *discord_arena_strdup(discord_arena_handle_t arena, const char *str);
+
+/**
+ * @brief Drop everything allocated from the arena and return it to the pool it belongs to
+ */
+void discord_arena_release(discord_arena_handle_t arena);
+
+/**
+ * @brief Struct constructor like cu_ctor, but memory is taken from the arena. Falls back to the heap if arena is NULL
+ */
+#define discord_arena_ctor(arena, type, ...)                                                                           \
+    __extension__({                                                                                                    \
+        type *obj = (arena) ? discord_arena_alloc(arena, sizeof(type)) : calloc(1, sizeof(type));                      \
+        if (obj) {                                                                                                     \
+            *obj = (type) { __VA_ARGS__ };                                                                             \
+        }                                                                                                              \
+        obj;                                                                                                           \
+    })
+
+/**
+ * @brief calloc from the arena. Falls back to the heap if arena is NULL
+ */
+#define discord_arena_calloc(arena, count, size)                                                                       \
+    ((arena) ? discord_arena_alloc(arena, (count) * (size)) : calloc(count, size))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,6 +17,10 @@ extern "C" {
 #include "_models.h"
 #include "discord.h"
 #include "discord_ota.h"
+#include "_zlib.h"
+#include "_json_filter.h"
+#include "_json_splitter.h"
+#include "_ratelimit.h"
 
 #include "discord/session.h"
 
@@ -24,7 +28,9 @@ extern "C" {
 #define CONFIG_IDF_TARGET "esp32"
 #endif
 
-#define DISCORD_GW_URL                        "wss://gateway.discord.gg/?v=10&encoding=json"
+#define DISCORD_GW_HOST                       "wss://gateway.discord.gg"
+#define DISCORD_GW_QUERY                      "/?v=10&encoding=json"
+#define DISCORD_GW_QUERY_COMPRESS             "&compress=zlib-stream"
 #define DISCORD_API_URL                       "https://discord.com/api/v10"
 
 // this should go into menuconfig configuration
@@ -33,12 +39,34 @@ extern "C" {
 #define DISCORD_DEFAULT_TASK_PRIORITY         (4)
 #define DISCORD_DEFAULT_API_BUFFER_SIZE       (3 * 1024)
 #define DISCORD_DEFAULT_API_TIMEOUT_MS        (8000)
+#define DISCORD_DEFAULT_API_CONNECTIONS       (1)
 #define DISCORD_DEFAULT_QUEUE_SIZE            (3)
+#define DISCORD_DEFAULT_ARENA_SIZE            (1024)
+#define DISCORD_DEFAULT_RECONNECT_MIN_DELAY   (1000)
+#define DISCORD_DEFAULT_RECONNECT_MAX_DELAY   (60000)
+#define DISCORD_DEFAULT_SHARD_COUNT           (1)
+#define DISCORD_DEFAULT_SESSION_MAX_AGE       (300)
+#define DISCORD_GW_TX_QUEUE_SIZE              (8)
+#define DISCORD_GW_TX_BUFFER_SIZE             (256) /*<! Send buffer for heartbeat and RESUME */
+#define DISCORD_GW_FRAME_QUEUE_SIZE           (4)
+#define DISCORD_GW_CONTROL_QUEUE_SIZE         (4) /*<! Per shard */
+#define DISCORD_GW_DECODE_TASK_STACK_SIZE     (5 * 1024)
+#define DISCORD_GW_RATE_LIMIT                 (120)   /*<! Commands allowed per DISCORD_GW_RATE_LIMIT_PERIOD */
+#define DISCORD_GW_RATE_LIMIT_PERIOD          (60000) /*<! Milliseconds */
+#define DISCORD_GW_RATE_LIMIT_RESERVED        (5)     /*<! Tokens kept for heartbeats, IDENTIFY and RESUME */
+#define DISCORD_GW_PRESENCE_INTERVAL          (12000) /*<! Minimal time between two presence updates (5 per minute) */
+#define DISCORD_GW_MEMBER_SIZE                (1024)  /*<! Maximum length of one member in GUILD_MEMBERS_CHUNK */
+#define DISCORD_GW_MEMBER_REQUEST_TIMEOUT     (30000) /*<! Member request is dropped if no chunk comes in this time */
+#define DISCORD_GW_IDENTIFY_INTERVAL          (5000)  /*<! Minimal time between two IDENTIFY of any shard */
+#define DISCORD_SESSION_CHECKPOINT_INTERVAL   (60000) /*<! Minimal time between two session writes to NVS */
+#define DISCORD_API_QUEUE_SIZE                (8)     /*<! Asynchronous REST requests waiting for the worker */
+#define DISCORD_API_TASK_STACK_SIZE           (6 * 1024)
 
 #define DISCORD_LOG_TAG                       "DISCORD"
 
 #define DISCORD_NVS_NAMESPACE                 "discord_nvs"
 #define DISCORD_NVS_KEY_TOKEN                 "token"
+#define DISCORD_NVS_KEY_SESSION               "session" /*<! Followed by shard id */
 
 #define DISCORD_LOG_DEFINE_BASE()             static const char *TAG = DISCORD_LOG_TAG
 #define DISCORD_LOG(esp_log_foo, format, ...) esp_log_foo(TAG, "%s: " format, __func__, ##__VA_ARGS__)
@@ -49,7 +77,15 @@ extern "C" {
 #define DISCORD_LOGV(format, ...)             DISCORD_LOG(ESP_LOGV, format, ##__VA_ARGS__)
 #define DISCORD_LOG_FOO()                     DISCORD_LOGD("...")
 
-#define DISCORD_EVENT_FIRE(event, data)       client->event_handler(client, event, data)
+#define DISCORD_EVENT_FIRE(event, data)       client->event_handler(client, client->config->shards.first, event, data)
+#define DISCORD_SHARD_EVENT_FIRE(shard, event, data)                                                                   \
+    (shard)->client->event_handler((shard)->client, (shard)->id, event, data)
+#define DISCORD_TASK_NOTIFY(client)                                                                                    \
+    do {                                                                                                               \
+        if ((client)->task_handle) {                                                                                   \
+            xTaskNotifyGive((client)->task_handle);                                                                    \
+        }                                                                                                              \
+    } while (0)
 
 #define STRDUP(str)                           (str ? strdup(str) : NULL)
 
@@ -57,6 +93,7 @@ typedef enum
 {
     DISCORD_CLOSE_REASON_NOT_REQUESTED,
     DISCORD_CLOSE_REASON_HEARTBEAT_ACK_NOT_RECEIVED,
+    DISCORD_CLOSE_REASON_RECONNECT, /*<! Gateway asked for reconnection (or session can be resumed on new connection) */
     DISCORD_CLOSE_REASON_LOGOUT,
     DISCORD_CLOSE_REASON_DESTROY,
     DISCORD_CLOSE_REASON_ERROR
@@ -88,41 +125,141 @@ typedef struct
     int interval;
     uint64_t tick_ms;
     bool received_ack;
+    uint64_t sent_ms; /*<! Send time of the heartbeat which waits for ACK, 0 if none */
 } discord_heartbeater_t;
 
+/**
+ * @brief Token bucket for outbound gateway commands. Burst size is half of the limit and refill rate is half
+ *        of the limit per period, so no 60 second window can contain more than DISCORD_GW_RATE_LIMIT commands
+ */
+typedef struct
+{
+    uint16_t tokens;
+    uint64_t refill_ms; /*<! Time when the last token was added */
+} discord_gateway_limiter_t;
+
+/**
+ * @brief Written by the caller and the client task, read by websocket tasks which split members out of chunks
+ *        and by the decoder task which hands the members over to the handler.
+ *        Nonce of chunk is known only after its members are split, so just one request can be in progress
+ */
+typedef struct
+{
+    portMUX_TYPE lock;
+    bool active; /*<! Chunks of the request can still arrive. Cleared by the last chunk or by reconnect */
+    char nonce[12];
+    uint32_t nonce_counter;
+    discord_member_handler_t handler; /*<! NULL once request timed out. Members of its late chunks are dropped */
+    void *arg;
+    uint64_t tick_ms;            /*<! Time of the request or of the last received chunk */
+    struct discord_shard *shard; /*<! Shard which receives the chunks */
+} discord_member_requester_t;
+
+/**
+ * @brief Complete gateway message, or member split out of one, waiting for the decoder
+ */
+typedef struct
+{
+    uint16_t shard;
+    uint16_t connection;
+    char *data; /*<! NUL terminated message. NULL stops the decoder */
+    size_t len;
+    discord_arena_handle_t arena; /*<! Zero-copy mode: arena which holds the data. Otherwise data is on the heap */
+    bool member;                  /*<! Data is a member split out of GUILD_MEMBERS_CHUNK, not a whole message */
+} discord_gateway_frame_t;
+
+typedef struct discord_event_subscription
+{
+    discord_event_t event;
+    esp_event_handler_t handler;
+    struct discord_event_subscription *next;
+} discord_event_subscription_t;
+
 typedef esp_err_t (*discord_event_handler_t)(
-    discord_handle_t client, discord_event_t event, discord_event_data_ptr_t data_ptr);
+    discord_handle_t client, uint16_t shard_id, discord_event_t event, discord_event_data_ptr_t data_ptr);
 
-struct discord
+/**
+ * @brief Gateway connection. Received payloads of all shards go into the queue of the client
+ */
+typedef struct discord_shard
 {
-    bool running;
-    EventGroupHandle_t bits;
+    uint16_t id;
+    discord_handle_t client;
     discord_gateway_state_t state;
-    TaskHandle_t task_handle;
-    QueueHandle_t queue;
-    esp_event_loop_handle_t event_handle;
-    discord_event_handler_t event_handler;
-    discord_config_t *config;
     SemaphoreHandle_t gw_lock;
     esp_websocket_client_handle_t ws;
-    SemaphoreHandle_t api_lock;
-    esp_http_client_handle_t http;
-    char *api_buffer;
-    int api_buffer_size;
-    bool api_buffer_record;
-    esp_err_t api_buffer_record_status;
-    bool api_download_mode;
-    discord_download_handler_t api_download_handler;
-    void *api_download_arg;
-    size_t api_download_total;
-    size_t api_download_offset;
+    uint16_t gw_connection; /*<! Incremented with every connection start */
     discord_heartbeater_t heartbeater;
+    char gw_tx_buffer[DISCORD_GW_TX_BUFFER_SIZE]; /*<! Commands are written here directly, without heap allocation */
+    char *gw_identify;                            /*<! IDENTIFY serialized once when the shard is created */
+    QueueHandle_t gw_tx_queue;                    /*<! Serialized commands waiting for the rate limiter */
+    discord_gateway_limiter_t gw_limiter;
+    char *gw_presence;            /*<! Serialized presence update waiting to be sent. Newer update replaces it */
+    uint64_t gw_presence_sent_ms; /*<! 0 if presence has not been sent over the current connection */
+    bool gw_identify_pending;     /*<! IDENTIFY waits for gw_identify_delay_ms of the client */
+    discord_json_splitter_handle_t gw_splitter; /*<! Streams members out of GUILD_MEMBERS_CHUNK. Created on demand */
+    bool gw_splitter_active;
     discord_session_t *session;
     int last_sequence_number;
-    char *gw_buffer;
+    uint64_t session_checkpoint_ms; /*<! When session was saved to NVS */
+    int session_checkpoint_seq;     /*<! Sequence number saved to NVS */
+    char *gw_buffer; /*<! Current receive buffer. Points either to gw_heap_buffer or into gw_slot */
+    char *gw_heap_buffer;
+    discord_arena_handle_t gw_slot; /*<! Zero-copy mode: arena which holds the receive buffer */
     int gw_buffer_len;
+    bool gw_buffer_overflow;
+    discord_json_filter_handle_t gw_filter;
+    bool gw_filter_active;
+    discord_zlib_handle_t zlib;
     discord_gateway_close_reason_t close_reason;
+    uint16_t reconnect_attempts; /*<! Consecutive reconnect attempts since the last successful connection */
+    bool reconnect_scheduled;
+    uint64_t reconnect_ms;       /*<! When reconnect was scheduled */
+    uint32_t reconnect_delay_ms; /*<! Delay after reconnect_ms */
     discord_close_code_t close_code;
+} discord_shard_t;
+
+struct discord
+{
+    bool running;
+    EventGroupHandle_t bits;
+    TaskHandle_t task_handle;
+    QueueHandle_t queue;
+    QueueHandle_t control_queue; /*<! Gateway control payloads (not dispatch). Handled before the queue */
+    SemaphoreHandle_t queue_lock; /*<! Taken by consumer and by eviction, so eviction never changes the order */
+    portMUX_TYPE queue_stats_lock;
+    discord_queue_stats_t queue_stats;
+    QueueHandle_t gw_frames; /*<! Received messages of all shards, decoded into the queue by the decoder task */
+    TaskHandle_t gw_decoder;
+    SemaphoreHandle_t gw_decoder_done;
+    discord_arena_pool_handle_t arena_pool;
+    esp_event_loop_handle_t event_handle;
+    discord_event_handler_t event_handler;
+    discord_event_subscription_t *subscriptions;
+    uint32_t subscribed_events[(DISCORD_EVENT_MAX + 31) / 32]; /*<! Bit per event which has at least one handler */
+    discord_config_t *config;
+    discord_shard_t *shards;
+    uint16_t shards_len;
+    uint64_t gw_identify_ms;       /*<! When IDENTIFY was held off the last time */
+    uint32_t gw_identify_delay_ms; /*<! Time after gw_identify_ms before the next IDENTIFY can be sent */
+    SemaphoreHandle_t api_lock; /*<! Guards the pool and rate limits. Never held during request */
+    SemaphoreHandle_t api_idle; /*<! Counts idle connections of the pool */
+    struct dcapi_connection *api_pool;
+    uint8_t api_pool_len;
+    struct dcapi_connection *api_cdn; /*<! Keep-alive connection for downloads, independent of the pool */
+    SemaphoreHandle_t api_cdn_lock;   /*<! Held during download */
+    discord_ratelimit_t api_ratelimit;
+    QueueHandle_t api_queue; /*<! Asynchronous requests (dcapi_job_t), served by the api workers */
+    uint8_t api_workers;
+    TaskHandle_t *api_worker_tasks; /*<! Entry per connection, NULL once stopped. Kept until the client is destroyed */
+    SemaphoreHandle_t api_workers_done;
+    bool api_worker_cancel; /*<! Remaining jobs are completed with error instead of being sent */
+    portMUX_TYPE gw_presence_lock;
+    discord_member_requester_t member_requester;
+    portMUX_TYPE latency_lock;
+    discord_gateway_latency_t latency;
+    uint64_t latency_sum_ms;
+    uint32_t latency_ewma_x8; /*<! EWMA scaled by 8 to keep precision of integer math */
     discord_ota_handle_t ota;
 };
 
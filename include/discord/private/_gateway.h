@@ -9,20 +9,111 @@ extern "C" {
 #include "_discord.h"
 #include "_models.h"
 
+/**
+ * @brief Create shared payload queue and all shards configured in client config
+ */
 esp_err_t dcgw_init(discord_handle_t client);
 /**
- * @brief Send payload (serialized to json) to gateway. Payload will be automatically freed
+ * @brief Send gateway command right away, bypassing the send queue.
+ *        Payload is written into the send buffer of the shard without heap allocation. Payload is not freed
+ */
+esp_err_t dcgw_send(discord_shard_t *shard, discord_payload_t *payload);
+/**
+ * @brief Queue payload (written to json) for sending without blocking. Payload is not freed.
+ *        Queued commands are sent by the discord task once connected, as fast as the gateway rate limit allows
+ * @return ESP_FAIL if the send queue is full
+ */
+esp_err_t dcgw_enqueue(discord_shard_t *shard, discord_payload_t *payload);
+/**
+ * @brief Set serialized presence update as the pending one on every shard, replacing (and freeing)
+ *        the previous pending update. Pending presence is sent by the discord task
+ *        at most once per DISCORD_GW_PRESENCE_INTERVAL
+ */
+esp_err_t dcgw_presence_set(discord_handle_t client, char *payload_raw);
+/**
+ * @brief Send queued commands and pending presence update while rate limit allows it
+ */
+esp_err_t dcgw_tx_flush(discord_shard_t *shard);
+/**
+ * @brief Milliseconds until the next queued command can be sent. UINT32_MAX if there is nothing to send
+ */
+uint32_t dcgw_tx_due_ms(discord_shard_t *shard);
+/**
+ * @brief Check if at least one shard is open
  */
-esp_err_t dcgw_send(discord_handle_t client, discord_payload_t *payload);
 bool dcgw_is_open(discord_handle_t client);
+/**
+ * @brief Check if at least one shard is connected
+ */
+bool dcgw_is_connected(discord_handle_t client);
+/**
+ * @brief State of the shard furthest from CONNECTED
+ */
+discord_gateway_state_t dcgw_get_state(discord_handle_t client);
+/**
+ * @brief Start all shards
+ */
 esp_err_t dcgw_open(discord_handle_t client);
-esp_err_t dcgw_start(discord_handle_t client);
-esp_err_t dcgw_close(discord_handle_t client, discord_gateway_close_reason_t reason);
-esp_err_t dcgw_get_close_desc(discord_handle_t client, char **out_description);
+esp_err_t dcgw_start(discord_shard_t *shard);
+esp_err_t dcgw_close(discord_shard_t *shard, discord_gateway_close_reason_t reason);
+esp_err_t dcgw_get_close_desc(discord_shard_t *shard, char **out_description);
 esp_err_t dcgw_destroy(discord_handle_t client);
 esp_err_t dcgw_queue_flush(discord_handle_t client);
-esp_err_t dcgw_heartbeat_send_if_expired(discord_handle_t client);
+/**
+ * @brief Take the oldest control payload (HELLO, HEARTBEAT, HEARTBEAT_ACK, RECONNECT, INVALID_SESSION)
+ *        without waiting. Control payloads are handled before dispatch payloads from the queue
+ */
+bool dcgw_control_receive(discord_handle_t client, discord_payload_t **out_payload);
+/**
+ * @brief Take the oldest payload from the queue without waiting
+ */
+bool dcgw_queue_receive(discord_handle_t client, discord_payload_t **out_payload);
+esp_err_t dcgw_heartbeat_send_if_expired(discord_shard_t *shard);
+/**
+ * @brief Milliseconds until the next heartbeat is due. UINT32_MAX if heartbeat is not running
+ */
+uint32_t dcgw_heartbeat_due_ms(discord_shard_t *shard);
+/**
+ * @brief Send IDENTIFY as soon as DISCORD_GW_IDENTIFY_INTERVAL since the last IDENTIFY of any shard passes
+ */
+esp_err_t dcgw_identify(discord_shard_t *shard);
+/**
+ * @brief Send pending IDENTIFY if its time has come
+ */
+esp_err_t dcgw_identify_send_if_due(discord_shard_t *shard);
+/**
+ * @brief Milliseconds until pending IDENTIFY can be sent. UINT32_MAX if there is no pending IDENTIFY
+ */
+uint32_t dcgw_identify_due_ms(discord_shard_t *shard);
+/**
+ * @brief Send RESUME payload for the current session. Session needs to be resumable
+ */
+esp_err_t dcgw_resume(discord_shard_t *shard);
+/**
+ * @brief Forget current session (if close code tells that it cannot be resumed)
+ *        so the next connection will start a new one using IDENTIFY
+ */
+esp_err_t dcgw_session_reset(discord_shard_t *shard);
+/**
+ * @brief Save session to NVS (if enabled) when sequence number has changed
+ *        and DISCORD_SESSION_CHECKPOINT_INTERVAL has passed since the last checkpoint
+ */
+esp_err_t dcgw_session_checkpoint_if_due(discord_shard_t *shard);
+/**
+ * @return Milliseconds until the next session checkpoint, UINT32_MAX if there is nothing to save
+ */
+uint32_t dcgw_session_checkpoint_due_ms(discord_shard_t *shard);
+/**
+ * @brief Handle payload received by any shard. Payload will be automatically freed
+ */
 esp_err_t dcgw_handle_payload(discord_handle_t client, discord_payload_t *payload);
+/**
+ * @brief Send Request Guild Members over the shard of the guild with the new nonce
+ *        and stream received members to the handler
+ * @return ESP_ERR_NOT_FOUND if the guild is on a shard which is not run by this client
+ */
+esp_err_t dcgw_member_request(
+    discord_handle_t client, discord_member_request_t *request, discord_member_handler_t handler, void *arg);
 
 #ifdef __cplusplus
 }
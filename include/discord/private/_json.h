@@ -3,6 +3,7 @@
 
 #include "cJSON.h"
 #include "discord/private/_models.h"
+#include "discord/private/_arena.h"
 #include "discord/session.h"
 #include "discord/user.h"
 #include "discord/member.h"
@@ -13,11 +14,33 @@
 #include "discord/role.h"
 #include "discord/attachment.h"
 #include "discord/voice_state.h"
+#include "discord/presence.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief NULL terminated list of object keys used by decoders
+ */
+extern const char *const discord_json_keys[];
+
+/**
+ * @brief Top level fields of gateway payload
+ */
+typedef struct
+{
+    int op;
+    int s;             /*<! DISCORD_NULL_SEQUENCE_NUMBER if null or missing */
+    discord_event_t t; /*<! DISCORD_EVENT_NONE if null or missing */
+} discord_payload_header_t;
+
+/**
+ * @brief Extract op, s and t of gateway payload without parsing it. Value of "d" is skipped
+ * @return ESP_OK on success, ESP_FAIL if JSON is not a gateway payload
+ */
+esp_err_t discord_payload_header_from_json(const char *json, size_t length, discord_payload_header_t *out);
+
 #define discord_json_serialize_(obj, to_cjson_fnc)                                                                     \
     ({                                                                                                                 \
         cJSON *cjson = to_cjson_fnc(obj);                                                                              \
@@ -28,12 +51,12 @@ extern "C" {
 
 #define discord_json_serialize(obj) discord_json_serialize_(obj, discord_##obj##_to_cjson)
 
-#define discord_json_deserialize(type, from_cjson_fnc, json, length)                                                   \
+#define discord_json_deserialize(type, from_cjson_fnc, json, length, arena)                                            \
     ({                                                                                                                 \
         type *obj = NULL;                                                                                              \
         cJSON *cjson = cJSON_ParseWithLength(json, length);                                                            \
         if (cjson) {                                                                                                   \
-            obj = from_cjson_fnc(cjson);                                                                               \
+            obj = from_cjson_fnc(cjson, arena);                                                                        \
             cJSON_Delete(cjson);                                                                                       \
         }                                                                                                              \
         else {                                                                                                         \
@@ -43,7 +66,13 @@ extern "C" {
     })
 
 #define discord_json_deserialize_(obj_name, json, length)                                                              \
-    discord_json_deserialize(discord_##obj_name##_t, discord_##obj_name##_from_cjson, json, length)
+    discord_json_deserialize(discord_##obj_name##_t, discord_##obj_name##_from_cjson, json, length, NULL)
+
+/**
+ * @brief Deserialize object into the arena. Whole object is released with the arena
+ */
+#define discord_json_deserialize_in_(obj_name, json, length, arena)                                                    \
+    discord_json_deserialize(discord_##obj_name##_t, discord_##obj_name##_from_cjson, json, length, arena)
 
 #define discord_json_list_deserialize(type, from_cjson_fnc, json, length, out_length)                                  \
     ({                                                                                                                 \
@@ -57,7 +86,7 @@ extern "C" {
             list = calloc(_len, sizeof(type *));                                                                       \
             if (list) {                                                                                                \
                 for (int i = 0; i < _len; i++) {                                                                       \
-                    list[i] = from_cjson_fnc(cJSON_GetArrayItem(cjson, i));                                            \
+                    list[i] = from_cjson_fnc(cJSON_GetArrayItem(cjson, i), NULL);                                      \
                 }                                                                                                      \
                 if ((out_length)) {                                                                                    \
                     *(out_length) = _len;                                                                              \
@@ -71,47 +100,42 @@ extern "C" {
 #define discord_json_list_deserialize_(obj_name, json, length, out_length)                                             \
     discord_json_list_deserialize(discord_##obj_name##_t, discord_##obj_name##_from_cjson, json, length, out_length)
 
-cJSON *discord_payload_to_cjson(discord_payload_t *payload);
-discord_payload_t *discord_payload_from_cjson(cJSON *cjson);
-
-discord_payload_data_t discord_dispatch_event_data_from_cjson(discord_event_t e, cJSON *cjson);
-
-cJSON *discord_heartbeat_to_cjson(discord_heartbeat_t *heartbeat);
-
-cJSON *discord_identify_properties_to_cjson(discord_identify_properties_t *properties);
+discord_payload_t *discord_payload_from_cjson(cJSON *cjson, discord_arena_handle_t arena);
 
-cJSON *discord_identify_to_cjson(discord_identify_t *identify);
+discord_payload_data_t discord_dispatch_event_data_from_cjson(
+    discord_event_t e, cJSON *cjson, discord_arena_handle_t arena);
 
-discord_session_t *discord_session_from_cjson(cJSON *root);
+discord_session_t *discord_session_from_cjson(cJSON *root, discord_arena_handle_t arena);
 
-discord_user_t *discord_user_from_cjson(cJSON *root);
+discord_user_t *discord_user_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_user_to_cjson(discord_user_t *user);
 
-discord_member_t *discord_member_from_cjson(cJSON *root);
+discord_member_t *discord_member_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_member_to_cjson(discord_member_t *member);
+discord_member_chunk_t *discord_member_chunk_from_cjson(cJSON *root, discord_arena_handle_t arena);
 
-discord_attachment_t *discord_attachment_from_cjson(cJSON *root);
+discord_attachment_t *discord_attachment_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_attachment_to_cjson(discord_attachment_t *attachment);
 
 cJSON *discord_embed_to_cjson(discord_embed_t *embed);
 
-discord_guild_t *discord_guild_from_cjson(cJSON *root);
+discord_guild_t *discord_guild_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_guild_to_cjson(discord_guild_t *guild);
 
-discord_channel_t *discord_channel_from_cjson(cJSON *root);
+discord_channel_t *discord_channel_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_channel_to_cjson(discord_channel_t *channel);
 
-discord_role_t *discord_role_from_cjson(cJSON *root);
+discord_role_t *discord_role_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_role_to_cjson(discord_role_t *role);
 
-discord_message_t *discord_message_from_cjson(cJSON *root);
+discord_message_t *discord_message_from_cjson(cJSON *root, discord_arena_handle_t arena);
 cJSON *discord_message_to_cjson(discord_message_t *msg);
 
-discord_emoji_t *discord_emoji_from_cjson(cJSON *root);
+discord_emoji_t *discord_emoji_from_cjson(cJSON *root, discord_arena_handle_t arena);
 
-discord_message_reaction_t *discord_message_reaction_from_cjson(cJSON *root);
+discord_message_reaction_t *discord_message_reaction_from_cjson(cJSON *root, discord_arena_handle_t arena);
 
-discord_voice_state_t *discord_voice_state_from_cjson(cJSON *root);
+discord_voice_state_t *discord_voice_state_from_cjson(cJSON *root, discord_arena_handle_t arena);
 
 #ifdef __cplusplus
 }
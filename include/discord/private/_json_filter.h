@@ -0,0 +1,50 @@
+#ifndef _DISCORD_PRIVATE_JSON_FILTER_H_
+#define _DISCORD_PRIVATE_JSON_FILTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+
+/**
+ * @brief Streaming JSON filter. Consumes JSON text chunk by chunk and outputs compacted JSON
+ *        without whitespace and without object members whose keys are not on the allow list.
+ *        Output is never longer than input, so filter can be run in place.
+ */
+typedef struct discord_json_filter *discord_json_filter_handle_t;
+
+/**
+ * @brief Create filter
+ * @param keys NULL terminated list of object keys to keep (on any depth). Must outlive the filter
+ * @return Handle or NULL if there is no memory
+ */
+discord_json_filter_handle_t discord_json_filter_create(const char *const *keys);
+
+/**
+ * @brief Prepare filter for the new JSON document
+ */
+void discord_json_filter_reset(discord_json_filter_handle_t filter);
+
+/**
+ * @brief Filter next chunk of JSON document. Filtered bytes are appended to the output buffer at *out_len.
+ *        Input may point into the same buffer as output as long as it does not start before out + *out_len
+ * @param filter Filter handle
+ * @param in Chunk of JSON text
+ * @param in_len Length of the chunk
+ * @param out Output buffer
+ * @param out_size Size of output buffer
+ * @param out_len Pointer to current length of output buffer. Will be updated with new length
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if output buffer is too small,
+ *         ESP_FAIL if document is malformed or nested too deep
+ */
+esp_err_t discord_json_filter_write(discord_json_filter_handle_t filter, const char *in, size_t in_len, char *out,
+    size_t out_size, size_t *out_len);
+
+void discord_json_filter_free(discord_json_filter_handle_t filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _DISCORD_PRIVATE_JSON_PARSER_H_
+#define _DISCORD_PRIVATE_JSON_PARSER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cJSON.h"
+#include "discord/private/_arena.h"
+
+/**
+ * @brief Parse JSON in place (zero-copy). Strings are unescaped and NUL terminated inside of the given buffer
+ *        and nodes reference them (cJSON_IsReference), while the nodes themselves are allocated from the arena.
+ *        Resulting tree must never be passed to cJSON_Delete. It is valid until the arena is released
+ *        and the buffer is alive. Buffer content is destroyed by parsing
+ * @param json JSON text. Must be NUL terminated at json[length]
+ * @param length Length of JSON text
+ * @param arena Arena for the nodes
+ * @return Root node or NULL if JSON is malformed or there is no memory
+ */
+cJSON *discord_json_parse_in_place(char *json, size_t length, discord_arena_handle_t arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
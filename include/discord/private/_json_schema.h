@@ -0,0 +1,127 @@
+#ifndef _DISCORD_PRIVATE_JSON_SCHEMA_H_
+#define _DISCORD_PRIVATE_JSON_SCHEMA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "discord/private/_arena.h"
+
+/**
+ * @brief Model schema. Every model field which is read from or written to JSON is described once
+ *        by a field descriptor, and the generic decoder and encoder below are driven by these descriptors
+ */
+typedef enum
+{
+    DISCORD_JSON_FIELD_STRING,      /*<! char * */
+    DISCORD_JSON_FIELD_INT,         /*<! Any integer or enum of 1, 2, 4 or 8 bytes */
+    DISCORD_JSON_FIELD_BOOL,        /*<! bool */
+    DISCORD_JSON_FIELD_OBJECT,      /*<! Pointer to nested model */
+    DISCORD_JSON_FIELD_STRING_LIST, /*<! char ** with length in another member */
+    DISCORD_JSON_FIELD_OBJECT_LIST, /*<! Array of pointers to nested models with length in another member */
+} discord_json_field_type_t;
+
+#define DISCORD_JSON_DECODE   (1 << 0) /*<! Field is read from JSON */
+#define DISCORD_JSON_ENCODE   (1 << 1) /*<! Field is written to JSON */
+#define DISCORD_JSON_REQUIRED (1 << 2) /*<! Object without this field is not decoded at all */
+
+typedef struct discord_json_schema discord_json_schema_t;
+
+typedef struct
+{
+    const char *key;
+    discord_json_field_type_t type;
+    uint8_t flags;
+    uint8_t size;                        /*<! Size of the member */
+    uint16_t offset;                     /*<! Offset of the member */
+    uint16_t len_offset;                 /*<! Lists only. Offset of the length member */
+    uint8_t len_size;                    /*<! Lists only. Size of the length member */
+    int def;                             /*<! Integers only. Value of missing field */
+    const discord_json_schema_t *schema; /*<! Objects only. Schema of nested model */
+} discord_json_field_t;
+
+struct discord_json_schema
+{
+    size_t size; /*<! Size of the model */
+    const discord_json_field_t *fields;
+    uint8_t fields_len;
+};
+
+#define _DISCORD_JSON_FIELD(model, member, key_, type_, flags_, ...)                                                   \
+    {                                                                                                                  \
+        .key = key_, .type = type_, .flags = flags_, .size = sizeof(((model *)0)->member),                             \
+        .offset = offsetof(model, member), __VA_ARGS__                                                                 \
+    }
+
+#define DISCORD_JSON_STRING(model, member, key, flags)                                                                 \
+    _DISCORD_JSON_FIELD(model, member, key, DISCORD_JSON_FIELD_STRING, flags)
+
+#define DISCORD_JSON_INT(model, member, key, flags, default_value)                                                     \
+    _DISCORD_JSON_FIELD(model, member, key, DISCORD_JSON_FIELD_INT, flags, .def = default_value)
+
+#define DISCORD_JSON_BOOL(model, member, key, flags)                                                                   \
+    _DISCORD_JSON_FIELD(model, member, key, DISCORD_JSON_FIELD_BOOL, flags)
+
+#define DISCORD_JSON_OBJECT(model, member, key, flags, nested_schema)                                                  \
+    _DISCORD_JSON_FIELD(model, member, key, DISCORD_JSON_FIELD_OBJECT, flags, .schema = &(nested_schema))
+
+#define DISCORD_JSON_STRING_LIST(model, member, len_member, key, flags)                                                \
+    _DISCORD_JSON_FIELD(model,                                                                                         \
+        member,                                                                                                        \
+        key,                                                                                                           \
+        DISCORD_JSON_FIELD_STRING_LIST,                                                                                \
+        flags,                                                                                                         \
+        .len_offset = offsetof(model, len_member),                                                                     \
+        .len_size = sizeof(((model *)0)->len_member))
+
+#define DISCORD_JSON_OBJECT_LIST(model, member, len_member, key, flags, nested_schema)                                 \
+    _DISCORD_JSON_FIELD(model,                                                                                         \
+        member,                                                                                                        \
+        key,                                                                                                           \
+        DISCORD_JSON_FIELD_OBJECT_LIST,                                                                                \
+        flags,                                                                                                         \
+        .len_offset = offsetof(model, len_member),                                                                     \
+        .len_size = sizeof(((model *)0)->len_member),                                                                  \
+        .schema = &(nested_schema))
+
+#define DISCORD_JSON_SCHEMA(name, model, fields_)                                                                      \
+    const discord_json_schema_t name = {                                                                               \
+        .size = sizeof(model),                                                                                         \
+        .fields = fields_,                                                                                             \
+        .fields_len = sizeof(fields_) / sizeof(fields_[0]),                                                            \
+    }
+
+/**
+ * @brief Get string value of the item. Without arena string is stolen from cJSON item (no copy),
+ *        otherwise it is copied into the arena. Strings of tree parsed in place already live
+ *        in the buffer owned by the arena, so they are just referenced
+ */
+char *discord_json_take_string(cJSON *item, discord_arena_handle_t arena);
+
+/**
+ * @brief Decode model in a single pass over the object. Members of missing fields stay zeroed
+ *        (or get the default value). Strings follow the rules of arena decoding: without arena they are stolen
+ *        from the cJSON tree, otherwise referenced (tree parsed in place) or copied into the arena
+ * @return Model or NULL if root is not an object, a required field is missing, or there is no memory
+ */
+void *discord_json_schema_decode(const discord_json_schema_t *schema, cJSON *root, discord_arena_handle_t arena);
+
+/**
+ * @brief Encode model. NULL strings, objects and empty lists are left out, numbers and booleans are always written.
+ *        Strings are referenced, so the model must outlive the returned tree
+ */
+cJSON *discord_json_schema_encode(const discord_json_schema_t *schema, const void *obj);
+
+/**
+ * @brief Free model decoded without arena, together with all its fields
+ */
+void discord_json_schema_free(const discord_json_schema_t *schema, void *obj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
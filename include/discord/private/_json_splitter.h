@@ -0,0 +1,69 @@
+#ifndef _DISCORD_PRIVATE_JSON_SPLITTER_H_
+#define _DISCORD_PRIVATE_JSON_SPLITTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include "esp_err.h"
+
+/**
+ * @brief Streaming splitter of big gateway arrays. Consumes gateway message chunk by chunk and, if value of "t"
+ *        matches the event, cuts elements (objects or arrays) out of the array under the given key of "d".
+ *        Every element is handed over to the element callback as soon as it is complete,
+ *        while the rest of the message (with the array left empty) is passed through to the write callback.
+ *        This way huge arrays are decoded one element at a time and never held in the memory at once.
+ *        Without event and key, elements of the root array are split (e.g. REST response with a list)
+ */
+typedef struct discord_json_splitter *discord_json_splitter_handle_t;
+
+/**
+ * @brief Receives the part of message which is not split out
+ */
+typedef esp_err_t (*discord_json_splitter_write_cb_t)(void *arg, const char *data, size_t len);
+
+/**
+ * @brief Receives single array element. Element is NUL terminated and can be modified (parsed in place).
+ *        It is valid only until the callback returns
+ */
+typedef void (*discord_json_splitter_element_cb_t)(void *arg, char *element, size_t len);
+
+typedef struct
+{
+    const char *event;   /*<! Value of "t" which enables splitting. "t" must come before "d". NULL splits root array */
+    const char *key;     /*<! Key of array inside of "d". NULL splits root array */
+    size_t element_size; /*<! Maximum length of one element. Bigger elements are dropped */
+    discord_json_splitter_write_cb_t write_cb; /*<! Can be NULL if the rest of the message is not needed */
+    discord_json_splitter_element_cb_t element_cb;
+    void *arg; /*<! Argument passed to callbacks */
+} discord_json_splitter_config_t;
+
+/**
+ * @return Handle or NULL if there is no memory
+ */
+discord_json_splitter_handle_t discord_json_splitter_create(const discord_json_splitter_config_t *config);
+
+/**
+ * @brief Prepare splitter for the new message
+ */
+void discord_json_splitter_reset(discord_json_splitter_handle_t splitter);
+
+/**
+ * @brief Split next chunk of the message
+ * @return Error returned by the write callback, ESP_FAIL if message is nested too deep
+ */
+esp_err_t discord_json_splitter_write(discord_json_splitter_handle_t splitter, const char *in, size_t in_len);
+
+/**
+ * @return Number of elements dropped since reset because they did not fit into element_size
+ */
+size_t discord_json_splitter_dropped(discord_json_splitter_handle_t splitter);
+
+void discord_json_splitter_free(discord_json_splitter_handle_t splitter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
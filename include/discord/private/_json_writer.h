@@ -0,0 +1,64 @@
+#ifndef _DISCORD_PRIVATE_JSON_WRITER_H_
+#define _DISCORD_PRIVATE_JSON_WRITER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "discord/private/_models.h"
+
+/**
+ * @brief Direct JSON writer. Formats outbound gateway commands straight into the given buffer,
+ *        without building cJSON tree and without any heap allocation.
+ *        Writer keeps counting even when buffer is full, so writing into zero sized buffer measures the output
+ */
+typedef struct
+{
+    char *buf;
+    size_t size; /*<! Size of buf including the NUL terminator */
+    size_t len;  /*<! Length of the output, even if it does not fit into buf */
+} discord_json_writer_t;
+
+void discord_json_writer_init(discord_json_writer_t *writer, char *buf, size_t size);
+
+/**
+ * @brief Append text as it is (it must be a valid JSON fragment)
+ */
+void discord_json_writer_raw(discord_json_writer_t *writer, const char *str);
+
+/**
+ * @brief Append quoted and escaped string, or null if str is NULL
+ */
+void discord_json_writer_string(discord_json_writer_t *writer, const char *str);
+
+void discord_json_writer_int(discord_json_writer_t *writer, int value);
+
+void discord_json_writer_bool(discord_json_writer_t *writer, bool value);
+
+/**
+ * @brief NUL terminate the output
+ * @return ESP_OK or ESP_ERR_INVALID_SIZE if output does not fit into the buffer (writer->len + 1 bytes needed)
+ */
+esp_err_t discord_json_writer_end(discord_json_writer_t *writer);
+
+/**
+ * @brief Write gateway command (HEARTBEAT, IDENTIFY, RESUME, PRESENCE_UPDATE or REQUEST_GUILD_MEMBERS)
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if command does not fit into the buffer
+ *         or ESP_ERR_NOT_SUPPORTED if command cannot be written directly
+ */
+esp_err_t discord_json_write_payload(discord_json_writer_t *writer, discord_payload_t *payload);
+
+/**
+ * @brief Write gateway command into exactly sized heap buffer
+ * @return NUL terminated command which must be freed, or NULL
+ */
+char *discord_json_write_payload_alloc(discord_payload_t *payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
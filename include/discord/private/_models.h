@@ -3,6 +3,8 @@
 
 #include "cJSON.h"
 #include "discord.h"
+#include "discord/member.h"
+#include "discord/private/_arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +20,9 @@ typedef struct
     discord_payload_data_t d;
     int s;
     discord_event_t t;
+    discord_arena_handle_t arena; /*<! Arena which holds payload and its data. NULL if payload is on the heap */
+    uint16_t shard;               /*<! Index of the shard which received the payload */
+    uint16_t connection;          /*<! Connection counter of the shard at the time of receiving */
 } discord_payload_t;
 
 typedef struct
@@ -39,8 +44,28 @@ typedef struct
     char *token;
     int intents;
     discord_identify_properties_t *properties;
+    uint16_t shard_id;
+    uint16_t shard_count; /*<! Shard is not sent if there is only one */
 } discord_identify_t;
 
+typedef struct
+{
+    char *token;
+    char *session_id;
+    int seq;
+} discord_resume_t;
+
+typedef struct
+{
+    bool resumable;
+} discord_invalid_session_t;
+
+typedef struct
+{
+    discord_member_request_t *request;
+    char *nonce;
+} discord_request_guild_members_t;
+
 void discord_payload_free(discord_payload_t *payload);
 
 void discord_dispatch_event_data_free(discord_payload_t *payload);
@@ -51,6 +76,8 @@ void discord_identify_properties_free(discord_identify_properties_t *properties)
 
 void discord_identify_free(discord_identify_t *identify);
 
+void discord_resume_free(discord_resume_t *resume);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,98 @@
+#ifndef _DISCORD_PRIVATE_RATELIMIT_H_
+#define _DISCORD_PRIVATE_RATELIMIT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief REST rate limits. Every request belongs to a route, which is the method with the path where ids are
+ *        replaced by a placeholder, except major parameters (channel, guild and webhook id) which stay part
+ *        of the route. Discord tells in response headers which bucket the route belongs to, how many requests
+ *        are left in the bucket and when it resets. Routes are mapped to buckets, and requests are delayed
+ *        while their bucket or the global limit is exhausted, so 429 should not happen at all
+ */
+
+#define DISCORD_RATELIMIT_ROUTES        (16)    /*<! Routes and buckets remembered. Least recently used are forgotten */
+#define DISCORD_RATELIMIT_GLOBAL        (50)    /*<! Requests allowed per DISCORD_RATELIMIT_GLOBAL_PERIOD */
+#define DISCORD_RATELIMIT_GLOBAL_PERIOD (1000)  /*<! Milliseconds */
+#define DISCORD_RATELIMIT_MAX_WAIT      (60000) /*<! Total wait of asynchronous request. Not retried if asked longer */
+#define DISCORD_RATELIMIT_MAX_SYNC_WAIT (5000)  /*<! Total wait of synchronous request. Client task never waits */
+#define DISCORD_RATELIMIT_RETRIES       (3)     /*<! Attempts of request which keeps getting 429 */
+
+typedef struct
+{
+    uint32_t route;   /*<! 0 if entry is free */
+    uint32_t bucket;  /*<! Bucket hash combined with major parameter. 0 if not known yet */
+    uint64_t used_ms; /*<! Last use, for eviction */
+} discord_ratelimit_route_t;
+
+typedef struct
+{
+    uint32_t bucket;    /*<! 0 if entry is free */
+    uint16_t remaining; /*<! Requests left until reset_ms */
+    uint64_t reset_ms;
+    uint64_t used_ms;
+} discord_ratelimit_bucket_t;
+
+typedef struct
+{
+    discord_ratelimit_route_t routes[DISCORD_RATELIMIT_ROUTES];
+    discord_ratelimit_bucket_t buckets[DISCORD_RATELIMIT_ROUTES];
+    uint64_t global_reset_ms;  /*<! Set by global 429. No request goes out before it */
+    uint64_t global_window_ms; /*<! Start of the current global window */
+    uint16_t global_count;     /*<! Requests sent in the current global window */
+} discord_ratelimit_t;
+
+/**
+ * @brief Rate limit headers of a single response, filled header by header
+ */
+typedef struct
+{
+    uint32_t bucket;    /*<! Hash of X-RateLimit-Bucket. 0 if missing */
+    int remaining;      /*<! X-RateLimit-Remaining. -1 if missing */
+    int reset_after_ms; /*<! X-RateLimit-Reset-After. -1 if missing */
+    int retry_after_ms; /*<! Retry-After. -1 if missing */
+    bool global;        /*<! X-RateLimit-Global or X-RateLimit-Scope: global */
+} discord_ratelimit_headers_t;
+
+/**
+ * @brief Get route of request
+ * @param method HTTP method
+ * @param uri Path relative to the API url (e.g. "/channels/123/messages/456")
+ * @param out_major Hash of the major parameter, 0 if path has none
+ * @return Route hash, never 0
+ */
+uint32_t discord_ratelimit_route(int method, const char *uri, uint32_t *out_major);
+
+/**
+ * @brief Reserve request of route
+ * @param now_ms Monotonic time (discord_tick_ms). Resets are kept as absolute times, so the clock must never go back
+ * @return 0 if request can be sent right now (and it is counted), otherwise milliseconds to wait before trying again
+ */
+uint32_t discord_ratelimit_acquire(discord_ratelimit_t *ratelimit, uint32_t route, uint64_t now_ms);
+
+void discord_ratelimit_headers_reset(discord_ratelimit_headers_t *headers);
+
+/**
+ * @brief Collect response header. Other headers than rate limit ones are ignored
+ */
+void discord_ratelimit_headers_set(discord_ratelimit_headers_t *headers, const char *key, const char *value);
+
+/**
+ * @brief Update route and its bucket with headers of the response
+ * @param status HTTP status code of the response
+ * @param now_ms Monotonic time, the same clock as of discord_ratelimit_acquire
+ * @return 0 or, on 429, milliseconds to wait before the request can be retried
+ */
+uint32_t discord_ratelimit_update(discord_ratelimit_t *ratelimit, uint32_t route, uint32_t major,
+    const discord_ratelimit_headers_t *headers, int status, uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _DISCORD_PRIVATE_SESSION_STORE_H_
+#define _DISCORD_PRIVATE_SESSION_STORE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "discord/session.h"
+
+/**
+ * @brief Gateway session checkpoint kept in NVS (DISCORD_NVS_NAMESPACE), one per shard.
+ *        Checkpoint holds everything needed to RESUME without READY: session id, resume url,
+ *        sequence number, bot user and the wall clock time when it was saved.
+ *        NVS must be initialized with nvs_flash_init() by the application
+ */
+
+/**
+ * @param shard_count Total number of shards. Checkpoint of different sharding is never loaded
+ */
+esp_err_t discord_session_store_save(uint16_t shard_id, uint16_t shard_count, discord_session_t *session, int seq);
+
+/**
+ * @brief Load checkpoint which is not older than max_age seconds.
+ *        If wall clock is not synchronized, now or when the checkpoint was saved, or it went backwards,
+ *        age cannot be told and checkpoint is not loaded. Stale session would cost INVALID_SESSION and IDENTIFY delay
+ * @param out_session Loaded session. Must be freed with discord_session_free
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if there is no usable checkpoint, or NVS error
+ */
+esp_err_t discord_session_store_load(
+    uint16_t shard_id, uint16_t shard_count, uint32_t max_age, discord_session_t **out_session, int *out_seq);
+
+esp_err_t discord_session_store_erase(uint16_t shard_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
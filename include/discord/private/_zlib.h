@@ -0,0 +1,56 @@
+#ifndef _DISCORD_PRIVATE_ZLIB_H_
+#define _DISCORD_PRIVATE_ZLIB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+
+typedef struct discord_zlib *discord_zlib_handle_t;
+
+/**
+ * @brief Create streaming inflate context. Context holds whole LZ dictionary (32 KB),
+ *        so only one should exist per gateway connection
+ * @return Handle or NULL if there is no memory
+ */
+discord_zlib_handle_t discord_zlib_create();
+
+/**
+ * @brief Prepare context for the new zlib stream (new gateway connection)
+ */
+void discord_zlib_reset(discord_zlib_handle_t zlib);
+
+/**
+ * @brief Callback which receives inflated bytes
+ * @return ESP_OK to continue. Any other error is returned from discord_zlib_inflate
+ */
+typedef esp_err_t (*discord_zlib_write_cb_t)(void *arg, const char *data, size_t len);
+
+/**
+ * @brief Inflate next chunk of zlib stream. Inflated bytes are passed to the callback as they are produced.
+ *        If callback fails, stream is still consumed (in order to keep dictionary valid)
+ *        but the rest of inflated bytes are discarded
+ * @param zlib Inflate context
+ * @param in Compressed chunk
+ * @param in_len Length of compressed chunk
+ * @param write_cb Callback which receives inflated bytes
+ * @param arg Argument passed to the callback
+ * @return ESP_OK on success, ESP_FAIL if stream is corrupted, otherwise first error returned by the callback
+ */
+esp_err_t discord_zlib_inflate(discord_zlib_handle_t zlib, const void *in, size_t in_len,
+    discord_zlib_write_cb_t write_cb, void *arg);
+
+/**
+ * @brief Check if the stream ends with Z_SYNC_FLUSH suffix (0x00 0x00 0xFF 0xFF),
+ *        which marks the end of one gateway message
+ */
+bool discord_zlib_is_flushed(discord_zlib_handle_t zlib);
+
+void discord_zlib_free(discord_zlib_handle_t zlib);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
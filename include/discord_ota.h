@@ -22,8 +22,7 @@ typedef struct
     bool administrator_only_disabled; /*<! Disable option that only Administrators can perform OTA update */
     discord_channel_t *channel; /*<! Channel in which OTA update can be performed. Id or Name can be provided. Id has
                                    higher priority over the channel Name (if both are provided). Set to NULL to allow
-                                   all channels. Note: Maybe you will need to increase the size of Api buffer for using
-                                   this option with providing channel Name instead of Id */
+                                   all channels */
 } discord_ota_config_t;
 
 /**
@@ -1,4 +1,4 @@
-#include <sys/time.h>
+#include <inttypes.h>
 #include "discord.h"
 #include "discord/private/_gateway.h"
 #include "discord/private/_api.h"
@@ -9,6 +9,8 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_websocket_client.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "cutils.h"
 
 #define _dc_default(val, default) (val > 0 ? val : default)
@@ -26,9 +28,26 @@ static discord_config_t *dc_config_copy(const discord_config_t *config)
         .gateway_buffer_size = _dc_default(config->gateway_buffer_size, DISCORD_DEFAULT_GW_BUFFER_SIZE),
         .api_buffer_size = _dc_default(config->api_buffer_size, DISCORD_DEFAULT_API_BUFFER_SIZE),
         .api_timeout_ms = _dc_default(config->api_timeout_ms, DISCORD_DEFAULT_API_TIMEOUT_MS),
+        .api_connections = _dc_default(config->api_connections, DISCORD_DEFAULT_API_CONNECTIONS),
         .queue_size = _dc_default(config->queue_size, DISCORD_DEFAULT_QUEUE_SIZE),
+        .queue_policy = config->queue_policy,
         .task_stack_size = _dc_default(config->task_stack_size, DISCORD_DEFAULT_TASK_STACK_SIZE),
-        .task_priority = _dc_default(config->task_priority, DISCORD_DEFAULT_TASK_PRIORITY));
+        .task_priority = _dc_default(config->task_priority, DISCORD_DEFAULT_TASK_PRIORITY),
+        .gateway_compression = config->gateway_compression,
+        .gateway_zero_copy = config->gateway_zero_copy,
+        .reconnect = {
+            .min_delay_ms = _dc_default(config->reconnect.min_delay_ms, DISCORD_DEFAULT_RECONNECT_MIN_DELAY),
+            .max_delay_ms = _dc_default(config->reconnect.max_delay_ms, DISCORD_DEFAULT_RECONNECT_MAX_DELAY),
+            .max_attempts = config->reconnect.max_attempts,
+        },
+        .shards = {
+            .first = config->shards.first,
+            .count = _dc_default(config->shards.count, DISCORD_DEFAULT_SHARD_COUNT),
+            .total = _dc_default(config->shards.total,
+                config->shards.first + _dc_default(config->shards.count, DISCORD_DEFAULT_SHARD_COUNT)),
+        },
+        .session_persist = config->session_persist,
+        .session_max_age = _dc_default(config->session_max_age, DISCORD_DEFAULT_SESSION_MAX_AGE));
 
     // todo: memcheck
 
@@ -55,7 +74,8 @@ static void dc_config_free(discord_config_t *config)
     free(config);
 }
 
-static esp_err_t dc_dispatch_event(discord_handle_t client, discord_event_t event, discord_event_data_ptr_t data_ptr)
+static esp_err_t dc_dispatch_event(
+    discord_handle_t client, uint16_t shard_id, discord_event_t event, discord_event_data_ptr_t data_ptr)
 {
     DISCORD_LOG_FOO();
 
@@ -63,6 +83,7 @@ static esp_err_t dc_dispatch_event(discord_handle_t client, discord_event_t even
 
     discord_event_data_t event_data;
     event_data.client = client;
+    event_data.shard_id = shard_id;
     event_data.ptr = data_ptr;
 
     if ((err = esp_event_post_to(client->event_handle,
@@ -86,94 +107,259 @@ static esp_err_t dc_shutdown(discord_handle_t client)
     DISCORD_LOG_FOO();
 
     client->running = false;
-    dcgw_destroy(client);
+    dcgw_destroy(client); // sessions of all shards are forgotten as well
     dcapi_destroy(client);
-    discord_session_free(client->session);
-    client->session = NULL;
 
     return ESP_OK;
 }
 
+/**
+ * @brief Convert milliseconds to ticks, rounding up so the task never wakes up before the deadline
+ */
+static TickType_t dc_ms_to_ticks(uint64_t ms)
+{
+    uint64_t ticks = (ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    return ticks >= portMAX_DELAY ? portMAX_DELAY : (TickType_t)ticks;
+}
+
+typedef enum
+{
+    DC_RECONNECT_STOP,
+    DC_RECONNECT_IMMEDIATE,
+    DC_RECONNECT_BACKOFF,
+} dc_reconnect_action_t;
+
+/**
+ * @brief Decide what to do after the connection is closed, based on close reason and close code
+ */
+static dc_reconnect_action_t dc_reconnect_action(discord_shard_t *shard)
+{
+    discord_handle_t client = shard->client;
+
+    if (client->config->reconnect.max_attempts > 0
+        && shard->reconnect_attempts >= client->config->reconnect.max_attempts) {
+        DISCORD_LOGE("Giving up after %d reconnect attempts (shard %d)", shard->reconnect_attempts, shard->id);
+        return DC_RECONNECT_STOP;
+    }
+
+    switch (shard->close_reason) {
+        case DISCORD_CLOSE_REASON_RECONNECT: // op 7 or resumable invalid session
+            return DC_RECONNECT_IMMEDIATE;
+
+        case DISCORD_CLOSE_REASON_HEARTBEAT_ACK_NOT_RECEIVED:
+        case DISCORD_CLOSE_REASON_ERROR:
+            return DC_RECONNECT_BACKOFF;
+
+        case DISCORD_CLOSE_REASON_NOT_REQUESTED:
+            break; // depends on close code
+
+        default:
+            DISCORD_LOGW("Disconnection requested but not handled");
+            return DC_RECONNECT_STOP;
+    }
+
+    switch (shard->close_code) {
+        case DISCORD_CLOSEOP_NO_CODE: // network error
+        case DISCORD_CLOSEOP_RATE_LIMITED:
+            return DC_RECONNECT_BACKOFF;
+
+        case DISCORD_CLOSEOP_AUTHENTICATION_FAILED:
+        case DISCORD_CLOSEOP_INVALID_SHARD:
+        case DISCORD_CLOSEOP_SHARDING_REQUIRED:
+        case DISCORD_CLOSEOP_INVALID_API_VERSION:
+        case DISCORD_CLOSEOP_INVALID_INTENTS:
+        case DISCORD_CLOSEOP_DISALLOWED_INTENTS:
+            return DC_RECONNECT_STOP; // reconnecting with the same configuration cannot succeed
+
+        case DISCORD_CLOSEOP_INVALID_SEQ:
+        case DISCORD_CLOSEOP_SESSION_TIMED_OUT:
+            dcgw_session_reset(shard); // session cannot be resumed
+            return DC_RECONNECT_IMMEDIATE;
+
+        default:
+            return DC_RECONNECT_IMMEDIATE;
+    }
+}
+
+/**
+ * @brief Calculate delay before the next reconnect attempt and count the attempt
+ */
+static uint32_t dc_reconnect_delay(discord_shard_t *shard, dc_reconnect_action_t action)
+{
+    discord_reconnect_config_t *policy = &shard->client->config->reconnect;
+    uint16_t attempt = shard->reconnect_attempts++;
+
+    if (action == DC_RECONNECT_IMMEDIATE && attempt == 0) {
+        return 0; // repeated failures fall back to backoff
+    }
+
+    uint32_t delay = policy->min_delay_ms;
+
+    for (uint16_t i = 0; i < attempt && delay < policy->max_delay_ms; i++) {
+        delay *= 2;
+    }
+
+    if (delay > policy->max_delay_ms) {
+        delay = policy->max_delay_ms;
+    }
+
+    // half of the delay is random so devices do not reconnect in lock-step after an outage
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+static uint32_t dc_min_ms(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+/**
+ * @brief Run state machine of one shard
+ * @param out_stop Set to true if shard cannot reconnect and the whole client has to stop
+ * @return Milliseconds until the shard needs to run again. UINT32_MAX if only websocket events can wake it up
+ */
+static uint32_t dc_shard_run(discord_shard_t *shard, bool *out_stop)
+{
+    discord_handle_t client = shard->client;
+    dc_reconnect_action_t reconnect = DC_RECONNECT_STOP;
+
+    switch (shard->state) {
+        case DISCORD_STATE_CONNECTING:
+            dcgw_identify_send_if_due(shard);
+            break;
+
+        case DISCORD_STATE_CONNECTED:
+            shard->reconnect_attempts = 0;
+            dcgw_heartbeat_send_if_expired(shard);
+            dcgw_tx_flush(shard);
+            dcgw_session_checkpoint_if_due(shard);
+            break;
+
+        case DISCORD_STATE_DISCONNECTED:
+            if (shard->reconnect_scheduled) {
+                break; // already handled, waiting for reconnect
+            }
+
+            if (DISCORD_CLOSE_REASON_NOT_REQUESTED == shard->close_reason) {
+                char *close_desc = NULL;
+
+                if (shard->close_code != DISCORD_CLOSEOP_NO_CODE) {
+                    dcgw_get_close_desc(shard, &close_desc);
+                }
+
+                DISCORD_LOGE("Connection closed (shard=%d, code=%d, desc=%s)",
+                    shard->id,
+                    shard->close_code,
+                    shard->close_code == DISCORD_CLOSEOP_NO_CODE ? "NULL" : (close_desc ? close_desc : "NULL"));
+            }
+
+            if ((reconnect = dc_reconnect_action(shard)) == DC_RECONNECT_STOP) {
+                *out_stop = true;
+                return UINT32_MAX;
+            }
+
+            shard->close_code = DISCORD_CLOSEOP_NO_CODE;
+            break;
+
+        case DISCORD_STATE_ERROR:
+            if (shard->reconnect_scheduled) {
+                break; // already handled, waiting for reconnect
+            }
+
+            shard->close_reason = DISCORD_CLOSE_REASON_ERROR; // handled like network error
+
+            if ((reconnect = dc_reconnect_action(shard)) == DC_RECONNECT_STOP) {
+                *out_stop = true;
+                return UINT32_MAX;
+            }
+            break;
+
+        default: // ignore other states
+            break;
+    }
+
+    if (shard->state >= DISCORD_STATE_CONNECTING) {
+        uint32_t wait_ms = dc_min_ms(dcgw_identify_due_ms(shard), dcgw_heartbeat_due_ms(shard));
+        wait_ms = dc_min_ms(wait_ms, dcgw_tx_due_ms(shard));
+
+        return shard->state == DISCORD_STATE_CONNECTED ? dc_min_ms(wait_ms, dcgw_session_checkpoint_due_ms(shard))
+                                                       : wait_ms;
+    }
+
+    if (shard->state <= DISCORD_STATE_DISCONNECTED) {
+        if (!shard->reconnect_scheduled) {
+            if (!dcgw_is_connected(client)) { // whole client is down, other shards still use the pool
+                dcapi_close(client);
+            }
+
+            dcgw_close(shard,
+                shard->state == DISCORD_STATE_ERROR ? DISCORD_CLOSE_REASON_ERROR
+                                                    : shard->close_reason); // do not modify reason if no error
+
+            uint32_t delay = dc_reconnect_delay(shard, reconnect);
+
+            if (delay > 0) {
+                DISCORD_LOGI("Reconnecting shard %d in %" PRIu32 " ms (attempt %d)...",
+                    shard->id,
+                    delay,
+                    shard->reconnect_attempts);
+            }
+
+            shard->reconnect_scheduled = true;
+            shard->reconnect_ms = discord_tick_ms();
+            shard->reconnect_delay_ms = delay;
+        }
+
+        uint64_t elapsed = discord_tick_ms() - shard->reconnect_ms;
+
+        if (elapsed >= shard->reconnect_delay_ms) {
+            shard->reconnect_scheduled = false;
+            DISCORD_SHARD_EVENT_FIRE(shard, DISCORD_EVENT_RECONNECTING, NULL);
+            dcgw_start(shard);
+            return 0; // state is changed, run again
+        }
+
+        return (uint32_t)(shard->reconnect_delay_ms - elapsed);
+    }
+
+    return UINT32_MAX; // websocket is opening and its events will wake the task up
+}
+
 static void dc_task(void *arg)
 {
     DISCORD_LOG_FOO();
 
     discord_handle_t client = (discord_handle_t)arg;
-    bool restart = false;
     bool is_shutted_down = false;
 
     xEventGroupClearBits(client->bits, DISCORD_STOPPED_BIT);
 
     while (client->running) {
-        switch (client->state) {
-            case DISCORD_STATE_CONNECTED:
-                dcgw_heartbeat_send_if_expired(client);
-                break;
-
-            case DISCORD_STATE_DISCONNECTED:
-                if (DISCORD_CLOSE_REASON_NOT_REQUESTED == client->close_reason) {
-                    char *close_desc = NULL;
-
-                    if (client->close_code != DISCORD_CLOSEOP_NO_CODE) {
-                        dcgw_get_close_desc(client, &close_desc);
-                    }
-
-                    DISCORD_LOGE("Connection closed (code=%d, desc=%s)",
-                        client->close_code,
-                        client->close_code == DISCORD_CLOSEOP_NO_CODE ? "NULL" : (close_desc ? close_desc : "NULL"));
-
-                    if (client->close_code == DISCORD_CLOSEOP_AUTHENTICATION_FAILED) {
-                        dc_shutdown(client); // shutdown only on invalid token
-                        is_shutted_down = true;
-                    }
-                    else {
-                        restart = true; // restart in any other case
-                        client->close_code = DISCORD_CLOSEOP_NO_CODE;
-                    }
-                }
-                else if (DISCORD_CLOSE_REASON_HEARTBEAT_ACK_NOT_RECEIVED == client->close_reason) {
-                    restart = true;
-                }
-                else {
-                    DISCORD_LOGW("Disconnection requested but not handled");
-                    dc_shutdown(client);
-                    is_shutted_down = true;
-                }
+        uint32_t wait_ms = UINT32_MAX;
+        bool stop = false;
+        discord_payload_t *payload = NULL;
 
-                break;
+        // control payloads first, so heartbeat ACK is seen before the heartbeat deadline is checked
+        while (dcgw_control_receive(client, &payload)) {
+            dcgw_handle_payload(client, payload);
+        }
 
-            default: // ignore other states
-                break;
+        for (uint16_t i = 0; i < client->shards_len && !stop; i++) {
+            wait_ms = dc_min_ms(wait_ms, dc_shard_run(&client->shards[i], &stop));
         }
 
-        if (is_shutted_down) {
+        if (stop) {
+            dc_shutdown(client);
+            is_shutted_down = true;
             break;
         }
 
-        if (client->state >= DISCORD_STATE_CONNECTING) {
-            discord_payload_t *payload = NULL;
-
-            if (xQueueReceive(client->queue, &payload, 1000 / portTICK_PERIOD_MS) == pdPASS) { // poll every 1 sec
-                dcgw_handle_payload(client, payload);
-            }
-        }
-        else if (client->state <= DISCORD_STATE_DISCONNECTED) {
-            dcapi_destroy(client);
-            dcgw_close(client,
-                client->state == DISCORD_STATE_ERROR ? DISCORD_CLOSE_REASON_ERROR
-                                                     : client->close_reason); // do not modify reason if no error
-
-            if (restart || client->state == DISCORD_STATE_ERROR) {
-                restart = false;
-                DISCORD_LOGI("Restarting discord in 10 sec...");
-                vTaskDelay(10000 / portTICK_PERIOD_MS);
-                DISCORD_EVENT_FIRE(DISCORD_EVENT_RECONNECTING, NULL);
-                dcgw_start(client);
-            }
-        }
-        else {
-            vTaskDelay(125 / portTICK_PERIOD_MS);
+        if (dcgw_queue_receive(client, &payload)) {
+            dcgw_handle_payload(client, payload);
+            continue; // payload may change the state, so check it again before going to sleep
         }
+
+        // sleep until there is work to do or the deadline
+        ulTaskNotifyTake(pdTRUE, wait_ms == UINT32_MAX ? portMAX_DELAY : dc_ms_to_ticks(wait_ms));
     }
 
     if (!is_shutted_down) {
@@ -181,6 +367,7 @@ static void dc_task(void *arg)
     }
 
     DISCORD_EVENT_FIRE(DISCORD_EVENT_DISCONNECTED, NULL);
+    client->task_handle = NULL;
     xEventGroupSetBits(client->bits, DISCORD_STOPPED_BIT);
     DISCORD_LOGD("Task exit.");
     vTaskDelete(NULL);
@@ -190,7 +377,13 @@ discord_handle_t discord_create(const discord_config_t *config)
 {
     DISCORD_LOG_FOO();
 
-    discord_handle_t client = cu_tctor(discord_handle_t, struct discord, .config = dc_config_copy(config));
+    discord_handle_t client = cu_tctor(discord_handle_t,
+        struct discord,
+        .config = dc_config_copy(config),
+        .latency_lock = portMUX_INITIALIZER_UNLOCKED,
+        .queue_stats_lock = portMUX_INITIALIZER_UNLOCKED,
+        .gw_presence_lock = portMUX_INITIALIZER_UNLOCKED,
+        .member_requester = { .lock = portMUX_INITIALIZER_UNLOCKED });
 
     // todo: memcheck
 
@@ -199,6 +392,16 @@ discord_handle_t discord_create(const discord_config_t *config)
         return NULL;
     }
 
+    if (client->config->shards.first + client->config->shards.count > client->config->shards.total) {
+        DISCORD_LOGE("Fail to create Discord. Shards %d..%d are out of total %d shards",
+            client->config->shards.first,
+            client->config->shards.first + client->config->shards.count - 1,
+            client->config->shards.total);
+
+        discord_destroy(client);
+        return NULL;
+    }
+
     if (!client->config->token) {
         DISCORD_LOGE("Fail to create Discord."
                      " Token has not been set."
@@ -267,6 +470,11 @@ esp_err_t discord_login(discord_handle_t client)
     // in case if discord_login is called from different task, and DISCORD_STOPPED_BIT is just raised
     vTaskDelay(50 / portTICK_PERIOD_MS);
 
+    if (dcapi_init(client) != ESP_OK) {
+        DISCORD_LOGE("Fail to init api");
+        return ESP_FAIL;
+    }
+
     client->running = true;
 
     if (xTaskCreate(dc_task,
@@ -278,6 +486,7 @@ esp_err_t discord_login(discord_handle_t client)
         != pdTRUE) {
         DISCORD_LOGE("Fail to create task");
         client->running = false;
+        dcapi_destroy(client);
         return ESP_FAIL;
     }
 
@@ -290,7 +499,7 @@ esp_err_t discord_get_state(discord_handle_t client, discord_gateway_state_t *ou
         return ESP_ERR_INVALID_ARG;
     }
 
-    *out_state = client->state;
+    *out_state = dcgw_get_state(client);
     return ESP_OK;
 }
 
@@ -300,10 +509,63 @@ esp_err_t discord_get_close_code(discord_handle_t client, discord_close_code_t *
         return ESP_ERR_INVALID_ARG;
     }
 
-    *out_code = client->close_code;
+    *out_code = DISCORD_CLOSEOP_NO_CODE;
+
+    for (uint16_t i = 0; client->shards && i < client->shards_len; i++) {
+        if (client->shards[i].close_code != DISCORD_CLOSEOP_NO_CODE) {
+            *out_code = client->shards[i].close_code;
+            break;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t discord_get_gateway_latency(discord_handle_t client, discord_gateway_latency_t *out_latency)
+{
+    if (!client || !out_latency) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&client->latency_lock);
+    *out_latency = client->latency;
+    portEXIT_CRITICAL(&client->latency_lock);
+
+    return out_latency->samples ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t discord_get_queue_stats(discord_handle_t client, discord_queue_stats_t *out_stats)
+{
+    if (!client || !out_stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&client->queue_stats_lock);
+    *out_stats = client->queue_stats;
+    portEXIT_CRITICAL(&client->queue_stats_lock);
+
     return ESP_OK;
 }
 
+/**
+ * @brief Recalculate bitmask of subscribed events. Gateway uses it to drop events nobody listens to before parsing
+ */
+static void dc_update_subscribed_events(discord_handle_t client)
+{
+    uint32_t events[sizeof(client->subscribed_events) / sizeof(client->subscribed_events[0])] = { 0 };
+
+    for (discord_event_subscription_t *sub = client->subscriptions; sub; sub = sub->next) {
+        if (sub->event == DISCORD_EVENT_ANY) {
+            memset(events, 0xFF, sizeof(events));
+        }
+        else if (sub->event >= 0 && sub->event < DISCORD_EVENT_MAX) {
+            events[sub->event / 32] |= 1UL << (sub->event % 32);
+        }
+    }
+
+    memcpy(client->subscribed_events, events, sizeof(events));
+}
+
 esp_err_t discord_register_events(
     discord_handle_t client, discord_event_t event, esp_event_handler_t event_handler, void *event_handler_arg)
 {
@@ -312,11 +574,36 @@ esp_err_t discord_register_events(
 
     DISCORD_LOG_FOO();
 
-    return esp_event_handler_register_with(client->event_handle,
+    esp_err_t err = esp_event_handler_register_with(client->event_handle,
         DISCORD_EVENTS,
         event,
         event_handler,
         event_handler_arg);
+
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (discord_event_subscription_t *sub = client->subscriptions; sub; sub = sub->next) {
+        if (sub->event == event && sub->handler == event_handler) {
+            return ESP_OK; // already registered, event loop just updated the argument
+        }
+    }
+
+    discord_event_subscription_t *sub = cu_ctor(discord_event_subscription_t,
+        .event = event,
+        .handler = event_handler,
+        .next = client->subscriptions);
+
+    if (!sub) {
+        esp_event_handler_unregister_with(client->event_handle, DISCORD_EVENTS, event, event_handler);
+        return ESP_ERR_NO_MEM;
+    }
+
+    client->subscriptions = sub;
+    dc_update_subscribed_events(client);
+
+    return ESP_OK;
 }
 
 esp_err_t discord_unregister_events(discord_handle_t client, discord_event_t event, esp_event_handler_t event_handler)
@@ -329,7 +616,24 @@ esp_err_t discord_unregister_events(discord_handle_t client, discord_event_t eve
         return ESP_OK;
     }
 
-    return esp_event_handler_unregister_with(client->event_handle, DISCORD_EVENTS, event, event_handler);
+    esp_err_t err = esp_event_handler_unregister_with(client->event_handle, DISCORD_EVENTS, event, event_handler);
+
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (discord_event_subscription_t **sub = &client->subscriptions; *sub; sub = &(*sub)->next) {
+        if ((*sub)->event == event && (*sub)->handler == event_handler) {
+            discord_event_subscription_t *removed = *sub;
+            *sub = removed->next;
+            free(removed);
+            break;
+        }
+    }
+
+    dc_update_subscribed_events(client);
+
+    return ESP_OK;
 }
 
 esp_err_t discord_logout(discord_handle_t client)
@@ -344,12 +648,18 @@ esp_err_t discord_logout(discord_handle_t client)
         return ESP_FAIL;
     }
 
+    if (dcapi_is_worker(client)) { // discord task would wait for the worker which waits for the discord task
+        DISCORD_LOGE("Cannot logout from request callback");
+        return ESP_FAIL;
+    }
+
     if (!client->running) {
         DISCORD_LOGW("Not logged in");
         return ESP_OK;
     }
 
     client->running = false;
+    DISCORD_TASK_NOTIFY(client);
     xEventGroupWaitBits(client->bits,
         DISCORD_STOPPED_BIT,
         pdFALSE,
@@ -372,6 +682,11 @@ esp_err_t discord_destroy(discord_handle_t client)
         return ESP_FAIL;
     }
 
+    if (dcapi_is_worker(client)) {
+        DISCORD_LOGE("Cannot destroy from request callback");
+        return ESP_FAIL;
+    }
+
     discord_logout(client);
     client->event_handler = NULL;
 
@@ -380,6 +695,14 @@ esp_err_t discord_destroy(discord_handle_t client)
         client->event_handle = NULL;
     }
 
+    while (client->subscriptions) {
+        discord_event_subscription_t *sub = client->subscriptions;
+        client->subscriptions = sub->next;
+        free(sub);
+    }
+
+    memset(client->subscribed_events, 0, sizeof(client->subscribed_events));
+
     if (client->bits) {
         vEventGroupDelete(client->bits);
         client->bits = NULL;
@@ -387,6 +710,9 @@ esp_err_t discord_destroy(discord_handle_t client)
 
     discord_ota_destroy(client);
 
+    free(client->api_worker_tasks);
+    client->api_worker_tasks = NULL;
+
     dc_config_free(client->config);
     client->config = NULL;
     free(client);
@@ -396,8 +722,5 @@ esp_err_t discord_destroy(discord_handle_t client)
 
 uint64_t discord_tick_ms()
 {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-
-    return (uint32_t)((now.tv_sec * 1000000 + now.tv_usec) / 1000);
+    return (uint64_t)esp_timer_get_time() / 1000; // monotonic, wall clock wraps in uint32_t and jumps with SNTP
 }
@@ -7,6 +7,16 @@
 
 DISCORD_LOG_DEFINE_BASE();
 
+static void *dc_channel_parse(const char *data, int data_len)
+{
+    return discord_json_deserialize_(channel, data, data_len);
+}
+
+static void dc_channel_free(void *channel)
+{
+    discord_channel_free(channel);
+}
+
 esp_err_t discord_guild_get_channels(
     discord_handle_t client, discord_guild_t *guild, discord_channel_t ***out_channels, int *out_length)
 {
@@ -16,18 +26,22 @@ esp_err_t discord_guild_get_channels(
     }
 
     esp_err_t err = ESP_OK;
-    discord_api_response_t *res = NULL;
-
-    if ((err = dcapi_get(client, estr_cat("/guilds/", guild->id, "/channels"), NULL, &res)) != ESP_OK) {
+    void **list = NULL;
+    int len = 0;
+
+    if ((err = dcapi_get_list(client,
+             estr_cat("/guilds/", guild->id, "/channels"),
+             dc_channel_parse,
+             dc_channel_free,
+             &list,
+             &len))
+        != ESP_OK) {
         DISCORD_LOGE("Fail to fetch channels");
         return err;
     }
 
-    if (dcapi_response_is_success(res) && res->data_len > 0) {
-        *out_channels = discord_json_list_deserialize_(channel, res->data, res->data_len, out_length);
-    }
-
-    dcapi_response_free(client, res);
+    *out_channels = (discord_channel_t **)list;
+    *out_length = len;
 
     return err;
 }
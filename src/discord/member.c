@@ -1,6 +1,7 @@
 #include "discord/member.h"
 #include "discord/private/_discord.h"
 #include "discord/private/_api.h"
+#include "discord/private/_gateway.h"
 #include "discord/private/_json.h"
 #include "cutils.h"
 #include "estr.h"
@@ -32,6 +33,38 @@ esp_err_t discord_member_get(discord_handle_t client, char *guild_id, char *user
     return err;
 }
 
+static void *dc_member_parse(const char *data, int data_len)
+{
+    return discord_json_deserialize_(member, data, data_len);
+}
+
+esp_err_t discord_member_get_async(discord_handle_t client, const char *guild_id, const char *user_id,
+    discord_request_callback_t callback, void *arg)
+{
+    if (!client || !guild_id || !user_id) {
+        DISCORD_LOGE("Invalid args");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return dcapi_request_async(client,
+        HTTP_METHOD_GET,
+        dcapi_create_request(estr_cat("/guilds/", guild_id, "/members/", user_id), NULL),
+        dc_member_parse,
+        callback,
+        arg);
+}
+
+esp_err_t discord_member_request(
+    discord_handle_t client, discord_member_request_t *request, discord_member_handler_t handler, void *arg)
+{
+    if (!client || !request || !request->guild_id || !handler) {
+        DISCORD_LOGE("Invalid args");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return dcgw_member_request(client, request, handler, arg);
+}
+
 static bool dc_member_permissions_calc(discord_handle_t client, discord_member_t *member, discord_role_t **roles,
     discord_role_len_t roles_len, uint64_t permissions)
 {
@@ -137,8 +170,19 @@ void discord_member_free(discord_member_t *member)
     if (!member)
         return;
 
+    discord_user_free(member->user);
     free(member->nick);
     free(member->permissions);
     cu_list_free(member->roles, member->_roles_len);
     free(member);
 }
+
+void discord_member_chunk_free(discord_member_chunk_t *chunk)
+{
+    if (!chunk)
+        return;
+
+    free(chunk->guild_id);
+    free(chunk->nonce);
+    free(chunk);
+}
@@ -18,13 +18,8 @@ static discord_api_multipart_t *discord_message_create_multipart_from_attachment
         .data_should_be_freed = attachment->_data_should_be_freed, );
 }
 
-esp_err_t discord_message_send(discord_handle_t client, discord_message_t *message, discord_message_t **out_result)
+static discord_api_request_t *discord_message_create_request(discord_message_t *message)
 {
-    if (!client || !message || !message->channel_id) {
-        DISCORD_LOGE("Invalid args");
-        return ESP_ERR_INVALID_ARG;
-    }
-
     discord_api_request_t *req =
         dcapi_create_request(estr_cat("/channels/", message->channel_id, "/messages"), discord_json_serialize(message));
 
@@ -32,6 +27,32 @@ esp_err_t discord_message_send(discord_handle_t client, discord_message_t *messa
         dcapi_add_multipart_to_request(discord_message_create_multipart_from_attachment(message->attachments[i]), req);
     }
 
+    return req;
+}
+
+static char *discord_message_reaction_uri(discord_message_t *message, const char *emoji)
+{
+    char *_emoji = estr_url_encode(emoji);
+    char *uri = estr_cat("/channels/", message->channel_id, "/messages/", message->id, "/reactions/", _emoji, "/@me");
+    free(_emoji);
+
+    return uri;
+}
+
+static void *discord_message_parse(const char *data, int data_len)
+{
+    return discord_json_deserialize_(message, data, data_len);
+}
+
+esp_err_t discord_message_send(discord_handle_t client, discord_message_t *message, discord_message_t **out_result)
+{
+    if (!client || !message || !message->channel_id) {
+        DISCORD_LOGE("Invalid args");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    discord_api_request_t *req = discord_message_create_request(message);
+
     discord_api_response_t *res = NULL;
     esp_err_t err = dcapi_request(client, HTTP_METHOD_POST, req, &res);
     discord_api_request_free(req);
@@ -65,16 +86,82 @@ esp_err_t discord_message_react(discord_handle_t client, discord_message_t *mess
         return ESP_FAIL;
     }
 
-    char *_emoji = estr_url_encode(emoji);
-    esp_err_t err = dcapi_put(client,
-        estr_cat("/channels/", message->channel_id, "/messages/", message->id, "/reactions/", _emoji, "/@me"),
-        NULL,
-        NULL);
-    free(_emoji);
+    return dcapi_put(client, discord_message_reaction_uri(message, emoji), NULL, NULL);
+}
+
+esp_err_t discord_message_send_async(
+    discord_handle_t client, discord_message_t *message, discord_request_callback_t callback, void *arg)
+{
+    if (!client || !message || !message->channel_id) {
+        DISCORD_LOGE("Invalid args");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    discord_api_request_t *req = discord_message_create_request(message);
+    uint8_t first = req->multiparts_len - message->_attachments_len; // attachments follow the payload
+
+    // request outlives the message, so it gets its own copy of borrowed data first (this can fail)...
+    for (uint8_t i = 0; i < message->_attachments_len; i++) {
+        discord_api_multipart_t *mpart = req->multiparts[first + i];
+
+        if (message->attachments[i]->_data_should_be_freed || !mpart->data) {
+            continue;
+        }
+
+        char *data = malloc(mpart->len);
+
+        if (!data) {
+            discord_api_request_free(req);
+            return ESP_ERR_NO_MEM;
+        }
+
+        memcpy(data, mpart->data, mpart->len);
+        mpart->data = data;
+        mpart->data_should_be_freed = true;
+    }
+
+    esp_err_t err = dcapi_request_async_keep(client, HTTP_METHOD_POST, req, discord_message_parse, callback, arg);
+
+    // ...and takes over the data owned by the message, but only once it is queued
+    for (uint8_t i = 0; i < message->_attachments_len; i++) {
+        discord_attachment_t *attachment = message->attachments[i];
+
+        if (!attachment->_data_should_be_freed) {
+            continue;
+        }
+
+        if (err == ESP_OK) {
+            attachment->_data = NULL;
+            attachment->_data_should_be_freed = false;
+        }
+        else {
+            req->multiparts[first + i]->data_should_be_freed = false; // message keeps its data
+        }
+    }
+
+    if (err != ESP_OK) {
+        discord_api_request_free(req);
+    }
 
     return err;
 }
 
+esp_err_t discord_message_react_async(discord_handle_t client, discord_message_t *message, const char *emoji,
+    discord_request_callback_t callback, void *arg)
+{
+    if (!client || !message || !message->id || !message->channel_id || !emoji) {
+        DISCORD_LOGE("Invalid args");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return dcapi_request_async(client,
+        HTTP_METHOD_PUT,
+        dcapi_create_request(discord_message_reaction_uri(message, emoji), NULL),
+        NULL,
+        callback,
+        arg);
+}
+
 esp_err_t discord_message_download_attachment(discord_handle_t client, discord_message_t *message,
     uint8_t attachment_index, discord_download_handler_t download_handler, void *arg)
 {
@@ -0,0 +1,27 @@
+#include "discord/presence.h"
+#include "discord/private/_discord.h"
+#include "discord/private/_gateway.h"
+#include "discord/private/_json_writer.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+esp_err_t discord_presence_update(discord_handle_t client, discord_presence_t *presence)
+{
+    if (!client || !presence || (presence->activity && !presence->activity->name)) {
+        DISCORD_LOGE("Invalid args");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    discord_payload_t *payload = &(discord_payload_t) {
+        .op = DISCORD_OP_PRESENCE_UPDATE,
+        .d = presence,
+    };
+
+    char *payload_raw = discord_json_write_payload_alloc(payload);
+
+    if (!payload_raw) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return dcgw_presence_set(client, payload_raw);
+}
@@ -1,4 +1,6 @@
+#include <inttypes.h>
 #include "discord/private/_discord.h"
+#include "discord/private/_gateway.h"
 #include "discord/private/_api.h"
 #include "cutils.h"
 #include "estr.h"
@@ -20,15 +22,27 @@ esp_err_t dcapi_response_to_esp_err(discord_api_response_t *res)
     return res && dcapi_response_is_success(res) ? ESP_OK : ESP_FAIL;
 }
 
+/**
+ * @brief Give connection back to the pool
+ */
+static void dcapi_connection_release(discord_handle_t client, dcapi_connection_t *conn)
+{
+    xSemaphoreTake(client->api_lock, portMAX_DELAY);
+    conn->busy = false;
+    xSemaphoreGive(client->api_lock);
+    xSemaphoreGive(client->api_idle);
+}
+
 esp_err_t dcapi_response_free(discord_handle_t client, discord_api_response_t *res)
 {
     if (!client || !res)
         return ESP_ERR_INVALID_ARG;
 
-    if (res->data || res->data_len > 0) {
-        client->api_buffer_size = 0;
-        res->data = NULL; // do not free() res->data because it holds addr of internal api buffer
+    if (res->connection) {
+        res->connection->buffer_size = 0;
+        res->data = NULL; // do not free() res->data because it holds addr of connection buffer
         res->data_len = 0;
+        dcapi_connection_release(client, res->connection);
     }
 
     free(res);
@@ -36,16 +50,16 @@ esp_err_t dcapi_response_free(discord_handle_t client, discord_api_response_t *r
     return ESP_OK;
 }
 
-static esp_err_t dcapi_flush_http(discord_handle_t client, bool record)
+static esp_err_t dcapi_flush_http(dcapi_connection_t *conn, bool record)
 {
     DISCORD_LOG_FOO();
 
-    client->api_buffer_record = record;
-    esp_err_t err = esp_http_client_flush_response(client->http, NULL);
-    client->api_buffer_record = false;
+    conn->buffer_record = record;
+    esp_err_t err = esp_http_client_flush_response(conn->http, NULL);
+    conn->buffer_record = false;
 
     if (!record) {
-        client->api_buffer_size = 0;
+        conn->buffer_size = 0;
     }
 
     return err;
@@ -53,25 +67,39 @@ static esp_err_t dcapi_flush_http(discord_handle_t client, bool record)
 
 static esp_err_t dcapi_on_http_event(esp_http_client_event_t *evt)
 {
-    discord_handle_t client = (discord_handle_t)evt->user_data;
+    dcapi_connection_t *conn = (dcapi_connection_t *)evt->user_data;
 
-    if (evt->event_id != HTTP_EVENT_ON_DATA || evt->data_len <= 0 || !client->api_buffer_record)
+    if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        discord_ratelimit_headers_set(&conn->ratelimit_headers, evt->header_key, evt->header_value);
+        return ESP_OK;
+    }
+
+    if (evt->event_id != HTTP_EVENT_ON_DATA || evt->data_len <= 0 || !conn->buffer_record)
         return ESP_OK;
 
     DISCORD_LOGD("Buffering chunk (data_len=%d, data=%.*s)", evt->data_len, evt->data_len, (char *)evt->data);
 
-    if (client->api_buffer_size + evt->data_len > client->config->api_buffer_size) { // prevent buffer overflow
+    if (conn->splitter) { // list response is decoded on the fly, buffer is not used
+        if (discord_json_splitter_write(conn->splitter, evt->data, evt->data_len) != ESP_OK) {
+            conn->buffer_record_status = ESP_FAIL;
+            return ESP_FAIL;
+        }
+
+        return ESP_OK;
+    }
+
+    if (conn->buffer_size + evt->data_len > conn->client->config->api_buffer_size) { // prevent buffer overflow
         DISCORD_LOGW("Chunk (size=%d) cannot fit into api buffer (current_len=%d, max_len=%d)",
             evt->data_len,
-            client->api_buffer_size,
-            client->config->api_buffer_size);
-        client->api_buffer_record_status = ESP_FAIL;
-        // client->api_buffer_size = 0;
+            conn->buffer_size,
+            conn->client->config->api_buffer_size);
+        conn->buffer_record_status = ESP_FAIL;
+        // conn->buffer_size = 0;
         return ESP_FAIL;
     }
 
-    memcpy(client->api_buffer + client->api_buffer_size, evt->data, evt->data_len);
-    client->api_buffer_size += evt->data_len;
+    memcpy(conn->buffer + conn->buffer_size, evt->data, evt->data_len);
+    conn->buffer_size += evt->data_len;
 
     return ESP_OK;
 }
@@ -79,19 +107,19 @@ static esp_err_t dcapi_on_http_event(esp_http_client_event_t *evt)
 /**
  * @return ESP_OK if user has not break stream of upcoming chunks
  */
-static esp_err_t dcapi_download_handler_fire(discord_handle_t client, void *data, size_t length)
+static esp_err_t dcapi_download_handler_fire(dcapi_connection_t *conn, void *data, size_t length)
 {
-    if (!client || !client->api_download_handler) {
+    if (!conn || !conn->download_handler) {
         return ESP_ERR_INVALID_ARG;
     }
 
     discord_download_info_t info = { .data = data,
         .length = length,
-        .offset = client->api_download_offset,
-        .total_length = client->api_download_total };
+        .offset = conn->download_offset,
+        .total_length = conn->download_total };
 
-    esp_err_t err = client->api_download_handler(&info, client->api_download_arg);
-    client->api_download_offset += length;
+    esp_err_t err = conn->download_handler(&info, conn->download_arg);
+    conn->download_offset += length;
 
     return err;
 }
@@ -101,51 +129,74 @@ static esp_err_t dcapi_on_download(esp_http_client_event_t *evt)
     if (evt->event_id != HTTP_EVENT_ON_DATA)
         return ESP_OK;
 
-    discord_handle_t client = (discord_handle_t)evt->user_data;
+    dcapi_connection_t *conn = (dcapi_connection_t *)evt->user_data;
 
-    if (!client->api_download_mode)
+    if (!conn->download_mode)
         return ESP_OK;
 
-    if (client->api_buffer_record
-        && client->api_buffer_size + evt->data_len > client->config->api_buffer_size) { // prevent buffer overflow
+    if (conn->buffer_record
+        && conn->buffer_size + evt->data_len > conn->client->config->api_buffer_size) { // prevent buffer overflow
         DISCORD_LOGW("Chunk (size=%d) cannot fit into api buffer (current_len=%d, max_len=%d)",
             evt->data_len,
-            client->api_buffer_size,
-            client->config->api_buffer_size);
-        client->api_buffer_record_status = ESP_FAIL;
-        // client->api_buffer_size = 0;
+            conn->buffer_size,
+            conn->client->config->api_buffer_size);
+        conn->buffer_record_status = ESP_FAIL;
+        // conn->buffer_size = 0;
         return ESP_FAIL;
     }
 
     DISCORD_LOGD("on_download (data_len=%d [%d/%d])",
         evt->data_len,
-        client->api_download_offset + evt->data_len,
-        client->api_download_total);
+        conn->download_offset + evt->data_len,
+        conn->download_total);
 
-    if (client->api_buffer_record) {
-        memcpy(client->api_buffer + client->api_buffer_size, evt->data, evt->data_len);
-        client->api_buffer_size += evt->data_len;
+    if (conn->buffer_record) {
+        memcpy(conn->buffer + conn->buffer_size, evt->data, evt->data_len);
+        conn->buffer_size += evt->data_len;
     }
-    else if (dcapi_download_handler_fire(client, evt->data, evt->data_len) != ESP_OK) {
+    else if (conn->download_handler && dcapi_download_handler_fire(conn, evt->data, evt->data_len) != ESP_OK) {
         esp_http_client_close(evt->client); // user break chunk stream
     }
 
     return ESP_OK;
 }
 
-static esp_err_t dcapi_init_lazy(discord_handle_t client, bool download, const char *url)
+static void dcapi_connection_destroy(dcapi_connection_t *conn)
 {
-    if (client->http != NULL)
+    if (conn->http) {
+        dcapi_flush_http(conn, false);
+        esp_http_client_close(conn->http);
+        esp_http_client_cleanup(conn->http);
+        conn->http = NULL;
+    }
+
+    free(conn->buffer);
+    conn->buffer = NULL;
+    conn->buffer_size = 0;
+    free(conn->host);
+    conn->host = NULL;
+    conn->buffer_record = false;
+
+    conn->download_mode = false;
+    conn->download_handler = NULL;
+    conn->download_arg = NULL;
+    conn->download_offset = 0;
+    conn->download_total = 0;
+}
+
+/**
+ * @brief Create http client of the connection if it does not exist yet. It stays open (keep-alive) between requests
+ */
+static esp_err_t dcapi_connection_init(dcapi_connection_t *conn, bool download, const char *url)
+{
+    if (conn->http != NULL)
         return ESP_OK;
 
     DISCORD_LOG_FOO();
 
-    if (client->state < DISCORD_STATE_CONNECTED) {
-        DISCORD_LOGW("API can be initialized only if client is in CONNECTED state");
-        return ESP_FAIL;
-    }
+    discord_handle_t client = conn->client;
 
-    client->api_download_mode = download;
+    conn->download_mode = download;
 
 #ifndef CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY
     extern const uint8_t api_crt[] asm("_binary_api_pem_start");
@@ -153,38 +204,37 @@ static esp_err_t dcapi_init_lazy(discord_handle_t client, bool download, const c
 
     esp_http_client_config_t config = { .url = download ? url : DISCORD_API_URL,
         .is_async = false,
-        .keep_alive_enable = !download,
+        .keep_alive_enable = true,
         .event_handler = download ? dcapi_on_download : dcapi_on_http_event,
-        .user_data = client,
+        .user_data = conn,
         .timeout_ms = client->config->api_timeout_ms,
 #ifndef CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY
         .cert_pem = (const char *)api_crt
 #endif
     };
 
-    client->api_buffer_record_status = ESP_OK;
+    conn->buffer_record_status = ESP_OK;
 
-    if (!(client->api_lock = xSemaphoreCreateMutex()) || !(client->api_buffer = malloc(client->config->api_buffer_size))
-        || !(client->http = esp_http_client_init(&config))) {
-        DISCORD_LOGW("Cannot allocate api. No memory.");
-        dcapi_destroy(client);
+    if (!(conn->buffer = malloc(client->config->api_buffer_size)) || !(conn->http = esp_http_client_init(&config))) {
+        DISCORD_LOGW("Cannot allocate api connection. No memory.");
+        dcapi_connection_destroy(conn);
         return ESP_FAIL;
     }
 
     char *user_agent = estr_cat("DiscordBot (esp-discord, " CONFIG_IDF_TARGET ") esp-idf/", esp_get_idf_version());
     // todo: memcheck
-    esp_http_client_set_header(client->http, "User-Agent", user_agent);
+    esp_http_client_set_header(conn->http, "User-Agent", user_agent);
     // todo: error check
     free(user_agent);
 
     if (!download) {
         char *auth = estr_cat("Bot ", client->config->token);
         // todo: memcheck
-        esp_http_client_set_header(client->http, "Authorization", auth);
+        esp_http_client_set_header(conn->http, "Authorization", auth);
         // todo: error check
         free(auth);
 
-        esp_http_client_set_header(client->http,
+        esp_http_client_set_header(conn->http,
             "Content-Type",
             "multipart/form-data; boundary=\"" DCAPI_REQUEST_BOUNDARY "\"");
         // todo: error check
@@ -229,6 +279,247 @@ static int dcapi_calculate_request_length(discord_api_request_t *request)
     return length;
 }
 
+static void dcapi_write_multiparts(esp_http_client_handle_t http, discord_api_request_t *request)
+{
+    DISCORD_LOGD("Sending multiparts...");
+
+    for (uint8_t i = 0; i < request->multiparts_len; i++) {
+        discord_api_multipart_t *mpart = request->multiparts[i];
+
+        char *filename_piece = NULL;
+
+        if (mpart->filename) {
+            filename_piece = estr_cat("; filename=\"", mpart->filename, "\"");
+        }
+
+        char *boundary = estr_cat((i > 0 ? "\n" : ""),
+            "--" DCAPI_REQUEST_BOUNDARY "\nContent-Disposition: form-data; name=\"",
+            mpart->name,
+            "\"",
+            (mpart->filename ? filename_piece : ""),
+            "\nContent-Type: ",
+            mpart->mime_type,
+            "\n\n");
+
+        free(filename_piece);
+
+        DISCORD_LOGD("%.*s", strlen(boundary), boundary);
+        esp_http_client_write(http, boundary, strlen(boundary)); // TODO: check result
+        free(boundary);
+
+        if (estr_eq(mpart->name, "payload_json")) {
+            DISCORD_LOGD("%.*s", mpart->len, mpart->data);
+        }
+        else {
+            DISCORD_LOGD("Sending binary multipart data [size: %d]", mpart->len);
+        }
+
+        esp_http_client_write(http, mpart->data, mpart->len); // TODO: check result
+    }
+
+    const char *multipart_end = "\n--" DCAPI_REQUEST_BOUNDARY "--";
+    DISCORD_LOGD("%.*s", strlen(multipart_end), multipart_end);
+    esp_http_client_write(http, multipart_end, strlen(multipart_end)); // TODO: check result
+
+    // if(... == ESP_FAIL) {
+    //     DISCORD_LOGW("Fail to write data to request");
+    //     xSemaphoreGive(client->api_lock);
+    //     return ESP_FAIL;
+    // }
+}
+
+/**
+ * @brief Automatic payload freeing is an optimization in order to free-up the memory for incoming response.
+ *        Payload is kept until it is certain that the request will not be sent again because of 429
+ */
+static void dcapi_free_payload(discord_api_request_t *request)
+{
+    if (request->disable_auto_payload_free || request->multiparts_len == 0) {
+        return;
+    }
+
+    discord_api_multipart_t *mpart = request->multiparts[0];
+
+    if (mpart->data && estr_eq(mpart->name, "payload_json")) {
+        DISCORD_LOGD("Freeing payload multipart data");
+        free(mpart->data);
+        mpart->data = NULL;
+        mpart->len = 0;
+    }
+}
+
+typedef struct
+{
+    discord_api_request_t *request;
+    void **items;
+    int len;
+    int capacity;
+    esp_err_t err; /*<! First failure. Rest of the elements is skipped after it */
+} dcapi_list_t;
+
+static void dcapi_list_on_element(void *arg, char *element, size_t len)
+{
+    dcapi_list_t *list = (dcapi_list_t *)arg;
+
+    if (list->err != ESP_OK) {
+        return;
+    }
+
+    if (list->len == list->capacity) {
+        int capacity = list->capacity > 0 ? list->capacity * 2 : 8;
+        void **items = realloc(list->items, capacity * sizeof(void *));
+
+        if (!items) {
+            DISCORD_LOGW("No memory for the list");
+            list->err = ESP_ERR_NO_MEM;
+            return;
+        }
+
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    void *item = list->request->list_parser(element, len);
+
+    if (!item) {
+        list->err = ESP_ERR_INVALID_RESPONSE;
+        return;
+    }
+
+    list->items[list->len++] = item;
+}
+
+/**
+ * @brief Decode JSON array of successful response element by element, while its chunks are flushed.
+ *        First chunk which came with headers is already in the buffer, others go straight through the splitter,
+ *        so only a single element is held in the memory at once
+ */
+static esp_err_t dcapi_flush_list(dcapi_connection_t *conn, discord_api_request_t *request, discord_api_response_t *res)
+{
+    dcapi_list_t list = { .request = request };
+    discord_json_splitter_config_t config = {
+        .element_size = conn->client->config->api_buffer_size,
+        .element_cb = dcapi_list_on_element,
+        .arg = &list,
+    };
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    if ((conn->splitter = discord_json_splitter_create(&config))) {
+        err = discord_json_splitter_write(conn->splitter, conn->buffer, conn->buffer_size);
+    }
+
+    conn->buffer_size = 0;
+    dcapi_flush_http(conn, err == ESP_OK);
+
+    if (err == ESP_OK) {
+        err = conn->buffer_record_status;
+    }
+
+    if (err == ESP_OK) {
+        err = list.err;
+    }
+
+    if (err == ESP_OK && discord_json_splitter_dropped(conn->splitter) > 0) {
+        err = ESP_ERR_INVALID_SIZE; // required larger buffer
+    }
+
+    discord_json_splitter_free(conn->splitter);
+    conn->splitter = NULL;
+
+    if (err != ESP_OK) {
+        DISCORD_LOGW("Fail to decode list response");
+
+        for (int i = 0; request->list_free && i < list.len; i++) {
+            request->list_free(list.items[i]);
+        }
+
+        free(list.items);
+        return err;
+    }
+
+    res->list = list.items;
+    res->list_len = list.len;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Time the request may spend waiting for rate limits. Client task must not sleep at all, otherwise heartbeats
+ *        of all shards are missed, and the other synchronous callers are held only shortly.
+ *        Long waits are left to the api workers
+ */
+static uint32_t dcapi_wait_budget(discord_handle_t client, discord_api_request_t *request)
+{
+    if (request->async) {
+        return DISCORD_RATELIMIT_MAX_WAIT;
+    }
+
+    return xTaskGetCurrentTaskHandle() == client->task_handle ? 0 : DISCORD_RATELIMIT_MAX_SYNC_WAIT;
+}
+
+/**
+ * @brief Wait until the rate limits let request of the route go out, then take an idle connection of the pool.
+ *        Nothing is held while waiting, so requests of other routes are not blocked
+ * @param wait_budget Milliseconds left for waiting, decreased by the time waited
+ */
+static esp_err_t dcapi_connection_acquire(
+    discord_handle_t client, uint32_t route, uint32_t *wait_budget, dcapi_connection_t **out_conn)
+{
+    TickType_t timeout = client->config->api_timeout_ms / portTICK_PERIOD_MS;
+
+    while (true) {
+        if (!client->api_lock) { // api destroyed while waiting
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        if (xSemaphoreTake(client->api_lock, timeout) != pdTRUE) {
+            DISCORD_LOGW("Api is locked");
+            return ESP_FAIL;
+        }
+
+        uint32_t wait_ms = discord_ratelimit_acquire(&client->api_ratelimit, route, discord_tick_ms());
+        xSemaphoreGive(client->api_lock);
+
+        if (wait_ms == 0) {
+            break;
+        }
+
+        if (wait_ms > *wait_budget) {
+            DISCORD_LOGW("Rate limited for %" PRIu32 " ms, giving up", wait_ms);
+            return ESP_ERR_TIMEOUT;
+        }
+
+        DISCORD_LOGD("Rate limited, waiting %" PRIu32 " ms", wait_ms);
+        *wait_budget -= wait_ms;
+        vTaskDelay(wait_ms / portTICK_PERIOD_MS + 1);
+    }
+
+    if (xSemaphoreTake(client->api_idle, timeout) != pdTRUE) {
+        DISCORD_LOGW("All api connections are busy");
+        return ESP_FAIL;
+    }
+
+    dcapi_connection_t *conn = NULL;
+
+    xSemaphoreTake(client->api_lock, portMAX_DELAY);
+
+    for (uint8_t i = 0; i < client->api_pool_len; i++) {
+        dcapi_connection_t *candidate = &client->api_pool[i];
+
+        if (!candidate->busy && (!conn || (candidate->http && !conn->http))) { // prefer already open connection
+            conn = candidate;
+        }
+    }
+
+    conn->busy = true; // there is always idle connection if api_idle is taken
+    xSemaphoreGive(client->api_lock);
+
+    *out_conn = conn;
+
+    return ESP_OK;
+}
+
 esp_err_t dcapi_request(discord_handle_t client, esp_http_client_method_t method, discord_api_request_t *request,
     discord_api_response_t **out_response)
 {
@@ -236,23 +527,20 @@ esp_err_t dcapi_request(discord_handle_t client, esp_http_client_method_t method
 
     bool stream_response = out_response != NULL;
 
-    esp_err_t err;
+    esp_err_t err = ESP_OK;
 
-    if ((err = dcapi_init_lazy(client, false, NULL)) != ESP_OK) { // will just return ESP_OK if already initialized
-        DISCORD_LOGW("Cannot initialize API");
-        return err;
+    if (!client->api_pool) {
+        DISCORD_LOGW("API is not initialized");
+        return ESP_ERR_INVALID_STATE;
     }
 
-    if (xSemaphoreTake(client->api_lock, client->config->api_timeout_ms / portTICK_PERIOD_MS) != pdTRUE) {
-        DISCORD_LOGW("Api is locked");
+    if (!dcgw_is_connected(client)) {
+        DISCORD_LOGW("API can be used only if client (any of its shards) is in CONNECTED state");
         return ESP_FAIL;
     }
 
-    esp_http_client_handle_t http = client->http;
-
-    client->api_buffer_record =
-        true; // always record first chunk which comes with headers because maybe will need to record error
-    client->api_buffer_record_status = ESP_OK;
+    uint32_t major;
+    uint32_t route = discord_ratelimit_route(method, request->uri, &major);
 
     char *url = estr_cat(DISCORD_API_URL, request->uri);
     // todo: memcheck
@@ -260,134 +548,139 @@ esp_err_t dcapi_request(discord_handle_t client, esp_http_client_method_t method
         free(request->uri);
         request->uri = NULL;
     }
-    esp_http_client_set_url(http, url);
-    // todo: error check
-    free(url);
-
-    esp_http_client_set_method(http, method);
-    // todo: error check
 
     int len = dcapi_calculate_request_length(request);
+    uint32_t wait_budget = dcapi_wait_budget(client, request);
+    discord_api_response_t *res = NULL;
 
-    bool connection_open = false;
-    const uint8_t open_attempts = 3;
-    uint8_t open_attempt = 0;
+    for (uint8_t attempt = 1;; attempt++) {
+        dcapi_connection_t *conn = NULL;
 
-    while (!connection_open && ++open_attempt <= open_attempts) {
-        DISCORD_LOGD("Opening connection (attempt %d)...", open_attempt);
-
-        if ((err = esp_http_client_open(http, len)) == ESP_OK) {
-            connection_open = true;
-        }
-        else {
-            DISCORD_LOGW("Fail to open connection");
+        if ((err = dcapi_connection_acquire(client, route, &wait_budget, &conn)) != ESP_OK) {
+            break;
         }
-    }
-
-    if (err != ESP_OK) { // connection closed
-        xSemaphoreGive(client->api_lock);
-        return err;
-    }
-
-    if (len > 0) {
-        DISCORD_LOGD("Sending multiparts...");
 
-        for (uint8_t i = 0; i < request->multiparts_len; i++) {
-            discord_api_multipart_t *mpart = request->multiparts[i];
+        if ((err = dcapi_connection_init(conn, false, NULL)) != ESP_OK) {
+            DISCORD_LOGW("Cannot initialize API");
+            dcapi_connection_release(client, conn);
+            break;
+        }
 
-            char *filename_piece = NULL;
+        esp_http_client_handle_t http = conn->http;
 
-            if (mpart->filename) {
-                filename_piece = estr_cat("; filename=\"", mpart->filename, "\"");
-            }
+        conn->buffer_record =
+            true; // always record first chunk which comes with headers because maybe will need to record error
+        conn->buffer_record_status = ESP_OK;
+        discord_ratelimit_headers_reset(&conn->ratelimit_headers);
 
-            char *boundary = estr_cat((i > 0 ? "\n" : ""),
-                "--" DCAPI_REQUEST_BOUNDARY "\nContent-Disposition: form-data; name=\"",
-                mpart->name,
-                "\"",
-                (mpart->filename ? filename_piece : ""),
-                "\nContent-Type: ",
-                mpart->mime_type,
-                "\n\n");
+        esp_http_client_set_url(http, url);
+        // todo: error check
+        esp_http_client_set_method(http, method);
+        // todo: error check
 
-            free(filename_piece);
+        bool connection_open = false;
+        const uint8_t open_attempts = 3;
+        uint8_t open_attempt = 0;
 
-            DISCORD_LOGD("%.*s", strlen(boundary), boundary);
-            esp_http_client_write(http, boundary, strlen(boundary)); // TODO: check result
-            free(boundary);
+        while (!connection_open && ++open_attempt <= open_attempts) {
+            DISCORD_LOGD("Opening connection (attempt %d)...", open_attempt);
 
-            if (estr_eq(mpart->name, "payload_json")) {
-                DISCORD_LOGD("%.*s", mpart->len, mpart->data);
+            if ((err = esp_http_client_open(http, len)) == ESP_OK) {
+                connection_open = true;
             }
             else {
-                DISCORD_LOGD("Sending binary multipart data [size: %d]", mpart->len);
+                DISCORD_LOGW("Fail to open connection");
             }
+        }
 
-            esp_http_client_write(http, mpart->data, mpart->len); // TODO: check result
+        if (err != ESP_OK) { // connection closed
+            dcapi_connection_release(client, conn);
+            break;
+        }
 
-            // Automatic payload freeing is an optimization in order to free-up the memory for incoming response
-            if (!request->disable_auto_payload_free && i == 0 && estr_eq(mpart->name, "payload_json")) {
-                DISCORD_LOGD("Freeing payload multipart data");
-                free(mpart->data);
-                mpart->data = NULL;
-                mpart->len = 0;
-            }
+        if (len > 0) {
+            dcapi_write_multiparts(http, request);
         }
 
-        const char *multipart_end = "\n--" DCAPI_REQUEST_BOUNDARY "--";
-        DISCORD_LOGD("%.*s", strlen(multipart_end), multipart_end);
-        esp_http_client_write(http, multipart_end, strlen(multipart_end)); // TODO: check result
+        DISCORD_LOGD("Sending request and fetching response...");
 
-        // if(... == ESP_FAIL) {
-        //     DISCORD_LOGW("Fail to write data to request");
-        //     xSemaphoreGive(client->api_lock);
-        //     return ESP_FAIL;
-        // }
-    }
+        if (esp_http_client_fetch_headers(http) == ESP_FAIL) {
+            DISCORD_LOGW("Fail to fetch headers");
+            dcapi_flush_http(conn, false);
+            dcapi_connection_release(client, conn);
+            err = ESP_FAIL;
+            break;
+        }
 
-    DISCORD_LOGD("Sending request and fetching response...");
+        int code = esp_http_client_get_status_code(http);
 
-    if (esp_http_client_fetch_headers(http) == ESP_FAIL) {
-        DISCORD_LOGW("Fail to fetch headers");
-        dcapi_flush_http(client, false);
+        xSemaphoreTake(client->api_lock, portMAX_DELAY);
+        uint32_t retry_ms = discord_ratelimit_update(
+            &client->api_ratelimit, route, major, &conn->ratelimit_headers, code, discord_tick_ms());
         xSemaphoreGive(client->api_lock);
-        return ESP_FAIL;
-    }
 
-    discord_api_response_t *res = cu_ctor(discord_api_response_t, .code = esp_http_client_get_status_code(http));
+        if (retry_ms > 0 && attempt < DISCORD_RATELIMIT_RETRIES && retry_ms <= wait_budget) {
+            DISCORD_LOGW("Too many requests, retrying in %" PRIu32 " ms", retry_ms);
+            dcapi_flush_http(conn, false);
+            dcapi_connection_release(client, conn);
+            wait_budget -= retry_ms;
+            vTaskDelay(retry_ms / portTICK_PERIOD_MS + 1);
+            continue;
+        }
+
+        dcapi_free_payload(request);
 
-    bool is_error = !dcapi_response_is_success(res);
+        res = cu_ctor(discord_api_response_t, .code = code);
 
-    dcapi_flush_http(client, stream_response || is_error); // record if stream_response is true or there is errors
+        bool is_error = !dcapi_response_is_success(res);
 
-    if (stream_response || is_error) {
-        if (client->api_buffer_record_status != ESP_OK) {
-            DISCORD_LOGW("Fail to record response chunks");
-            client->api_buffer_size = 0;
-            err = ESP_ERR_INVALID_SIZE; // required larger buffer
+        if (!is_error && request->list_parser) {
+            err = dcapi_flush_list(conn, request, res); // elements are decoded, nothing is left in the buffer
         }
-        else if (!is_error) { // point response to buffer if there is no errors
-            res->data = client->api_buffer;
-            res->data_len = client->api_buffer_size;
+        else {
+            dcapi_flush_http(conn, stream_response || is_error); // record if stream_response is true or there is errors
+
+            if ((stream_response || is_error) && conn->buffer_record_status != ESP_OK) {
+                DISCORD_LOGW("Fail to record response chunks");
+                conn->buffer_size = 0;
+                err = ESP_ERR_INVALID_SIZE; // required larger buffer
+            }
+            else if (stream_response && !is_error) { // point response to buffer if there is no errors
+                res->data = conn->buffer;
+                res->data_len = conn->buffer_size;
+                res->connection = conn; // connection is busy until response is freed
+            }
         }
-    }
 
-    if (err == ESP_OK) {
-        DISCORD_LOGD("Received api response (res_code=%d, data_len=%d)", res->code, res->data_len);
+        if (err == ESP_OK) {
+            DISCORD_LOGD("Received api response (res_code=%d, data_len=%d)", res->code, res->data_len);
 
-        if (res->data_len > 0) {
-            DISCORD_LOGD("%.*s", res->data_len, res->data);
+            if (res->data_len > 0) {
+                DISCORD_LOGD("%.*s", res->data_len, res->data);
+            }
+
+            if (is_error && conn->buffer_size > 0) {
+                // just print raw error for now
+                DISCORD_LOGW("Error: %.*s", conn->buffer_size, conn->buffer);
+                conn->buffer_size = 0;
+            }
         }
 
-        if (is_error && client->api_buffer_size > 0) {
-            DISCORD_LOGW("Error: %.*s", client->api_buffer_size, client->api_buffer); // just print raw error for now
-            client->api_buffer_size = 0;
+        if (!res->connection) {
+            dcapi_connection_release(client, conn);
         }
+
+        break;
     }
 
-    xSemaphoreGive(client->api_lock);
+    free(url);
+    dcapi_free_payload(request); // in case request failed before the response
+
+    if (!res) {
+        return err;
+    }
 
-    if (out_response) {
+    if (out_response && err == ESP_OK) {
         *out_response = res;
     }
     else {
@@ -397,6 +690,17 @@ esp_err_t dcapi_request(discord_handle_t client, esp_http_client_method_t method
     return err;
 }
 
+/**
+ * @return Length of the scheme and host part of url (e.g. "https://cdn.discordapp.com")
+ */
+static size_t dcapi_url_host_len(const char *url)
+{
+    const char *host = strstr(url, "://");
+    host = host ? host + 3 : url;
+
+    return (host - url) + strcspn(host, "/?#");
+}
+
 esp_err_t dcapi_download(discord_handle_t client, const char *url, discord_download_handler_t download_handler,
     discord_api_response_t **out_response, void *arg)
 {
@@ -404,38 +708,63 @@ esp_err_t dcapi_download(discord_handle_t client, const char *url, discord_downl
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (client->api_download_mode
-        && xSemaphoreTake(client->api_lock, client->config->api_timeout_ms / portTICK_PERIOD_MS) != pdTRUE) {
-        DISCORD_LOGW("Api is locked");
+    if (!client->api_cdn) {
+        DISCORD_LOGW("API is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!dcgw_is_connected(client)) {
+        DISCORD_LOGW("API can be used only if client (any of its shards) is in CONNECTED state");
         return ESP_FAIL;
     }
 
-    dcapi_destroy(client); // destroy live http_client instance (if exist)
+    if (xSemaphoreTake(client->api_cdn_lock, client->config->api_timeout_ms / portTICK_PERIOD_MS) != pdTRUE) {
+        DISCORD_LOGW("Another download is in progress");
+        return ESP_FAIL;
+    }
+
+    dcapi_connection_t *conn = client->api_cdn;
+    size_t host_len = dcapi_url_host_len(url);
 
-    if (dcapi_init_lazy(client, true, url) != ESP_OK) { // create new instance for download
+    if (conn->http && (strncmp(conn->host, url, host_len) != 0 || conn->host[host_len] != '\0')) {
+        DISCORD_LOGD("Download from other host, closing connection");
+        dcapi_connection_destroy(conn);
+    }
+
+    if (dcapi_connection_init(conn, true, url) != ESP_OK || (!conn->host && !(conn->host = strndup(url, host_len)))) {
         DISCORD_LOGW("Cannot initialize API");
+        dcapi_connection_destroy(conn);
+        xSemaphoreGive(client->api_cdn_lock);
         return ESP_FAIL;
     }
 
-    esp_http_client_handle_t http = client->http;
+    esp_http_client_handle_t http = conn->http;
 
-    client->api_buffer_record = true;
-    client->api_buffer_record_status = ESP_OK;
-    client->api_download_handler = download_handler;
-    client->api_download_arg = arg;
+    esp_http_client_set_url(http, url);
+    // todo: error check
+    esp_http_client_set_method(http, HTTP_METHOD_GET);
+    // todo: error check
+
+    conn->buffer_size = 0;
+    conn->buffer_record = true;
+    conn->buffer_record_status = ESP_OK;
+    conn->download_handler = download_handler;
+    conn->download_arg = arg;
+    conn->download_offset = 0;
+    conn->download_total = 0;
 
+    // failed connection is dropped, next download opens a new one
     if (esp_http_client_open(http, 0) != ESP_OK) {
         DISCORD_LOGW("Failed to open connection");
-        xSemaphoreGive(client->api_lock);
-        dcapi_destroy(client);
+        dcapi_connection_destroy(conn);
+        xSemaphoreGive(client->api_cdn_lock);
         return ESP_FAIL;
     }
 
     if (esp_http_client_fetch_headers(http) == ESP_FAIL) {
         DISCORD_LOGW("Fail to fetch headers");
-        dcapi_flush_http(client, false);
-        xSemaphoreGive(client->api_lock);
-        dcapi_destroy(client);
+        dcapi_connection_destroy(conn);
+        xSemaphoreGive(client->api_cdn_lock);
         return ESP_FAIL;
     }
 
@@ -445,20 +774,28 @@ esp_err_t dcapi_download(discord_handle_t client, const char *url, discord_downl
 
     if (dcapi_response_is_success(res)) {
         if (esp_http_client_is_chunked_response(http)) {
-            esp_http_client_get_chunk_length(http, (int *)&client->api_download_total);
+            esp_http_client_get_chunk_length(http, (int *)&conn->download_total);
         }
         else {
-            client->api_download_total = esp_http_client_get_content_length(http);
+            conn->download_total = esp_http_client_get_content_length(http);
         }
 
-        if (dcapi_download_handler_fire(client, client->api_buffer, client->api_buffer_size) == ESP_OK) {
-            dcapi_flush_http(client, false);
+        if (dcapi_download_handler_fire(conn, conn->buffer, conn->buffer_size) == ESP_OK) {
+            dcapi_flush_http(conn, false);
+        }
+        else {
+            esp_http_client_close(http); // user break chunk stream
         }
     }
+    else {
+        conn->download_handler = NULL; // discard the rest of error response, so connection can be reused
+        dcapi_flush_http(conn, false);
+    }
 
-    client->api_download_mode = false;
-    xSemaphoreGive(client->api_lock);
-    dcapi_destroy(client); // destroy http_client, new one will be created on next request
+    conn->buffer_size = 0;
+    conn->download_handler = NULL;
+    conn->download_arg = NULL;
+    xSemaphoreGive(client->api_cdn_lock);
 
     *out_response = res;
     return ESP_OK;
@@ -542,6 +879,281 @@ esp_err_t dcapi_put(discord_handle_t client, char *uri, char *payload, discord_a
     return err;
 }
 
+esp_err_t dcapi_get_list(discord_handle_t client, char *uri, dcapi_result_parser_t parser, dcapi_result_free_t free_fnc,
+    void ***out_list, int *out_length)
+{
+    discord_api_request_t *request = dcapi_create_request(uri, NULL);
+    // todo: memcheck
+    request->list_parser = parser;
+    request->list_free = free_fnc;
+
+    discord_api_response_t *res = NULL;
+    esp_err_t err = dcapi_request(client, HTTP_METHOD_GET, request, &res);
+    discord_api_request_free(request);
+
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (!dcapi_response_is_success(res)) {
+        dcapi_response_free(client, res);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    *out_list = res->list; // NULL for empty array
+    *out_length = res->list_len;
+    res->list = NULL;
+
+    dcapi_response_free(client, res);
+
+    return err;
+}
+
+static void dcapi_job_run(discord_handle_t client, dcapi_job_t *job)
+{
+    discord_api_response_t *res = NULL;
+    void *result = NULL;
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+
+    if (!client->api_worker_cancel) {
+        err = dcapi_request(client, job->method, job->request, &res); // response is needed for its status
+    }
+
+    discord_api_request_free(job->request);
+
+    if (err == ESP_OK && res && !dcapi_response_is_success(res)) {
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    else if (err == ESP_OK && res && res->data_len > 0 && job->parser) {
+        result = job->parser(res->data, res->data_len);
+    }
+
+    if (res) {
+        dcapi_response_free(client, res); // release connection before the callback, so callback can send requests
+    }
+
+    if (job->callback) {
+        job->callback(client, err, result, job->arg);
+    }
+}
+
+static void dcapi_worker_task(void *arg)
+{
+    discord_handle_t client = (discord_handle_t)arg;
+    dcapi_job_t job;
+
+    // request of NULL stops the worker
+    while (xQueueReceive(client->api_queue, &job, portMAX_DELAY) == pdPASS && job.request) {
+        dcapi_job_run(client, &job);
+    }
+
+    DISCORD_LOGD("Worker exit.");
+    xSemaphoreGive(client->api_workers_done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t dcapi_request_async_keep(discord_handle_t client, esp_http_client_method_t method,
+    discord_api_request_t *request, dcapi_result_parser_t parser, discord_request_callback_t callback, void *arg)
+{
+    if (!client || !request) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (client->api_workers == 0) {
+        DISCORD_LOGW("Api workers are not running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    request->async = true;
+
+    dcapi_job_t job = {
+        .method = method,
+        .request = request,
+        .parser = callback ? parser : NULL, // nobody would take the result
+        .callback = callback,
+        .arg = arg,
+    };
+
+    if (xQueueSend(client->api_queue, &job, 0) != pdPASS) {
+        DISCORD_LOGW("Request queue is full");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t dcapi_request_async(discord_handle_t client, esp_http_client_method_t method, discord_api_request_t *request,
+    dcapi_result_parser_t parser, discord_request_callback_t callback, void *arg)
+{
+    esp_err_t err = dcapi_request_async_keep(client, method, request, parser, callback, arg);
+
+    if (err != ESP_OK) {
+        discord_api_request_free(request);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Stop worker tasks. Queued requests are not sent, their callbacks get ESP_ERR_INVALID_STATE
+ */
+static void dcapi_workers_stop(discord_handle_t client)
+{
+    if (client->api_workers > 0) {
+        dcapi_job_t stop = { 0 };
+
+        client->api_worker_cancel = true; // jobs before the stops are just completed
+
+        for (uint8_t i = 0; i < client->api_workers; i++) {
+            xQueueSend(client->api_queue, &stop, portMAX_DELAY);
+        }
+
+        for (uint8_t i = 0; i < client->api_workers; i++) {
+            xSemaphoreTake(client->api_workers_done, portMAX_DELAY);
+        }
+
+        memset(client->api_worker_tasks, 0, client->api_workers * sizeof(TaskHandle_t));
+        client->api_workers = 0;
+    }
+
+    if (client->api_queue) {
+        vQueueDelete(client->api_queue);
+        client->api_queue = NULL;
+    }
+
+    if (client->api_workers_done) {
+        vSemaphoreDelete(client->api_workers_done);
+        client->api_workers_done = NULL;
+    }
+}
+
+/**
+ * @brief One worker per connection, so queued requests use the whole pool
+ */
+static esp_err_t dcapi_workers_start(discord_handle_t client)
+{
+    uint8_t count = client->api_pool_len;
+
+    client->api_worker_cancel = false;
+
+    // handles outlive the workers, so dcapi_is_worker never reads freed memory
+    if (!client->api_worker_tasks && !(client->api_worker_tasks = calloc(count, sizeof(TaskHandle_t)))) {
+        DISCORD_LOGE("Cannot allocate api workers. No memory.");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!(client->api_queue = xQueueCreate(DISCORD_API_QUEUE_SIZE, sizeof(dcapi_job_t)))
+        || !(client->api_workers_done = xSemaphoreCreateCounting(count, 0))) {
+        DISCORD_LOGE("Cannot allocate api workers. No memory.");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (xTaskCreate(dcapi_worker_task,
+                "discord_api",
+                DISCORD_API_TASK_STACK_SIZE,
+                client,
+                client->config->task_priority,
+                &client->api_worker_tasks[i])
+            != pdPASS) {
+            DISCORD_LOGE("Fail to create api worker task");
+            return ESP_FAIL;
+        }
+
+        client->api_workers++;
+    }
+
+    return ESP_OK;
+}
+
+bool dcapi_is_worker(discord_handle_t client)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    for (uint8_t i = 0; client->api_worker_tasks && i < client->config->api_connections; i++) {
+        if (client->api_worker_tasks[i] == task) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+esp_err_t dcapi_init(discord_handle_t client)
+{
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (client->api_pool) {
+        return ESP_OK;
+    }
+
+    DISCORD_LOG_FOO();
+
+    uint8_t len = client->config->api_connections;
+
+    if (!(client->api_lock = xSemaphoreCreateMutex()) || !(client->api_idle = xSemaphoreCreateCounting(len, len))
+        || !(client->api_pool = calloc(len, sizeof(dcapi_connection_t)))
+        || !(client->api_cdn_lock = xSemaphoreCreateMutex())
+        || !(client->api_cdn = cu_ctor(dcapi_connection_t, .client = client))) {
+        DISCORD_LOGE("Cannot allocate api. No memory.");
+        dcapi_destroy(client);
+        return ESP_ERR_NO_MEM;
+    }
+
+    client->api_pool_len = len;
+
+    for (uint8_t i = 0; i < len; i++) {
+        client->api_pool[i].client = client;
+    }
+
+    esp_err_t err = dcapi_workers_start(client);
+
+    if (err != ESP_OK) {
+        dcapi_destroy(client);
+    }
+
+    return err;
+}
+
+esp_err_t dcapi_close(discord_handle_t client)
+{
+    DISCORD_LOG_FOO();
+
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (client->api_cdn && xSemaphoreTake(client->api_cdn_lock, 0) == pdTRUE) { // download in progress is left open
+        dcapi_connection_destroy(client->api_cdn);
+        xSemaphoreGive(client->api_cdn_lock);
+    }
+
+    for (uint8_t i = 0; client->api_pool && i < client->api_pool_len; i++) {
+        dcapi_connection_t *conn = &client->api_pool[i];
+
+        if (xSemaphoreTake(client->api_idle, 0) != pdTRUE) {
+            break; // all remaining connections are busy
+        }
+
+        xSemaphoreTake(client->api_lock, portMAX_DELAY); // never held during I/O
+        bool idle = !conn->busy;
+        conn->busy = true;
+        xSemaphoreGive(client->api_lock);
+
+        if (idle) {
+            dcapi_connection_destroy(conn);
+            dcapi_connection_release(client, conn);
+        }
+        else {
+            xSemaphoreGive(client->api_idle); // token belongs to other idle connection, it is visited later
+        }
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t dcapi_destroy(discord_handle_t client)
 {
     DISCORD_LOG_FOO();
@@ -550,32 +1162,45 @@ esp_err_t dcapi_destroy(discord_handle_t client)
         return ESP_ERR_INVALID_ARG;
     }
 
+    dcapi_workers_stop(client);
+
+    if (client->api_cdn) {
+        xSemaphoreTake(client->api_cdn_lock, portMAX_DELAY); // wait for download in progress
+        dcapi_connection_destroy(client->api_cdn);
+        xSemaphoreGive(client->api_cdn_lock);
+    }
+
+    for (uint8_t i = 0; client->api_pool && i < client->api_pool_len; i++) { // wait for all requests in progress
+        xSemaphoreTake(client->api_idle, portMAX_DELAY);
+    }
+
+    for (uint8_t i = 0; client->api_pool && i < client->api_pool_len; i++) {
+        dcapi_connection_destroy(&client->api_pool[i]);
+    }
+
     if (client->api_lock) {
-        xSemaphoreTake(client->api_lock, portMAX_DELAY); // wait for unlock
-        vSemaphoreDelete(client->api_lock);
+        SemaphoreHandle_t lock = client->api_lock;
+        xSemaphoreTake(lock, portMAX_DELAY); // wait for unlock
         client->api_lock = NULL;
+        vSemaphoreDelete(lock);
     }
 
-    client->api_download_mode = false;
-    client->api_download_handler = NULL;
-    client->api_download_arg = NULL;
-    client->api_download_offset = 0;
-    client->api_download_total = 0;
-
-    if (client->api_buffer != NULL) {
-        free(client->api_buffer);
-        client->api_buffer = NULL;
+    if (client->api_idle) {
+        vSemaphoreDelete(client->api_idle);
+        client->api_idle = NULL;
     }
 
-    client->api_buffer_size = 0;
-    client->api_buffer_record = false;
+    free(client->api_pool);
+    client->api_pool = NULL;
+    client->api_pool_len = 0;
 
-    if (client->http) {
-        dcapi_flush_http(client, false);
-        esp_http_client_close(client->http);
-        esp_http_client_cleanup(client->http);
-        client->http = NULL;
+    if (client->api_cdn_lock) {
+        vSemaphoreDelete(client->api_cdn_lock);
+        client->api_cdn_lock = NULL;
     }
 
+    free(client->api_cdn);
+    client->api_cdn = NULL;
+
     return ESP_OK;
 }
@@ -0,0 +1,210 @@
+#include <string.h>
+#include "discord/private/_arena.h"
+#include "discord/private/_discord.h"
+#include "cutils.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define DISCORD_ARENA_ALIGN(size) (((size) + 7) & ~((size_t)7))
+
+typedef struct discord_arena_block
+{
+    struct discord_arena_block *next;
+    size_t size;
+    size_t used;
+    uint8_t data[] __attribute__((aligned(8)));
+} discord_arena_block_t;
+
+struct discord_arena
+{
+    discord_arena_pool_handle_t pool;
+    discord_arena_block_t *extra; /*<! Blocks allocated after the main block got full */
+    discord_arena_block_t main;   /*<! Must be the last member, data follows */
+};
+
+struct discord_arena_pool
+{
+    QueueHandle_t idle;
+    portMUX_TYPE lock; /*<! Guards created, pool is used by websocket tasks and the decoder task at once */
+    size_t capacity;
+    size_t created;
+    size_t arena_size;
+};
+
+static discord_arena_handle_t dc_arena_create(discord_arena_pool_handle_t pool, size_t size)
+{
+    discord_arena_handle_t arena = malloc(sizeof(struct discord_arena) + size);
+
+    if (arena) {
+        arena->pool = pool;
+        arena->extra = NULL;
+        arena->main.next = NULL;
+        arena->main.size = size;
+        arena->main.used = 0;
+    }
+
+    return arena;
+}
+
+static void *dc_arena_block_take(discord_arena_block_t *block, size_t size)
+{
+    if (block->size - block->used < size) {
+        return NULL;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+void *discord_arena_alloc(discord_arena_handle_t arena, size_t size)
+{
+    if (!arena) {
+        return NULL;
+    }
+
+    size = DISCORD_ARENA_ALIGN(size);
+
+    void *ptr = dc_arena_block_take(&arena->main, size);
+
+    if (!ptr && arena->extra) {
+        ptr = dc_arena_block_take(arena->extra, size);
+    }
+
+    if (!ptr) {
+        size_t block_size = size > arena->main.size ? size : arena->main.size;
+        discord_arena_block_t *block = malloc(sizeof(discord_arena_block_t) + block_size);
+
+        if (!block) {
+            DISCORD_LOGW("Fail to grow arena");
+            return NULL;
+        }
+
+        block->next = arena->extra;
+        block->size = block_size;
+        block->used = 0;
+        arena->extra = block;
+        ptr = dc_arena_block_take(block, size);
+    }
+
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+char *discord_arena_strdup(discord_arena_handle_t arena, const char *str)
+{
+    if (!str) {
+        return NULL;
+    }
+
+    size_t len = strlen(str);
+    char *dup = discord_arena_alloc(arena, len + 1);
+
+    if (dup) {
+        memcpy(dup, str, len + 1);
+    }
+
+    return dup;
+}
+
+void discord_arena_release(discord_arena_handle_t arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    while (arena->extra) {
+        discord_arena_block_t *block = arena->extra;
+        arena->extra = block->next;
+        free(block);
+    }
+
+    arena->main.used = 0;
+
+    discord_arena_pool_handle_t pool = arena->pool;
+
+    if (!pool) {
+        free(arena);
+        return;
+    }
+
+    if (xQueueSend(pool->idle, &arena, 0) != pdPASS) {
+        free(arena);
+
+        portENTER_CRITICAL(&pool->lock);
+        pool->created--; // slot of the freed arena can be taken by the new one
+        portEXIT_CRITICAL(&pool->lock);
+    }
+}
+
+discord_arena_pool_handle_t discord_arena_pool_create(size_t capacity, size_t arena_size)
+{
+    discord_arena_pool_handle_t pool = cu_tctor(discord_arena_pool_handle_t,
+        struct discord_arena_pool,
+        .lock = portMUX_INITIALIZER_UNLOCKED,
+        .capacity = capacity,
+        .arena_size = DISCORD_ARENA_ALIGN(arena_size));
+
+    if (!pool) {
+        return NULL;
+    }
+
+    if (!(pool->idle = xQueueCreate(capacity, sizeof(discord_arena_handle_t)))) {
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+discord_arena_handle_t discord_arena_pool_acquire(discord_arena_pool_handle_t pool)
+{
+    if (!pool) {
+        return NULL;
+    }
+
+    discord_arena_handle_t arena = NULL;
+
+    if (xQueueReceive(pool->idle, &arena, 0) == pdPASS) {
+        return arena;
+    }
+
+    portENTER_CRITICAL(&pool->lock);
+    bool full = pool->created >= pool->capacity;
+
+    if (!full) {
+        pool->created++; // reserve, arena is allocated outside of the critical section
+    }
+    portEXIT_CRITICAL(&pool->lock);
+
+    if (full) {
+        DISCORD_LOGD("All arenas are in use");
+        return NULL;
+    }
+
+    if (!(arena = dc_arena_create(pool, pool->arena_size))) {
+        portENTER_CRITICAL(&pool->lock);
+        pool->created--;
+        portEXIT_CRITICAL(&pool->lock);
+    }
+
+    return arena;
+}
+
+void discord_arena_pool_free(discord_arena_pool_handle_t pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    discord_arena_handle_t arena = NULL;
+
+    while (xQueueReceive(pool->idle, &arena, 0) == pdPASS) {
+        free(arena);
+    }
+
+    vQueueDelete(pool->idle);
+    free(pool);
+}
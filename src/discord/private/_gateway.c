@@ -1,129 +1,846 @@
 #include <inttypes.h>
 #include "discord/private/_gateway.h"
 #include "discord/private/_json.h"
+#include "discord/private/_json_parser.h"
+#include "discord/private/_json_writer.h"
+#include "discord/private/_session_store.h"
 #include "discord/message.h"
+#include "discord/voice_state.h"
 #include "esp_transport_ws.h"
+#include "esp_random.h"
 #include "cutils.h"
 #include "estr.h"
 
 DISCORD_LOG_DEFINE_BASE();
 
-static void dcgw_heartbeat_stop(discord_handle_t client)
+static void dcgw_heartbeat_stop(discord_shard_t *shard)
 {
     DISCORD_LOG_FOO();
 
-    client->heartbeater.running = false;
-    client->heartbeater.interval = 0;
-    client->heartbeater.tick_ms = 0;
-    client->heartbeater.received_ack = false;
+    shard->heartbeater.running = false;
+    shard->heartbeater.interval = 0;
+    shard->heartbeater.tick_ms = 0;
+    shard->heartbeater.received_ack = false;
+    shard->heartbeater.sent_ms = 0;
 }
 
-static bool dcgw_whether_payload_should_go_into_queue(discord_handle_t client, discord_payload_t *payload)
+static void dcgw_latency_record(discord_handle_t client, uint32_t rtt)
 {
-    if (!payload)
+    static const uint32_t bounds[DISCORD_GATEWAY_LATENCY_BUCKETS - 1] = { 50, 100, 200, 400, 800, 1600 };
+    uint8_t bucket = 0;
+
+    while (bucket < DISCORD_GATEWAY_LATENCY_BUCKETS - 1 && rtt >= bounds[bucket]) {
+        bucket++;
+    }
+
+    portENTER_CRITICAL(&client->latency_lock);
+
+    discord_gateway_latency_t *latency = &client->latency;
+
+    if (latency->samples == 0) {
+        latency->min_ms = rtt;
+        latency->max_ms = rtt;
+        client->latency_ewma_x8 = rtt * 8; // first sample seeds the average
+    }
+    else {
+        if (rtt < latency->min_ms) {
+            latency->min_ms = rtt;
+        }
+
+        if (rtt > latency->max_ms) {
+            latency->max_ms = rtt;
+        }
+
+        client->latency_ewma_x8 = client->latency_ewma_x8 - client->latency_ewma_x8 / 8 + rtt;
+    }
+
+    latency->samples++;
+    latency->last_ms = rtt;
+    latency->histogram[bucket]++;
+    client->latency_sum_ms += rtt;
+    latency->avg_ms = (uint32_t)(client->latency_sum_ms / latency->samples);
+    latency->ewma_ms = client->latency_ewma_x8 / 8;
+
+    portEXIT_CRITICAL(&client->latency_lock);
+}
+
+static bool dcgw_session_is_resumable(discord_shard_t *shard)
+{
+    return shard->session && shard->session->session_id && shard->session->user
+           && shard->last_sequence_number != DISCORD_NULL_SEQUENCE_NUMBER;
+}
+
+esp_err_t dcgw_session_reset(discord_shard_t *shard)
+{
+    if (!shard) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    DISCORD_LOG_FOO();
+
+    discord_session_free(shard->session);
+    shard->session = NULL;
+    shard->last_sequence_number = DISCORD_NULL_SEQUENCE_NUMBER;
+
+    if (shard->client->config->session_persist && shard->session_checkpoint_ms) {
+        discord_session_store_erase(shard->id);
+    }
+
+    shard->session_checkpoint_ms = 0;
+    shard->session_checkpoint_seq = DISCORD_NULL_SEQUENCE_NUMBER;
+
+    return ESP_OK;
+}
+
+static esp_err_t dcgw_session_checkpoint(discord_shard_t *shard)
+{
+    if (!shard->client->config->session_persist || !dcgw_session_is_resumable(shard)) {
+        return ESP_OK;
+    }
+
+    DISCORD_LOGD("Session checkpoint (shard: %d, seq: %d)", shard->id, shard->last_sequence_number);
+
+    // time is updated even on failure, so broken flash is not hammered
+    shard->session_checkpoint_ms = discord_tick_ms();
+    shard->session_checkpoint_seq = shard->last_sequence_number;
+
+    return discord_session_store_save(
+        shard->id, shard->client->config->shards.total, shard->session, shard->last_sequence_number);
+}
+
+uint32_t dcgw_session_checkpoint_due_ms(discord_shard_t *shard)
+{
+    if (!shard->client->config->session_persist || !dcgw_session_is_resumable(shard)
+        || shard->last_sequence_number == shard->session_checkpoint_seq) {
+        return UINT32_MAX;
+    }
+
+    uint64_t elapsed = discord_tick_ms() - shard->session_checkpoint_ms;
+
+    return elapsed >= DISCORD_SESSION_CHECKPOINT_INTERVAL ? 0
+                                                          : (uint32_t)(DISCORD_SESSION_CHECKPOINT_INTERVAL - elapsed);
+}
+
+esp_err_t dcgw_session_checkpoint_if_due(discord_shard_t *shard)
+{
+    return dcgw_session_checkpoint_due_ms(shard) > 0 ? ESP_OK : dcgw_session_checkpoint(shard);
+}
+
+/**
+ * @brief Load session saved by the previous run, so the shard starts with RESUME instead of IDENTIFY
+ */
+static void dcgw_session_restore(discord_shard_t *shard)
+{
+    discord_handle_t client = shard->client;
+
+    if (!client->config->session_persist || shard->session) {
+        return;
+    }
+
+    discord_session_t *session = NULL;
+    int seq = DISCORD_NULL_SEQUENCE_NUMBER;
+
+    uint32_t max_age = client->config->session_max_age;
+
+    if (discord_session_store_load(shard->id, client->config->shards.total, max_age, &session, &seq) != ESP_OK) {
+        return;
+    }
+
+    DISCORD_LOGI("Session %s restored (shard: %d, seq: %d)", session->session_id, shard->id, seq);
+
+    shard->session = session;
+    shard->last_sequence_number = seq;
+    shard->session_checkpoint_ms = discord_tick_ms();
+    shard->session_checkpoint_seq = seq;
+}
+
+static bool dcgw_member_request_is_active(discord_handle_t client)
+{
+    discord_member_requester_t *requester = &client->member_requester;
+
+    portENTER_CRITICAL(&requester->lock);
+    bool active = requester->active;
+    portEXIT_CRITICAL(&requester->lock);
+
+    return active;
+}
+
+/**
+ * @brief Check if dispatch event should be parsed at all.
+ *        Events used by gateway itself always pass, others only if someone has registered handler for them
+ */
+static bool dcgw_is_event_subscribed(discord_handle_t client, discord_event_t event)
+{
+    if (event == DISCORD_EVENT_READY || event == DISCORD_EVENT_RESUMED) {
+        return true;
+    }
+
+    if (event == DISCORD_EVENT_GUILD_MEMBERS_CHUNK && dcgw_member_request_is_active(client)) {
+        return true; // completes the member request
+    }
+
+    if (event <= DISCORD_EVENT_CONNECTED || event >= DISCORD_EVENT_MAX) {
+        return false; // unknown events are never fired
+    }
+
+    return client->subscribed_events[event / 32] & (1UL << (event % 32));
+}
+
+static bool dcgw_is_own_user(discord_shard_t *shard, const char *user_id)
+{
+    return shard->session && shard->session->user && estr_eq(user_id, shard->session->user->id);
+}
+
+/**
+ * @brief Check if dispatch payload should be fired to the handlers.
+ *        Reads the session and the state of the shard, so it runs on the discord task which owns them
+ */
+static bool dcgw_whether_payload_should_be_dispatched(discord_shard_t *shard, discord_payload_t *payload)
+{
+    // while resuming, gateway replays missed events before RESUMED so they need to pass
+    if (shard->state < DISCORD_STATE_CONNECTED && payload->t != DISCORD_EVENT_READY
+        && payload->t != DISCORD_EVENT_RESUMED && !dcgw_session_is_resumable(shard)) {
+        DISCORD_LOGW("Ignoring payload because client is not in CONNECTED state and still not receive READY payload");
+        return false;
+    }
+
+    switch (payload->t) {
+        case DISCORD_EVENT_MESSAGE_RECEIVED:
+        case DISCORD_EVENT_MESSAGE_UPDATED: {
+            discord_message_t *msg = (discord_message_t *)payload->d;
+
+            if (!msg || !msg->author
+                || !(msg->type == DISCORD_MESSAGE_DEFAULT || msg->type == DISCORD_MESSAGE_REPLY)
+                ||                                         // ignore if not default or reply type
+                dcgw_is_own_user(shard, msg->author->id)) { // ignore our messages
+                return false;
+            }
+        } break;
+
+        case DISCORD_EVENT_MESSAGE_REACTION_ADDED:
+        case DISCORD_EVENT_MESSAGE_REACTION_REMOVED: {
+            discord_message_reaction_t *react = (discord_message_reaction_t *)payload->d;
+
+            // ignore our reactions
+            if (!react || !react->emoji || dcgw_is_own_user(shard, react->user_id)) {
+                return false;
+            }
+        } break;
+
+        default:
+            break;
+    }
+
+    return true;
+}
+
+static discord_close_code_t dcgw_get_close_opcode(discord_shard_t *shard)
+{
+    if (shard->state == DISCORD_STATE_DISCONNECTING && shard->gw_buffer_len >= 2) {
+        int code = (256 * shard->gw_buffer[0] + shard->gw_buffer[1]);
+        return code >= _DISCORD_CLOSEOP_MIN && code <= _DISCORD_CLOSEOP_MAX ? code : DISCORD_CLOSEOP_NO_CODE;
+    }
+
+    return DISCORD_CLOSEOP_NO_CODE;
+}
+
+static void dcgw_queue_stats_count(discord_handle_t client, uint32_t *counter)
+{
+    portENTER_CRITICAL(&client->queue_stats_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&client->queue_stats_lock);
+}
+
+/**
+ * @brief Decode small control payload right away and put it into the control queue,
+ *        so it does not wait behind the frames and events (heartbeat ACK stuck there would look like zombie connection)
+ */
+static esp_err_t dcgw_handle_control(discord_shard_t *shard)
+{
+    discord_handle_t client = shard->client;
+    discord_payload_t *payload = discord_json_deserialize_(payload, shard->gw_buffer, shard->gw_buffer_len);
+
+    if (!payload) {
+        DISCORD_LOGE("Fail to deserialize control payload");
+        return ESP_FAIL;
+    }
+
+    payload->shard = shard - client->shards;
+    payload->connection = shard->gw_connection;
+
+    if (xQueueSend(client->control_queue, &payload, 5000 / portTICK_PERIOD_MS) != pdPASS) { // 5sec timeout
+        DISCORD_LOGW("Fail to queue the control payload (op: %d)", payload->op);
+        discord_payload_free(payload);
+        dcgw_queue_stats_count(client, &client->queue_stats.dropped_newest);
+        return ESP_FAIL;
+    }
+
+    DISCORD_TASK_NOTIFY(client);
+
+    return ESP_OK;
+}
+
+static void dcgw_frame_free(discord_gateway_frame_t *frame)
+{
+    if (frame->arena) {
+        discord_arena_release(frame->arena); // data lives in the arena
+    }
+    else {
+        free(frame->data);
+    }
+}
+
+/**
+ * @brief Hand complete gateway message over to the decoder.
+ *        Only the header is peeked here, so the websocket task gets back to the socket as soon as possible
+ */
+static esp_err_t dcgw_handle_buffer(discord_shard_t *shard)
+{
+    discord_handle_t client = shard->client;
+    discord_payload_header_t header;
+
+    if (discord_payload_header_from_json(shard->gw_buffer, shard->gw_buffer_len, &header) == ESP_OK) {
+        if (header.s != DISCORD_NULL_SEQUENCE_NUMBER) {
+            shard->last_sequence_number = header.s;
+        }
+
+        if (header.op == DISCORD_OP_DISPATCH && !dcgw_is_event_subscribed(client, header.t)) {
+            DISCORD_LOGD("Event %d dropped. No handlers registered", header.t);
+            return ESP_OK;
+        }
+
+        if (header.op >= 0 && header.op != DISCORD_OP_DISPATCH) {
+            return dcgw_handle_control(shard);
+        }
+    }
+
+    discord_gateway_frame_t frame = {
+        .shard = shard - client->shards,
+        .connection = shard->gw_connection,
+        .len = shard->gw_buffer_len,
+    };
+
+    if (shard->gw_slot) {
+        // zero-copy: the whole slot is handed over, decoder parses the receive buffer in place
+        frame.arena = shard->gw_slot;
+        frame.data = shard->gw_buffer;
+        shard->gw_slot = NULL;
+    }
+    else if ((frame.data = malloc(frame.len + 1))) {
+        memcpy(frame.data, shard->gw_buffer, frame.len + 1);
+    }
+    else {
+        DISCORD_LOGE("Fail to allocate frame");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xQueueSend(client->gw_frames, &frame, 5000 / portTICK_PERIOD_MS) != pdPASS) { // 5sec timeout
+        DISCORD_LOGW("Fail to queue the frame");
+        dcgw_frame_free(&frame);
+        dcgw_queue_stats_count(client, &client->queue_stats.dropped_newest);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Gateway control payloads, READY/RESUMED and member chunks drive the gateway itself, so they are never dropped
+ */
+static bool dcgw_payload_is_droppable(discord_payload_t *payload)
+{
+    return payload->op == DISCORD_OP_DISPATCH && payload->t != DISCORD_EVENT_READY
+           && payload->t != DISCORD_EVENT_RESUMED && payload->t != DISCORD_EVENT_GUILD_MEMBERS_CHUNK;
+}
+
+/**
+ * @brief Check if the newer payload is an update of the same object, so the older one is not needed anymore
+ */
+static bool dcgw_payload_supersedes(discord_payload_t *newer, discord_payload_t *older)
+{
+    if (newer->t != older->t || !newer->d || !older->d) {
         return false;
+    }
+
+    switch (newer->t) {
+        case DISCORD_EVENT_MESSAGE_UPDATED:
+            return estr_eq(((discord_message_t *)newer->d)->id, ((discord_message_t *)older->d)->id);
+
+        case DISCORD_EVENT_VOICE_STATE_UPDATED: {
+            discord_voice_state_t *newer_state = (discord_voice_state_t *)newer->d;
+            discord_voice_state_t *older_state = (discord_voice_state_t *)older->d;
 
-    if (payload->op == DISCORD_OP_DISPATCH) {
-        if (client->state < DISCORD_STATE_CONNECTED && payload->t != DISCORD_EVENT_READY) {
-            DISCORD_LOGW(
-                "Ignoring payload because client is not in CONNECTED state and still not receive READY payload");
+            return estr_eq(newer_state->user_id, older_state->user_id)
+                   && estr_eq(newer_state->guild_id, older_state->guild_id);
+        }
+
+        default:
             return false;
+    }
+}
+
+bool dcgw_control_receive(discord_handle_t client, discord_payload_t **out_payload)
+{
+    return xQueueReceive(client->control_queue, out_payload, 0) == pdPASS;
+}
+
+bool dcgw_queue_receive(discord_handle_t client, discord_payload_t **out_payload)
+{
+    xSemaphoreTake(client->queue_lock, portMAX_DELAY);
+    bool received = xQueueReceive(client->queue, out_payload, 0) == pdPASS;
+    xSemaphoreGive(client->queue_lock);
+
+    return received;
+}
+
+/**
+ * @brief Make room in the full queue by dropping the queued update superseded by the newer payload (if coalescing)
+ *        or the oldest droppable payload. Queue is emptied and refilled under the lock, so the order is kept
+ * @return True if there is room for the newer payload
+ */
+static bool dcgw_queue_evict(discord_handle_t client, discord_payload_t *newer, bool coalesce)
+{
+    xSemaphoreTake(client->queue_lock, portMAX_DELAY);
+
+    UBaseType_t waiting = uxQueueMessagesWaiting(client->queue);
+
+    if (waiting < client->config->queue_size) {
+        xSemaphoreGive(client->queue_lock);
+        return true; // consumer has just made room
+    }
+
+    discord_payload_t *payloads[waiting];
+    UBaseType_t len = 0;
+    int victim = -1;
+    bool coalesced = false;
+
+    while (len < waiting && xQueueReceive(client->queue, &payloads[len], 0) == pdPASS) {
+        len++;
+    }
+
+    for (UBaseType_t i = 0; i < len && !coalesced; i++) {
+        if (!dcgw_payload_is_droppable(payloads[i])) {
+            continue;
+        }
+
+        if (coalesce && dcgw_payload_supersedes(newer, payloads[i])) {
+            victim = i;
+            coalesced = true;
+        }
+        else if (victim < 0) {
+            victim = i; // the oldest one, unless superseded one is found
+        }
+    }
+
+    for (UBaseType_t i = 0; i < len; i++) {
+        if ((int)i != victim) {
+            xQueueSend(client->queue, &payloads[i], 0); // the same number of slots, so it always fits
+        }
+    }
+
+    xSemaphoreGive(client->queue_lock);
+
+    if (victim < 0) {
+        return false;
+    }
+
+    DISCORD_LOGD("Queued event %d dropped%s", payloads[victim]->t, coalesced ? " (coalesced)" : "");
+    discord_payload_free(payloads[victim]);
+    dcgw_queue_stats_count(client, coalesced ? &client->queue_stats.coalesced : &client->queue_stats.dropped_oldest);
+
+    return true;
+}
+
+/**
+ * @brief Put payload into the queue. If queue is full, configured policy decides which payload is dropped
+ */
+static void dcgw_queue_send(discord_handle_t client, discord_payload_t *payload)
+{
+    discord_queue_policy_t policy = dcgw_payload_is_droppable(payload) ? client->config->queue_policy
+                                                                        : DISCORD_QUEUE_POLICY_BLOCK;
+    TickType_t timeout = policy == DISCORD_QUEUE_POLICY_BLOCK ? 5000 / portTICK_PERIOD_MS : 0; // 5sec timeout
+    bool queued = xQueueSend(client->queue, &payload, timeout) == pdPASS;
+
+    if (!queued && (policy == DISCORD_QUEUE_POLICY_DROP_OLDEST || policy == DISCORD_QUEUE_POLICY_COALESCE)
+        && dcgw_queue_evict(client, payload, policy == DISCORD_QUEUE_POLICY_COALESCE)) {
+        queued = xQueueSend(client->queue, &payload, 0) == pdPASS; // decoder is the only producer
+    }
+
+    if (!queued) {
+        DISCORD_LOGW("Fail to queue the payload (event %d)", payload->t);
+        discord_payload_free(payload);
+        dcgw_queue_stats_count(client, &client->queue_stats.dropped_newest);
+        return;
+    }
+
+    DISCORD_TASK_NOTIFY(client);
+}
+
+/**
+ * @brief Decode member split out of GUILD_MEMBERS_CHUNK and hand it over to the member request handler.
+ *        Members are decoded before the rest of their chunk, so the handler gets them before the request completes
+ */
+static void dcgw_decode_member(discord_handle_t client, discord_gateway_frame_t *frame)
+{
+    discord_member_requester_t *requester = &client->member_requester;
+
+    portENTER_CRITICAL(&requester->lock);
+    discord_member_handler_t handler = requester->active ? requester->handler : NULL;
+    void *handler_arg = requester->arg;
+    portEXIT_CRITICAL(&requester->lock);
+
+    if (!handler) {
+        free(frame->data); // request timed out meanwhile
+        return;
+    }
+
+    discord_arena_handle_t arena = discord_arena_pool_acquire(client->arena_pool);
+    discord_member_t *member = NULL;
+
+    if (arena) {
+        cJSON *cjson = discord_json_parse_in_place(frame->data, frame->len, arena);
+        member = cjson ? discord_member_from_cjson(cjson, arena) : NULL;
+    }
+    else {
+        member = discord_json_deserialize_(member, frame->data, frame->len);
+    }
+
+    if (member) {
+        handler(client, member, handler_arg);
+    }
+    else {
+        DISCORD_LOGW("Fail to decode member");
+    }
+
+    if (arena) {
+        discord_arena_release(arena);
+    }
+    else {
+        discord_member_free(member);
+    }
+
+    free(frame->data);
+}
+
+/**
+ * @brief Deserialize gateway message and put it into the queue
+ */
+static void dcgw_decode_frame(discord_handle_t client, discord_gateway_frame_t *frame)
+{
+    discord_arena_handle_t arena = frame->arena;
+    discord_payload_t *payload = NULL;
+
+    if (arena) {
+        // zero-copy: tree and models point into the receive buffer, so the whole slot is handed over to the payload
+        cJSON *cjson = discord_json_parse_in_place(frame->data, frame->len, arena);
+        payload = cjson ? discord_payload_from_cjson(cjson, arena) : NULL;
+    }
+    else {
+        // if all arenas are in use, payload is simply allocated on the heap
+        arena = discord_arena_pool_acquire(client->arena_pool);
+        payload = discord_json_deserialize_in_(payload, frame->data, frame->len, arena);
+        free(frame->data);
+    }
+
+    if (!payload) {
+        DISCORD_LOGE("Fail to deserialize payload");
+        discord_arena_release(arena);
+        return;
+    }
+
+    payload->shard = frame->shard;
+    payload->connection = frame->connection;
+
+    dcgw_queue_send(client, payload); // filtered by the discord task, session of the shard is not touched here
+}
+
+static void dcgw_decoder_task(void *arg)
+{
+    discord_handle_t client = (discord_handle_t)arg;
+    discord_gateway_frame_t frame;
+
+    // frames of all shards are decoded in order of arrival. frame without data stops the decoder
+    while (xQueueReceive(client->gw_frames, &frame, portMAX_DELAY) == pdPASS && frame.data) {
+        if (frame.member) {
+            dcgw_decode_member(client, &frame);
+        }
+        else {
+            dcgw_decode_frame(client, &frame);
         }
+    }
+
+    DISCORD_LOGD("Decoder exit.");
+    xSemaphoreGive(client->gw_decoder_done);
+    vTaskDelete(NULL);
+}
 
-        switch (payload->t) {
-            case DISCORD_EVENT_MESSAGE_RECEIVED:
-            case DISCORD_EVENT_MESSAGE_UPDATED: {
-                discord_message_t *msg = (discord_message_t *)payload->d;
+/**
+ * @brief Stop decoder once websockets are closed. Payload queue is flushed meanwhile, so the decoder never waits for it
+ */
+static void dcgw_decoder_stop(discord_handle_t client)
+{
+    if (!client->gw_decoder) {
+        return;
+    }
+
+    discord_gateway_frame_t stop = { 0 };
+
+    while (xQueueSend(client->gw_frames, &stop, 10 / portTICK_PERIOD_MS) != pdPASS) {
+        dcgw_queue_flush(client);
+    }
+
+    while (xSemaphoreTake(client->gw_decoder_done, 10 / portTICK_PERIOD_MS) != pdTRUE) {
+        dcgw_queue_flush(client);
+    }
+
+    client->gw_decoder = NULL;
+}
+
+/**
+ * @brief Reset buffer for the next gateway message
+ */
+static void dcgw_buffer_reset(discord_shard_t *shard)
+{
+    discord_handle_t client = shard->client;
+
+    shard->gw_buffer_len = 0;
+    shard->gw_buffer_overflow = false;
+    shard->gw_filter_active = false;
+    shard->gw_splitter_active = false;
+
+    if (client->config->gateway_zero_copy && !shard->gw_slot) {
+        // previous buffer is handed over to the payload, so receive into the new one
+        char *buffer = NULL;
+
+        if ((shard->gw_slot = discord_arena_pool_acquire(client->arena_pool))
+            && !(buffer = discord_arena_alloc(shard->gw_slot, client->config->gateway_buffer_size + 1))) {
+            discord_arena_release(shard->gw_slot);
+            shard->gw_slot = NULL;
+        }
+
+        shard->gw_buffer = buffer ? buffer : shard->gw_heap_buffer;
+    }
+}
 
-                if (!msg || !msg->author
-                    || !(msg->type == DISCORD_MESSAGE_DEFAULT || msg->type == DISCORD_MESSAGE_REPLY)
-                    ||                                                     // ignore if not default or reply type
-                    estr_eq(msg->author->id, client->session->user->id)) { // ignore our messages
-                    return false;
-                }
-            } break;
+/**
+ * @brief Write chunk of gateway message to the buffer.
+ *        Once message grows over the buffer size, already buffered part is compacted in place
+ *        and the rest of the message is streamed through the filter which keeps only fields used by decoders
+ */
+static esp_err_t dcgw_buffer_write(discord_shard_t *shard, const char *data, size_t len)
+{
+    if (shard->gw_buffer_overflow) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t size = shard->client->config->gateway_buffer_size;
+    size_t buffer_len = shard->gw_buffer_len;
+    esp_err_t err = ESP_OK;
+
+    if (!shard->gw_filter_active) {
+        if (buffer_len + len <= size) {
+            memcpy(shard->gw_buffer + buffer_len, data, len);
+            shard->gw_buffer_len += len;
+            return ESP_OK;
+        }
+
+        DISCORD_LOGD("Message exceeds the buffer. Filtering unused fields...");
+
+        shard->gw_filter_active = true;
+        discord_json_filter_reset(shard->gw_filter);
+        buffer_len = 0;
+        err = discord_json_filter_write(shard->gw_filter,
+            shard->gw_buffer,
+            shard->gw_buffer_len,
+            shard->gw_buffer,
+            size,
+            &buffer_len);
+    }
+
+    if (err == ESP_OK) {
+        err = discord_json_filter_write(shard->gw_filter, data, len, shard->gw_buffer, size, &buffer_len);
+    }
+
+    shard->gw_buffer_len = buffer_len;
+
+    if (err != ESP_OK) {
+        shard->gw_buffer_overflow = true;
+    }
+
+    return err;
+}
+
+static esp_err_t dcgw_splitter_write_cb(void *arg, const char *data, size_t len)
+{
+    return dcgw_buffer_write((discord_shard_t *)arg, data, len);
+}
+
+/**
+ * @brief Hand member split out of GUILD_MEMBERS_CHUNK over to the decoder, in order with the rest of the messages
+ */
+static void dcgw_splitter_element_cb(void *arg, char *element, size_t len)
+{
+    discord_shard_t *shard = (discord_shard_t *)arg;
+    discord_handle_t client = shard->client;
+    discord_member_requester_t *requester = &client->member_requester;
+
+    portENTER_CRITICAL(&requester->lock);
+    bool wanted = requester->active && requester->handler;
+    portEXIT_CRITICAL(&requester->lock);
+
+    if (!wanted) {
+        return; // no request or it timed out
+    }
+
+    discord_gateway_frame_t frame = {
+        .shard = shard - client->shards,
+        .connection = shard->gw_connection,
+        .data = malloc(len + 1), // arenas of the pool are left for whole messages
+        .len = len,
+        .member = true,
+    };
+
+    if (!frame.data) {
+        DISCORD_LOGE("Fail to allocate member");
+        return;
+    }
+
+    memcpy(frame.data, element, len);
+    frame.data[len] = '\0';
+
+    if (xQueueSend(client->gw_frames, &frame, 5000 / portTICK_PERIOD_MS) != pdPASS) { // 5sec timeout
+        DISCORD_LOGW("Fail to queue the member");
+        dcgw_frame_free(&frame);
+        dcgw_queue_stats_count(client, &client->queue_stats.dropped_newest);
+    }
+}
+
+/**
+ * @brief Append chunk of gateway message to the buffer.
+ *        While member request is in progress, members of GUILD_MEMBERS_CHUNK are split out of the message
+ *        and decoded one by one, so only the small rest of the message ends up in the buffer
+ */
+static esp_err_t dcgw_buffer_append(discord_shard_t *shard, const char *data, size_t len)
+{
+    if (shard->gw_buffer_len == 0 && !shard->gw_splitter_active && !shard->gw_filter_active
+        && shard->gw_splitter && dcgw_member_request_is_active(shard->client)) {
+        // message starts
+        discord_json_splitter_reset(shard->gw_splitter);
+        shard->gw_splitter_active = true;
+    }
 
-            case DISCORD_EVENT_MESSAGE_REACTION_ADDED:
-            case DISCORD_EVENT_MESSAGE_REACTION_REMOVED: {
-                discord_message_reaction_t *react = (discord_message_reaction_t *)payload->d;
+    if (!shard->gw_splitter_active) {
+        return dcgw_buffer_write(shard, data, len);
+    }
 
-                // ignore our reactions
-                if (!react || !react->emoji || estr_eq(react->user_id, client->session->user->id)) {
-                    return false;
-                }
-            } break;
+    esp_err_t err = discord_json_splitter_write(shard->gw_splitter, data, len);
 
-            default:
-                break;
-        }
+    if (err != ESP_OK) {
+        shard->gw_buffer_overflow = true;
     }
 
-    return true;
+    return err;
 }
 
-static discord_close_code_t dcgw_get_close_opcode(discord_handle_t client)
+/**
+ * @brief Handle gateway message once it is completely buffered
+ */
+static esp_err_t dcgw_buffer_done(discord_shard_t *shard)
 {
-    if (client->state == DISCORD_STATE_DISCONNECTING && client->gw_buffer_len >= 2) {
-        int code = (256 * client->gw_buffer[0] + client->gw_buffer[1]);
-        return code >= _DISCORD_CLOSEOP_MIN && code <= _DISCORD_CLOSEOP_MAX ? code : DISCORD_CLOSEOP_NO_CODE;
+    esp_err_t err = ESP_FAIL;
+
+    if (shard->gw_buffer_overflow) {
+        DISCORD_LOGW("Payload too big. Wider buffer required.");
     }
+    else {
+        DISCORD_LOGD("Buffering done (len=%d%s)", shard->gw_buffer_len, shard->gw_filter_active ? ", filtered" : "");
 
-    return DISCORD_CLOSEOP_NO_CODE;
+        // append null terminator
+        shard->gw_buffer[shard->gw_buffer_len] = '\0';
+        err = dcgw_handle_buffer(shard);
+    }
+
+    dcgw_buffer_reset(shard);
+
+    return err;
 }
 
-static esp_err_t dcgw_buffer_websocket_data(discord_handle_t client, esp_websocket_event_data_t *data)
+static esp_err_t dcgw_buffer_websocket_data(discord_shard_t *shard, esp_websocket_event_data_t *data)
 {
     DISCORD_LOG_FOO();
 
-    if (data->payload_len > client->config->gateway_buffer_size) {
-        DISCORD_LOGW("Payload too big. Wider buffer required.");
-        return ESP_FAIL;
+    DISCORD_LOGD("Buffering received data:\n%.*s", data->data_len, data->data_ptr);
+
+    if (data->payload_offset == 0) {
+        dcgw_buffer_reset(shard);
     }
 
-    DISCORD_LOGD("Buffering received data:\n%.*s", data->data_len, data->data_ptr);
+    if (data->op_code == WS_TRANSPORT_OPCODES_CLOSE) {
+        // close frame holds binary close code, never filter it
+        size_t len = shard->client->config->gateway_buffer_size - shard->gw_buffer_len;
+
+        if (data->data_len < len) {
+            len = data->data_len;
+        }
 
-    memcpy(client->gw_buffer + data->payload_offset, data->data_ptr, data->data_len);
+        memcpy(shard->gw_buffer + shard->gw_buffer_len, data->data_ptr, len);
+        shard->gw_buffer_len += len;
+    }
+    else {
+        dcgw_buffer_append(shard, data->data_ptr, data->data_len);
+    }
 
-    if ((client->gw_buffer_len = data->data_len + data->payload_offset) >= data->payload_len) {
-        DISCORD_LOGD("Buffering done");
+    if (data->data_len + data->payload_offset < data->payload_len) {
+        return ESP_OK; // wait for the rest of the frame
+    }
 
-        // append null terminator
-        client->gw_buffer[client->gw_buffer_len] = '\0';
+    if (data->op_code == WS_TRANSPORT_OPCODES_CLOSE) {
+        shard->gw_buffer[shard->gw_buffer_len] = '\0';
+        shard->state = DISCORD_STATE_DISCONNECTING;
+        shard->close_code = dcgw_get_close_opcode(shard);
 
-        if (data->op_code == WS_TRANSPORT_OPCODES_CLOSE) {
-            client->state = DISCORD_STATE_DISCONNECTING;
-            client->close_code = dcgw_get_close_opcode(client);
+        return ESP_OK;
+    }
 
-            return ESP_OK;
-        }
+    return dcgw_buffer_done(shard);
+}
 
-        discord_payload_t *payload = discord_json_deserialize_(payload, client->gw_buffer, client->gw_buffer_len);
+static esp_err_t dcgw_zlib_write_cb(void *arg, const char *data, size_t len)
+{
+    return dcgw_buffer_append((discord_shard_t *)arg, data, len);
+}
 
-        if (!payload) {
-            DISCORD_LOGE("Fail to deserialize payload");
-            return ESP_FAIL;
-        }
+/**
+ * @brief Inflate chunk of zlib-stream into the buffer.
+ *        One gateway message can be split into multiple websocket frames,
+ *        and it is complete only when stream is flushed
+ */
+static esp_err_t dcgw_inflate_websocket_data(discord_shard_t *shard, esp_websocket_event_data_t *data)
+{
+    DISCORD_LOG_FOO();
 
-        if (payload->s != DISCORD_NULL_SEQUENCE_NUMBER) {
-            client->last_sequence_number = payload->s;
-        }
+    if (!shard->zlib) {
+        DISCORD_LOGW("Received compressed data but compression is not enabled");
+        return ESP_FAIL;
+    }
 
-        if (!dcgw_whether_payload_should_go_into_queue(client, payload)) {
-            DISCORD_LOGD("Payload ignored");
-            discord_payload_free(payload);
-        }
-        else if (xQueueSend(client->queue, &payload, 5000 / portTICK_PERIOD_MS) != pdPASS) { // 5sec timeout
-            DISCORD_LOGW("Fail to queue the payload");
-            discord_payload_free(payload);
-        }
+    if (discord_zlib_inflate(shard->zlib, data->data_ptr, data->data_len, dcgw_zlib_write_cb, shard) == ESP_FAIL) {
+        DISCORD_LOGE("Fail to inflate gateway stream");
+        dcgw_buffer_reset(shard);
+        shard->state = DISCORD_STATE_ERROR;
+        return ESP_FAIL;
     }
 
-    return ESP_OK;
+    if (!discord_zlib_is_flushed(shard->zlib)) {
+        return ESP_OK; // wait for the rest of the message
+    }
+
+    return dcgw_buffer_done(shard);
 }
 
 static void dcgw_websocket_event_handler(void *handler_arg, esp_event_base_t base, int32_t event_id, void *event_data)
 {
-    discord_handle_t client = (discord_handle_t)handler_arg;
+    discord_shard_t *shard = (discord_shard_t *)handler_arg;
     esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
 
     if (data->op_code == WS_TRANSPORT_OPCODES_PONG) { // ignore PONG frame
@@ -140,68 +857,104 @@ static void dcgw_websocket_event_handler(void *handler_arg, esp_event_base_t bas
     switch (event_id) {
         case WEBSOCKET_EVENT_BEFORE_CONNECT:
         case WEBSOCKET_EVENT_CONNECTED:
-            client->state = DISCORD_STATE_CONNECTING;
+            shard->state = DISCORD_STATE_CONNECTING;
             break;
 
         case WEBSOCKET_EVENT_DATA:
             if (data->op_code == WS_TRANSPORT_OPCODES_TEXT || data->op_code == WS_TRANSPORT_OPCODES_CLOSE) {
-                dcgw_buffer_websocket_data(client, data);
+                dcgw_buffer_websocket_data(shard, data);
+            }
+            else if (data->op_code == WS_TRANSPORT_OPCODES_BINARY) {
+                dcgw_inflate_websocket_data(shard, data);
             }
             break;
 
         case WEBSOCKET_EVENT_ERROR:
-            client->state = DISCORD_STATE_ERROR;
+            shard->state = DISCORD_STATE_ERROR;
             break;
 
         case WEBSOCKET_EVENT_DISCONNECTED:
-            client->state = DISCORD_STATE_DISCONNECTED;
+            shard->state = DISCORD_STATE_DISCONNECTED;
             break;
 
         case WEBSOCKET_EVENT_CLOSED:
-            client->state = DISCORD_STATE_DISCONNECTED;
+            shard->state = DISCORD_STATE_DISCONNECTED;
             break;
 
         default:
             DISCORD_LOGW("Unknown ws event %" PRIu32, event_id);
             break;
     }
+
+    DISCORD_TASK_NOTIFY(shard->client); // state may be changed
 }
 
-esp_err_t dcgw_init(discord_handle_t client)
+/**
+ * @brief IDENTIFY never changes, so it is serialized only once
+ */
+static char *dcgw_identify_serialize(discord_shard_t *shard)
 {
-    DISCORD_LOG_FOO();
+    char os[48];
+    snprintf(os, sizeof(os), "esp-idf (%s)", esp_get_idf_version());
+
+    discord_identify_t identify = {
+        .token = shard->client->config->token,
+        .intents = shard->client->config->intents,
+        .properties = &(discord_identify_properties_t) {
+            .os = os,
+            .browser = "esp-discord (" CONFIG_IDF_TARGET ")",
+            .device = CONFIG_IDF_TARGET,
+        },
+        .shard_id = shard->id,
+        .shard_count = shard->client->config->shards.total,
+    };
 
-    if (client->state >= DISCORD_STATE_INIT) {
-        DISCORD_LOGW("Already inited");
-        return ESP_OK;
-    }
+    return discord_json_write_payload_alloc(&(discord_payload_t) { .op = DISCORD_OP_IDENTIFY, .d = &identify });
+}
+
+static esp_err_t dcgw_shard_init(discord_shard_t *shard)
+{
+    discord_handle_t client = shard->client;
 
-    if (!(client->gw_lock = xSemaphoreCreateMutex())
-        || !(client->queue = xQueueCreate(client->config->queue_size, sizeof(discord_payload_t *)))) {
+    if (!(shard->gw_lock = xSemaphoreCreateMutex())
+        || !(shard->gw_tx_queue = xQueueCreate(DISCORD_GW_TX_QUEUE_SIZE, sizeof(char *)))) {
         DISCORD_LOGE("Fail to create mutex/queue");
-        dcgw_destroy(client);
         return ESP_FAIL;
     }
 
-    if (!(client->gw_buffer = malloc(client->config->gateway_buffer_size + 1))) {
+    if (!(shard->gw_buffer = shard->gw_heap_buffer = malloc(client->config->gateway_buffer_size + 1))) {
         DISCORD_LOGE("Fail to allocate buffer");
-        dcgw_destroy(client);
         return ESP_FAIL;
     }
 
-    dcgw_heartbeat_stop(client);
-    client->last_sequence_number = DISCORD_NULL_SEQUENCE_NUMBER;
-    client->close_reason = DISCORD_CLOSE_REASON_NOT_REQUESTED;
-    client->close_code = DISCORD_CLOSEOP_NO_CODE;
-    client->gw_buffer_len = 0;
-    client->state = DISCORD_STATE_INIT;
+    if (!(shard->gw_filter = discord_json_filter_create(discord_json_keys))) {
+        DISCORD_LOGE("Fail to allocate buffer filter");
+        return ESP_FAIL;
+    }
+
+    if (!(shard->gw_identify = dcgw_identify_serialize(shard))) {
+        DISCORD_LOGE("Fail to serialize IDENTIFY");
+        return ESP_FAIL;
+    }
+
+    if (client->config->gateway_compression && !(shard->zlib = discord_zlib_create())) {
+        DISCORD_LOGE("Fail to allocate inflate context");
+        return ESP_FAIL;
+    }
+
+    dcgw_heartbeat_stop(shard);
+    shard->last_sequence_number = DISCORD_NULL_SEQUENCE_NUMBER;
+    shard->close_reason = DISCORD_CLOSE_REASON_NOT_REQUESTED;
+    shard->close_code = DISCORD_CLOSEOP_NO_CODE;
+    dcgw_buffer_reset(shard);
+    shard->state = DISCORD_STATE_INIT;
 
 #ifndef CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY
     extern const uint8_t gateway_crt[] asm("_binary_gateway_pem_start");
 #endif
 
     esp_websocket_client_config_t ws_cfg = {
-        .uri = DISCORD_GW_URL,
+        .uri = DISCORD_GW_HOST DISCORD_GW_QUERY,
         .buffer_size = 512,
 #ifndef CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY
         .cert_pem = (const char *)gateway_crt,
@@ -211,68 +964,449 @@ esp_err_t dcgw_init(discord_handle_t client)
         .network_timeout_ms = 5000,
     };
 
-    if (!(client->ws = esp_websocket_client_init(&ws_cfg))) {
+    if (!(shard->ws = esp_websocket_client_init(&ws_cfg))) {
         DISCORD_LOGE("Fail to create ws client");
+        return ESP_FAIL;
+    }
+
+    if (esp_websocket_register_events(shard->ws, WEBSOCKET_EVENT_ANY, dcgw_websocket_event_handler, (void *)shard)
+        != ESP_OK) {
+        DISCORD_LOGE("Fail to register ws handler");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t dcgw_init(discord_handle_t client)
+{
+    DISCORD_LOG_FOO();
+
+    if (client->shards) {
+        DISCORD_LOGW("Already inited");
+        return ESP_OK;
+    }
+
+    if (!(client->queue = xQueueCreate(client->config->queue_size, sizeof(discord_payload_t *)))
+        || !(client->control_queue = xQueueCreate(
+                 DISCORD_GW_CONTROL_QUEUE_SIZE * client->config->shards.count, sizeof(discord_payload_t *)))
+        || !(client->queue_lock = xSemaphoreCreateMutex())
+        || !(client->gw_frames = xQueueCreate(DISCORD_GW_FRAME_QUEUE_SIZE, sizeof(discord_gateway_frame_t)))
+        || !(client->gw_decoder_done = xSemaphoreCreateBinary())) {
+        DISCORD_LOGE("Fail to create queue");
+        dcgw_destroy(client);
+        return ESP_FAIL;
+    }
+
+    // one arena per queued payload, plus the one being handled and the one being decoded.
+    // in zero-copy mode each arena also holds the receive buffer, so queued frames
+    // and the one being received by each shard need their own arenas as well
+    size_t arena_size = DISCORD_DEFAULT_ARENA_SIZE;
+    size_t arena_count = client->config->queue_size + 2;
+
+    if (client->config->gateway_zero_copy) {
+        arena_size += client->config->gateway_buffer_size + 1;
+        arena_count += DISCORD_GW_FRAME_QUEUE_SIZE + client->config->shards.count;
+    }
+
+    if (!(client->arena_pool = discord_arena_pool_create(arena_count, arena_size))) {
+        DISCORD_LOGE("Fail to create arena pool");
+        dcgw_destroy(client);
+        return ESP_FAIL;
+    }
+
+    if (!(client->shards = calloc(client->config->shards.count, sizeof(discord_shard_t)))) {
+        DISCORD_LOGE("Fail to allocate shards");
+        dcgw_destroy(client);
+        return ESP_FAIL;
+    }
+
+    client->shards_len = client->config->shards.count;
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        discord_shard_t *shard = &client->shards[i];
+        shard->id = client->config->shards.first + i;
+        shard->client = client;
+
+        if (dcgw_shard_init(shard) != ESP_OK) {
+            DISCORD_LOGE("Fail to init shard %d", shard->id);
+            dcgw_destroy(client);
+            return ESP_FAIL;
+        }
+    }
+
+    if (xTaskCreate(dcgw_decoder_task,
+            "discord_decode",
+            DISCORD_GW_DECODE_TASK_STACK_SIZE,
+            client,
+            client->config->task_priority,
+            &client->gw_decoder)
+        != pdPASS) {
+        DISCORD_LOGE("Fail to create decoder task");
+        client->gw_decoder = NULL;
         dcgw_destroy(client);
         return ESP_FAIL;
     }
 
-    if (esp_websocket_register_events(client->ws, WEBSOCKET_EVENT_ANY, dcgw_websocket_event_handler, (void *)client)
-        != ESP_OK) {
-        DISCORD_LOGE("Fail to register ws handler");
-        dcgw_destroy(client);
-        return ESP_FAIL;
+    return ESP_OK;
+}
+
+#define DCGW_LIMITER_BURST     (DISCORD_GW_RATE_LIMIT / 2)
+#define DCGW_LIMITER_REFILL_MS (DISCORD_GW_RATE_LIMIT_PERIOD / DCGW_LIMITER_BURST)
+
+static void dcgw_limiter_reset(discord_shard_t *shard)
+{
+    shard->gw_limiter.tokens = DCGW_LIMITER_BURST;
+    shard->gw_limiter.refill_ms = discord_tick_ms();
+}
+
+static void dcgw_limiter_refill(discord_shard_t *shard)
+{
+    discord_gateway_limiter_t *limiter = &shard->gw_limiter;
+    uint64_t now = discord_tick_ms();
+    uint64_t refills = (now - limiter->refill_ms) / DCGW_LIMITER_REFILL_MS;
+
+    if (limiter->tokens + refills >= DCGW_LIMITER_BURST) {
+        limiter->tokens = DCGW_LIMITER_BURST;
+        limiter->refill_ms = now;
+        return;
+    }
+
+    limiter->tokens += refills;
+    limiter->refill_ms += refills * DCGW_LIMITER_REFILL_MS; // keep the remainder for the next token
+}
+
+/**
+ * @brief Take a token. Regular commands cannot use the reserved tokens, priority ones (heartbeat, identify...) can
+ */
+static bool dcgw_limiter_take(discord_shard_t *shard, bool priority)
+{
+    dcgw_limiter_refill(shard);
+
+    if (shard->gw_limiter.tokens <= (priority ? 0 : DISCORD_GW_RATE_LIMIT_RESERVED)) {
+        return false;
+    }
+
+    shard->gw_limiter.tokens--;
+
+    return true;
+}
+
+/**
+ * @brief Give back the token which has not been used after all
+ */
+static void dcgw_limiter_give(discord_shard_t *shard)
+{
+    if (shard->gw_limiter.tokens < DCGW_LIMITER_BURST) {
+        shard->gw_limiter.tokens++;
+    }
+}
+
+/**
+ * @brief Send serialized payload. Payload is not freed
+ */
+static esp_err_t dcgw_send_text(discord_shard_t *shard, const char *payload_raw)
+{
+    if (xSemaphoreTake(shard->gw_lock, 5000 / portTICK_PERIOD_MS) != pdTRUE) { // 5sec timeout
+        DISCORD_LOGW("Gateway is locked");
+        return ESP_FAIL;
+    }
+
+    DISCORD_LOGD("%s", payload_raw);
+
+    int sent_bytes = esp_websocket_client_send_text(shard->ws,
+        payload_raw,
+        strlen(payload_raw),
+        5000 / portTICK_PERIOD_MS); // 5sec timeout
+
+    if (sent_bytes == ESP_FAIL) {
+        DISCORD_LOGW("Fail to send data to gateway (shard %d)", shard->id);
+        shard->state = DISCORD_STATE_ERROR;
+        xSemaphoreGive(shard->gw_lock);
+        return ESP_FAIL;
+    }
+
+    xSemaphoreGive(shard->gw_lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Send serialized payload. Raw payload is freed
+ */
+static esp_err_t dcgw_send_raw(discord_shard_t *shard, char *payload_raw)
+{
+    esp_err_t err = dcgw_send_text(shard, payload_raw);
+    free(payload_raw);
+
+    return err;
+}
+
+/**
+ * @brief Send serialized heartbeat, IDENTIFY or RESUME. They bypass the send queue
+ */
+static esp_err_t dcgw_send_command(discord_shard_t *shard, const char *payload_raw)
+{
+    if (!dcgw_limiter_take(shard, true)) {
+        // losing heartbeat or identify would cost the connection anyway, so send it and hope for the best
+        DISCORD_LOGW("Gateway rate limit exhausted");
+    }
+
+    return dcgw_send_text(shard, payload_raw);
+}
+
+esp_err_t dcgw_send(discord_shard_t *shard, discord_payload_t *payload)
+{
+    DISCORD_LOG_FOO();
+
+    discord_json_writer_t writer;
+    discord_json_writer_init(&writer, shard->gw_tx_buffer, sizeof(shard->gw_tx_buffer));
+    esp_err_t err = discord_json_write_payload(&writer, payload);
+
+    if (err == ESP_OK) {
+        return dcgw_send_command(shard, shard->gw_tx_buffer);
+    }
+
+    if (err != ESP_ERR_INVALID_SIZE) {
+        return err;
+    }
+
+    char *payload_raw = discord_json_write_payload_alloc(payload); // does not fit (very long token?)
+
+    if (!payload_raw) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    err = dcgw_send_command(shard, payload_raw);
+    free(payload_raw);
+
+    return err;
+}
+
+esp_err_t dcgw_enqueue(discord_shard_t *shard, discord_payload_t *payload)
+{
+    if (!shard || !payload) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!shard->gw_tx_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // caller is not the discord task which owns the send buffer, so queued command is written into its own one
+    char *payload_raw = discord_json_write_payload_alloc(payload);
+
+    if (!payload_raw) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xQueueSend(shard->gw_tx_queue, &payload_raw, 0) != pdPASS) {
+        DISCORD_LOGW("Gateway send queue is full");
+        free(payload_raw);
+        return ESP_FAIL;
+    }
+
+    DISCORD_TASK_NOTIFY(shard->client);
+
+    return ESP_OK;
+}
+
+static uint32_t dcgw_limiter_due_ms(discord_shard_t *shard)
+{
+    dcgw_limiter_refill(shard);
+
+    if (shard->gw_limiter.tokens > DISCORD_GW_RATE_LIMIT_RESERVED) {
+        return 0;
+    }
+
+    return DCGW_LIMITER_REFILL_MS - (uint32_t)(discord_tick_ms() - shard->gw_limiter.refill_ms);
+}
+
+static uint32_t dcgw_presence_due_ms(discord_shard_t *shard)
+{
+    portENTER_CRITICAL(&shard->client->gw_presence_lock);
+    bool pending = shard->gw_presence != NULL;
+    portEXIT_CRITICAL(&shard->client->gw_presence_lock);
+
+    if (!pending) {
+        return UINT32_MAX;
+    }
+
+    if (!shard->gw_presence_sent_ms) {
+        return 0;
+    }
+
+    uint64_t elapsed = discord_tick_ms() - shard->gw_presence_sent_ms;
+
+    return elapsed >= DISCORD_GW_PRESENCE_INTERVAL ? 0 : DISCORD_GW_PRESENCE_INTERVAL - elapsed;
+}
+
+static char *dcgw_presence_take(discord_shard_t *shard)
+{
+    portENTER_CRITICAL(&shard->client->gw_presence_lock);
+    char *payload_raw = shard->gw_presence;
+    shard->gw_presence = NULL;
+    portEXIT_CRITICAL(&shard->client->gw_presence_lock);
+
+    return payload_raw;
+}
+
+esp_err_t dcgw_presence_set(discord_handle_t client, char *payload_raw)
+{
+    if (!client || !payload_raw) {
+        free(payload_raw);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!client->shards) {
+        free(payload_raw);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        discord_shard_t *shard = &client->shards[i];
+        char *copy = i + 1 < client->shards_len ? strdup(payload_raw) : payload_raw; // last shard takes the original
+
+        if (!copy) {
+            free(payload_raw);
+            return ESP_ERR_NO_MEM;
+        }
+
+        portENTER_CRITICAL(&client->gw_presence_lock);
+        char *previous = shard->gw_presence;
+        shard->gw_presence = copy;
+        portEXIT_CRITICAL(&client->gw_presence_lock);
+
+        if (previous) {
+            DISCORD_LOGD("Pending presence update replaced with the newer one");
+            free(previous);
+        }
+    }
+
+    DISCORD_TASK_NOTIFY(client);
+
+    return ESP_OK;
+}
+
+esp_err_t dcgw_tx_flush(discord_shard_t *shard)
+{
+    char *payload_raw = NULL;
+
+    while (shard->state == DISCORD_STATE_CONNECTED && xQueuePeek(shard->gw_tx_queue, &payload_raw, 0) == pdPASS) {
+        if (!dcgw_limiter_take(shard, false)) {
+            return ESP_OK; // dcgw_tx_due_ms tells when to try again
+        }
+
+        xQueueReceive(shard->gw_tx_queue, &payload_raw, 0);
+
+        if (dcgw_send_raw(shard, payload_raw) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+
+    if (shard->state == DISCORD_STATE_CONNECTED && dcgw_presence_due_ms(shard) == 0
+        && dcgw_limiter_take(shard, false)) {
+        if (!(payload_raw = dcgw_presence_take(shard))) {
+            dcgw_limiter_give(shard); // slot has been emptied since it was checked
+            return ESP_OK;
+        }
+
+        shard->gw_presence_sent_ms = discord_tick_ms();
+        return dcgw_send_raw(shard, payload_raw);
     }
 
     return ESP_OK;
 }
 
-esp_err_t dcgw_send(discord_handle_t client, discord_payload_t *payload)
+uint32_t dcgw_tx_due_ms(discord_shard_t *shard)
 {
-    DISCORD_LOG_FOO();
-
-    if (xSemaphoreTake(client->gw_lock, 5000 / portTICK_PERIOD_MS) != pdTRUE) { // 5sec timeout
-        DISCORD_LOGW("Gateway is locked");
-        return ESP_FAIL;
+    if (shard->state != DISCORD_STATE_CONNECTED) {
+        return UINT32_MAX;
     }
 
-    char *payload_raw = discord_json_serialize(payload);
-    discord_payload_free(payload);
+    bool queued = shard->gw_tx_queue && uxQueueMessagesWaiting(shard->gw_tx_queue) > 0;
+    uint32_t presence_due = dcgw_presence_due_ms(shard);
 
-    DISCORD_LOGD("%s", payload_raw);
+    if (!queued && presence_due == UINT32_MAX) {
+        return UINT32_MAX;
+    }
 
-    int sent_bytes = esp_websocket_client_send_text(client->ws,
-        payload_raw,
-        strlen(payload_raw),
-        5000 / portTICK_PERIOD_MS); // 5sec timeout
-    free(payload_raw);
+    uint32_t limiter_due = dcgw_limiter_due_ms(shard);
 
-    if (sent_bytes == ESP_FAIL) {
-        DISCORD_LOGW("Fail to send data to gateway");
-        client->state = DISCORD_STATE_ERROR;
-        xSemaphoreGive(client->gw_lock);
-        return ESP_FAIL;
+    if (queued || limiter_due > presence_due) {
+        return limiter_due;
     }
 
-    xSemaphoreGive(client->gw_lock);
+    return presence_due;
+}
+
+static void dcgw_tx_queue_flush(discord_shard_t *shard)
+{
+    char *payload_raw = NULL;
 
-    return ESP_OK;
+    while (xQueueReceive(shard->gw_tx_queue, &payload_raw, 0) == pdPASS) {
+        free(payload_raw);
+    }
 }
 
-esp_err_t dcgw_get_close_desc(discord_handle_t client, char **out_description)
+esp_err_t dcgw_get_close_desc(discord_shard_t *shard, char **out_description)
 {
-    if (!client || !out_description) {
+    if (!shard || !out_description) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    *out_description = client->close_code != DISCORD_CLOSEOP_NO_CODE ? client->gw_buffer + 2 : NULL;
+    *out_description = shard->close_code != DISCORD_CLOSEOP_NO_CODE ? shard->gw_buffer + 2 : NULL;
 
     return ESP_OK;
 }
 
 bool dcgw_is_open(discord_handle_t client)
 {
-    return client && client->state >= DISCORD_STATE_OPEN;
+    if (!client || !client->shards) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        if (client->shards[i].state >= DISCORD_STATE_OPEN) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool dcgw_is_connected(discord_handle_t client)
+{
+    if (!client || !client->shards) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        if (client->shards[i].state >= DISCORD_STATE_CONNECTED) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+discord_gateway_state_t dcgw_get_state(discord_handle_t client)
+{
+    if (!client || !client->shards) {
+        return DISCORD_STATE_UNKNOWN;
+    }
+
+    discord_gateway_state_t state = DISCORD_STATE_CONNECTED;
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        discord_gateway_state_t shard_state = client->shards[i].state;
+
+        if (shard_state != DISCORD_STATE_CONNECTED && (state == DISCORD_STATE_CONNECTED || shard_state < state)) {
+            state = shard_state;
+        }
+    }
+
+    return state;
 }
 
 esp_err_t dcgw_open(discord_handle_t client)
@@ -282,61 +1416,158 @@ esp_err_t dcgw_open(discord_handle_t client)
 
     DISCORD_LOG_FOO();
 
+    if (!client->shards) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
     if (dcgw_is_open(client)) {
         DISCORD_LOGD("Already open");
         return ESP_OK;
     }
 
-    return dcgw_start(client);
+    esp_err_t err = ESP_OK;
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        dcgw_session_restore(&client->shards[i]);
+    }
+
+    for (uint16_t i = 0; i < client->shards_len; i++) {
+        esp_err_t shard_err = dcgw_start(&client->shards[i]); // failed shard is reconnected by the discord task
+
+        if (err == ESP_OK) {
+            err = shard_err;
+        }
+    }
+
+    return err;
 }
 
-esp_err_t dcgw_start(discord_handle_t client)
+esp_err_t dcgw_start(discord_shard_t *shard)
 {
     DISCORD_LOG_FOO();
 
-    if (dcgw_is_open(client)) {
+    if (shard->state >= DISCORD_STATE_OPEN) {
         DISCORD_LOGD("Already started");
         return ESP_OK;
     }
 
-    client->close_reason = DISCORD_CLOSE_REASON_NOT_REQUESTED;
-    esp_err_t err = esp_websocket_client_start(client->ws);
-    client->state = err == ESP_OK ? DISCORD_STATE_OPEN : DISCORD_STATE_ERROR;
+    shard->close_reason = DISCORD_CLOSE_REASON_NOT_REQUESTED;
+    shard->gw_connection++;
+    dcgw_limiter_reset(shard); // limit is per connection
+    shard->gw_presence_sent_ms = 0;
+
+    bool resume = dcgw_session_is_resumable(shard) && shard->session->resume_gateway_url;
+
+    char *url = estr_cat(resume ? shard->session->resume_gateway_url : DISCORD_GW_HOST,
+        DISCORD_GW_QUERY,
+        shard->zlib ? DISCORD_GW_QUERY_COMPRESS : "");
+
+    if (!url) {
+        shard->state = DISCORD_STATE_ERROR;
+        return ESP_ERR_NO_MEM;
+    }
+
+    DISCORD_LOGD("Connecting shard %d to %s", shard->id, url);
+    esp_websocket_client_set_uri(shard->ws, url);
+    free(url);
+
+    // new connection starts new zlib stream
+    discord_zlib_reset(shard->zlib);
+    dcgw_buffer_reset(shard);
+
+    esp_err_t err = esp_websocket_client_start(shard->ws);
+    shard->state = err == ESP_OK ? DISCORD_STATE_OPEN : DISCORD_STATE_ERROR;
 
     return err;
 }
 
-esp_err_t dcgw_close(discord_handle_t client, discord_gateway_close_reason_t reason)
+esp_err_t dcgw_close(discord_shard_t *shard, discord_gateway_close_reason_t reason)
 {
     DISCORD_LOG_FOO();
 
-    if (!client) {
+    if (!shard) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // do not set client status in this function
+    // do not set shard status in this function
     // it will be automatically set in ws task
 
-    if (client->gw_lock) {
-        xSemaphoreTake(client->gw_lock, portMAX_DELAY);
+    if (shard->gw_lock) {
+        xSemaphoreTake(shard->gw_lock, portMAX_DELAY);
     } // wait to unlock
-    client->close_reason = reason;
-    dcgw_heartbeat_stop(client);
-    client->last_sequence_number = DISCORD_NULL_SEQUENCE_NUMBER;
+    shard->close_reason = reason;
+    shard->gw_identify_pending = false;
+    dcgw_heartbeat_stop(shard);
+    // last_sequence_number is intentionally preserved here, it is required for RESUME
+
+    if (esp_websocket_client_is_connected(shard->ws)) {
+        if (shard->client->config->session_persist
+            && (reason == DISCORD_CLOSE_REASON_LOGOUT || reason == DISCORD_CLOSE_REASON_DESTROY)) {
+            // gateway invalidates session closed with 1000 or 1001, so another code keeps it for the next login
+            esp_websocket_client_close_with_code(shard->ws, 4000, NULL, 0, portMAX_DELAY);
+        }
+        else {
+            esp_websocket_client_close(shard->ws, portMAX_DELAY);
+        }
+    }
+
+    shard->gw_buffer_len = 0;
 
-    if (esp_websocket_client_is_connected(client->ws)) {
-        esp_websocket_client_close(client->ws, portMAX_DELAY);
+    discord_member_requester_t *requester = &shard->client->member_requester;
+
+    portENTER_CRITICAL(&requester->lock);
+    if (requester->shard == shard) { // chunks of the request do not come over the new connection
+        requester->active = false;
+        requester->shard = NULL;
     }
+    portEXIT_CRITICAL(&requester->lock);
+
+    // queued control payloads of this connection are dropped by dcgw_handle_payload once the next one starts
 
-    client->gw_buffer_len = 0;
-    dcgw_queue_flush(client);
-    if (client->gw_lock) {
-        xSemaphoreGive(client->gw_lock);
+    if (shard->gw_lock) {
+        xSemaphoreGive(shard->gw_lock);
     }
 
     return ESP_OK;
 }
 
+static void dcgw_shard_destroy(discord_shard_t *shard)
+{
+    free(shard->gw_heap_buffer);
+    shard->gw_heap_buffer = NULL;
+    shard->gw_buffer = NULL;
+    discord_json_filter_free(shard->gw_filter);
+    shard->gw_filter = NULL;
+    discord_zlib_free(shard->zlib);
+    shard->zlib = NULL;
+    free(shard->gw_identify);
+    shard->gw_identify = NULL;
+
+    if (shard->gw_lock) {
+        xSemaphoreTake(shard->gw_lock, portMAX_DELAY); // wait to unlock
+        vSemaphoreDelete(shard->gw_lock);
+        shard->gw_lock = NULL;
+    }
+
+    if (shard->gw_tx_queue) {
+        dcgw_tx_queue_flush(shard);
+        vQueueDelete(shard->gw_tx_queue);
+        shard->gw_tx_queue = NULL;
+    }
+
+    free(dcgw_presence_take(shard));
+    discord_json_splitter_free(shard->gw_splitter);
+    shard->gw_splitter = NULL;
+
+    discord_arena_release(shard->gw_slot);
+    shard->gw_slot = NULL;
+
+    // not dcgw_session_reset, checkpoint in NVS must outlive the client
+    discord_session_free(shard->session);
+    shard->session = NULL;
+    shard->state = DISCORD_STATE_UNKNOWN;
+}
+
 esp_err_t dcgw_destroy(discord_handle_t client)
 {
     DISCORD_LOG_FOO();
@@ -345,147 +1576,457 @@ esp_err_t dcgw_destroy(discord_handle_t client)
         return ESP_ERR_INVALID_ARG;
     }
 
-    dcgw_close(client, DISCORD_CLOSE_REASON_DESTROY);
-    esp_websocket_client_destroy(client->ws);
-    client->ws = NULL;
-    free(client->gw_buffer);
-    client->gw_buffer = NULL;
+    for (uint16_t i = 0; client->shards && i < client->shards_len; i++) {
+        discord_shard_t *shard = &client->shards[i];
+
+        if (shard->session_checkpoint_seq != shard->last_sequence_number) {
+            dcgw_session_checkpoint(shard); // latest sequence number, regardless of the interval
+        }
+
+        dcgw_close(shard, DISCORD_CLOSE_REASON_DESTROY);
+        esp_websocket_client_destroy(shard->ws);
+        shard->ws = NULL;
+    }
+
+    // no more frames can come, so the decoder can be stopped before shards are gone
+    dcgw_decoder_stop(client);
 
-    if (client->gw_lock) {
-        xSemaphoreTake(client->gw_lock, portMAX_DELAY); // wait to unlock
-        vSemaphoreDelete(client->gw_lock);
-        client->gw_lock = NULL;
+    for (uint16_t i = 0; client->shards && i < client->shards_len; i++) {
+        dcgw_shard_destroy(&client->shards[i]);
     }
 
+    discord_shard_t *shards = client->shards;
+    client->shards = NULL;
+    client->shards_len = 0;
+    free(shards);
+
     if (client->queue) {
         dcgw_queue_flush(client);
         vQueueDelete(client->queue);
         client->queue = NULL;
     }
 
-    client->state = DISCORD_STATE_UNKNOWN;
+    if (client->control_queue) {
+        vQueueDelete(client->control_queue); // flushed together with the queue
+        client->control_queue = NULL;
+    }
+
+    if (client->queue_lock) {
+        vSemaphoreDelete(client->queue_lock);
+        client->queue_lock = NULL;
+    }
+
+    if (client->gw_frames) {
+        discord_gateway_frame_t frame;
+
+        while (xQueueReceive(client->gw_frames, &frame, 0) == pdPASS) {
+            dcgw_frame_free(&frame);
+        }
+
+        vQueueDelete(client->gw_frames);
+        client->gw_frames = NULL;
+    }
+
+    if (client->gw_decoder_done) {
+        vSemaphoreDelete(client->gw_decoder_done);
+        client->gw_decoder_done = NULL;
+    }
+
+    client->member_requester.active = false; // tasks are stopped, no lock needed
+    client->member_requester.shard = NULL;
+
+    // all payloads are freed at this point so every arena is back in the pool
+    discord_arena_pool_free(client->arena_pool);
+    client->arena_pool = NULL;
 
     return ESP_OK;
 }
 
 esp_err_t dcgw_queue_flush(discord_handle_t client)
 {
-    if (!client || !client->queue) {
+    if (!client || !client->queue || !client->queue_lock) {
         return ESP_ERR_INVALID_ARG;
     }
 
     discord_payload_t *payload = NULL;
 
-    while (xQueueReceive(client->queue, &payload, (TickType_t)0) == pdPASS) {
+    while (dcgw_queue_receive(client, &payload)) {
+        discord_payload_free(payload);
+    }
+
+    while (client->control_queue && dcgw_control_receive(client, &payload)) {
         discord_payload_free(payload);
     }
 
     return ESP_OK;
 }
 
-static esp_err_t dcgw_heartbeat_start(discord_handle_t client, discord_hello_t *hello)
+static esp_err_t dcgw_heartbeat_start(discord_shard_t *shard, discord_hello_t *hello)
 {
-    if (client->heartbeater.running)
+    if (shard->heartbeater.running)
         return ESP_OK;
 
     DISCORD_LOG_FOO();
 
-    client->heartbeater.received_ack = true; // True to prevent first ack checking
-    client->heartbeater.interval = hello->heartbeat_interval;
-    client->heartbeater.tick_ms = discord_tick_ms();
-    client->heartbeater.running = true;
+    if (!hello || hello->heartbeat_interval <= 0) {
+        DISCORD_LOGW("Invalid HELLO");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    shard->heartbeater.received_ack = true; // True to prevent first ack checking
+    shard->heartbeater.interval = hello->heartbeat_interval;
+    shard->heartbeater.tick_ms = discord_tick_ms();
+    shard->heartbeater.running = true;
 
     return ESP_OK;
 }
 
-esp_err_t dcgw_heartbeat_send_if_expired(discord_handle_t client)
+static esp_err_t dcgw_heartbeat_send(discord_shard_t *shard)
+{
+    shard->heartbeater.received_ack = false;
+
+    if (!shard->heartbeater.sent_ms) { // RTT is timed from the oldest heartbeat which waits for ACK
+        shard->heartbeater.sent_ms = discord_tick_ms();
+    }
+
+    int s = shard->last_sequence_number;
+
+    return dcgw_send(shard, &(discord_payload_t) { .op = DISCORD_OP_HEARTBEAT, .d = (discord_heartbeat_t *)&s });
+}
+
+esp_err_t dcgw_heartbeat_send_if_expired(discord_shard_t *shard)
 {
-    if (client->heartbeater.running && discord_tick_ms() - client->heartbeater.tick_ms > client->heartbeater.interval) {
-        DISCORD_LOGD("Heartbeat");
+    if (shard->heartbeater.running && discord_tick_ms() - shard->heartbeater.tick_ms > shard->heartbeater.interval) {
+        DISCORD_LOGD("Heartbeat (shard %d)", shard->id);
 
-        client->heartbeater.tick_ms = discord_tick_ms();
+        shard->heartbeater.tick_ms = discord_tick_ms();
 
-        if (!client->heartbeater.received_ack) {
-            DISCORD_LOGW("ACK has not been received since the last heartbeat. Reconnection will follow using IDENTIFY "
-                         "(RESUME is not implemented yet)");
-            dcgw_close(client, DISCORD_CLOSE_REASON_HEARTBEAT_ACK_NOT_RECEIVED);
+        if (!shard->heartbeater.received_ack) {
+            DISCORD_LOGW("ACK has not been received since the last heartbeat. Reconnection will follow using %s",
+                dcgw_session_is_resumable(shard) ? "RESUME" : "IDENTIFY");
+            dcgw_close(shard, DISCORD_CLOSE_REASON_HEARTBEAT_ACK_NOT_RECEIVED);
             return ESP_ERR_INVALID_STATE;
         }
 
-        client->heartbeater.received_ack = false;
-        int s = client->last_sequence_number;
-
-        // todo: memcheck
-        return dcgw_send(client,
-            cu_ctor(discord_payload_t, .op = DISCORD_OP_HEARTBEAT, .d = (discord_heartbeat_t *)&s));
+        return dcgw_heartbeat_send(shard);
     }
 
     return ESP_OK;
 }
 
-esp_err_t dcgw_identify(discord_handle_t client)
+uint32_t dcgw_heartbeat_due_ms(discord_shard_t *shard)
+{
+    if (!shard->heartbeater.running) {
+        return UINT32_MAX;
+    }
+
+    uint64_t elapsed = discord_tick_ms() - shard->heartbeater.tick_ms;
+
+    return elapsed > shard->heartbeater.interval ? 0 : shard->heartbeater.interval - elapsed + 1;
+}
+
+/**
+ * @brief Milliseconds until any shard can send IDENTIFY
+ */
+static uint32_t dcgw_identify_delay_left_ms(discord_handle_t client)
+{
+    uint64_t elapsed = discord_tick_ms() - client->gw_identify_ms;
+
+    return elapsed >= client->gw_identify_delay_ms ? 0 : (uint32_t)(client->gw_identify_delay_ms - elapsed);
+}
+
+/**
+ * @brief Hold off IDENTIFY of all shards for at least delay_ms from now
+ */
+static void dcgw_identify_delay(discord_handle_t client, uint32_t delay_ms)
+{
+    if (delay_ms > dcgw_identify_delay_left_ms(client)) {
+        client->gw_identify_ms = discord_tick_ms();
+        client->gw_identify_delay_ms = delay_ms;
+    }
+}
+
+uint32_t dcgw_identify_due_ms(discord_shard_t *shard)
+{
+    return shard->gw_identify_pending ? dcgw_identify_delay_left_ms(shard->client) : UINT32_MAX;
+}
+
+esp_err_t dcgw_identify_send_if_due(discord_shard_t *shard)
+{
+    if (dcgw_identify_due_ms(shard) > 0) {
+        return ESP_OK;
+    }
+
+    DISCORD_LOG_FOO();
+
+    discord_handle_t client = shard->client;
+
+    shard->gw_identify_pending = false;
+    dcgw_identify_delay(client, DISCORD_GW_IDENTIFY_INTERVAL);
+
+    return dcgw_send_command(shard, shard->gw_identify);
+}
+
+esp_err_t dcgw_identify(discord_shard_t *shard)
+{
+    shard->gw_identify_pending = true;
+
+    return dcgw_identify_send_if_due(shard);
+}
+
+esp_err_t dcgw_resume(discord_shard_t *shard)
 {
     DISCORD_LOG_FOO();
 
-    // todo: memchecks
-    return dcgw_send(client,
-        cu_ctor(discord_payload_t,
-            .op = DISCORD_OP_IDENTIFY,
-            .d = cu_ctor(discord_identify_t,
-                .token = strdup(client->config->token),
-                .intents = client->config->intents,
-                .properties = cu_ctor(discord_identify_properties_t,
-                    .os = estr_cat("esp-idf (", esp_get_idf_version(), ")"),
-                    .browser = strdup("esp-discord (" CONFIG_IDF_TARGET ")"),
-                    .device = strdup(CONFIG_IDF_TARGET)))));
+    DISCORD_LOGI("Resuming session %s (shard: %d, seq: %d)",
+        shard->session->session_id,
+        shard->id,
+        shard->last_sequence_number);
+
+    discord_resume_t resume = {
+        .token = shard->client->config->token,
+        .session_id = shard->session->session_id,
+        .seq = shard->last_sequence_number,
+    };
+
+    return dcgw_send(shard, &(discord_payload_t) { .op = DISCORD_OP_RESUME, .d = &resume });
+}
+
+static discord_session_t *dcgw_session_clone(discord_session_t *session)
+{
+    // todo: memcheck
+    return cu_ctor(discord_session_t,
+        .session_id = strdup(session->session_id),
+        .resume_gateway_url = session->resume_gateway_url ? strdup(session->resume_gateway_url) : NULL,
+        .user = cu_ctor(discord_user_t,
+            .id = strdup(session->user->id),
+            .bot = session->user->bot,
+            .username = strdup(session->user->username),
+            .discriminator = strdup(session->user->discriminator)));
+}
+
+static esp_err_t dcgw_handle_invalid_session(discord_shard_t *shard, discord_invalid_session_t *invalid_session)
+{
+    if (invalid_session && invalid_session->resumable && dcgw_session_is_resumable(shard)) {
+        DISCORD_LOGW("Session invalidated but it can be resumed");
+        return dcgw_close(shard, DISCORD_CLOSE_REASON_RECONNECT);
+    }
+
+    DISCORD_LOGW("Session invalidated. New session will be started");
+    dcgw_session_reset(shard);
+    shard->state = DISCORD_STATE_CONNECTING; // nothing but IDENTIFY can be sent until READY
+
+    // gateway expects random delay between 1 and 5 seconds before the next IDENTIFY
+    dcgw_identify_delay(shard->client, 1000 + esp_random() % 4000);
+
+    return dcgw_identify(shard);
+}
+
+/**
+ * @brief Find shard which receives events of the guild
+ * @return NULL if the guild belongs to the shard which is not run by this client
+ */
+static discord_shard_t *dcgw_guild_shard(discord_handle_t client, const char *guild_id)
+{
+    discord_shard_config_t *config = &client->config->shards;
+    uint16_t id = (strtoull(guild_id, NULL, 10) >> 22) % config->total; // sharding formula
+
+    return id >= config->first && id - config->first < client->shards_len ? &client->shards[id - config->first] : NULL;
+}
+
+esp_err_t dcgw_member_request(
+    discord_handle_t client, discord_member_request_t *request, discord_member_handler_t handler, void *arg)
+{
+    discord_member_requester_t *requester = &client->member_requester;
+
+    if (!client->shards) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    discord_shard_t *shard = dcgw_guild_shard(client, request->guild_id);
+
+    if (!shard) {
+        DISCORD_LOGW("Guild %s is not on shards of this client", request->guild_id);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (!shard->gw_splitter) {
+        discord_json_splitter_config_t splitter_cfg = {
+            .event = "GUILD_MEMBERS_CHUNK",
+            .key = "members",
+            .element_size = DISCORD_GW_MEMBER_SIZE,
+            .write_cb = dcgw_splitter_write_cb,
+            .element_cb = dcgw_splitter_element_cb,
+            .arg = shard,
+        };
+
+        if (!(shard->gw_splitter = discord_json_splitter_create(&splitter_cfg))) {
+            DISCORD_LOGE("Fail to create member splitter");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uint64_t now = discord_tick_ms();
+    bool active;
+    bool timed_out;
+    char nonce[sizeof(requester->nonce)];
+
+    portENTER_CRITICAL(&requester->lock);
+    active = requester->active;
+
+    if (active && requester->handler && now - requester->tick_ms >= DISCORD_GW_MEMBER_REQUEST_TIMEOUT) {
+        requester->handler = NULL; // its late chunks are dropped, but still hold off the new request
+    }
+
+    timed_out = active && !requester->handler;
+
+    if (!active) {
+        requester->nonce_counter++;
+        requester->handler = handler;
+        requester->arg = arg;
+        requester->tick_ms = now;
+        requester->shard = shard;
+        requester->active = true; // activate before sending, response can be faster than return from enqueue
+    }
+
+    uint32_t nonce_counter = requester->nonce_counter;
+    portEXIT_CRITICAL(&requester->lock);
+
+    if (active) {
+        DISCORD_LOGW("%s", timed_out ? "Member request timed out, waiting for its last chunk"
+                                     : "Member request is already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    snprintf(nonce, sizeof(nonce), "%" PRIu32, nonce_counter);
+
+    portENTER_CRITICAL(&requester->lock);
+    memcpy(requester->nonce, nonce, sizeof(nonce)); // no chunk can match it before the request is sent
+    portEXIT_CRITICAL(&requester->lock);
+
+    discord_request_guild_members_t request_guild_members = {
+        .request = request,
+        .nonce = nonce,
+    };
+
+    esp_err_t err = dcgw_enqueue(
+        shard, &(discord_payload_t) { .op = DISCORD_OP_REQUEST_GUILD_MEMBERS, .d = &request_guild_members });
+
+    if (err != ESP_OK) {
+        portENTER_CRITICAL(&requester->lock);
+        requester->active = false;
+        requester->shard = NULL;
+        portEXIT_CRITICAL(&requester->lock);
+    }
+
+    return err;
+}
+
+static void dcgw_member_chunk(discord_handle_t client, discord_member_chunk_t *chunk)
+{
+    discord_member_requester_t *requester = &client->member_requester;
+
+    if (!chunk || !chunk->nonce) {
+        return;
+    }
+
+    uint64_t now = discord_tick_ms();
+    discord_member_handler_t handler = NULL;
+    void *handler_arg = NULL;
+
+    portENTER_CRITICAL(&requester->lock);
+    bool match = requester->active && estr_eq(chunk->nonce, requester->nonce);
+
+    if (match) {
+        requester->tick_ms = now;
+
+        if (chunk->chunk_index + 1 >= chunk->chunk_count) {
+            handler = requester->handler; // NULL if request timed out
+            handler_arg = requester->arg;
+            requester->active = false;
+            requester->shard = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&requester->lock);
+
+    if (!match) {
+        return;
+    }
+
+    DISCORD_LOGD("Member chunk %d/%d received", chunk->chunk_index + 1, chunk->chunk_count);
+
+    if (handler) {
+        handler(client, NULL, handler_arg);
+    }
 }
 
 /**
  * @brief Check event name in payload and invoke appropriate functions
  */
-static esp_err_t dcgw_dispatch(discord_handle_t client, discord_payload_t *payload)
+static esp_err_t dcgw_dispatch(discord_shard_t *shard, discord_payload_t *payload)
 {
     DISCORD_LOG_FOO();
 
     if (DISCORD_EVENT_READY == payload->t) {
-        if (client->session) {
-            discord_session_free(client->session);
+        if (shard->session) {
+            discord_session_free(shard->session);
         }
 
-        client->session = (discord_session_t *)payload->d;
+        // session outlives the payload, so it must not stay in the arena
+        shard->session = payload->arena ? dcgw_session_clone((discord_session_t *)payload->d)
+                                        : (discord_session_t *)payload->d;
 
         // Detach pointer in order to prevent session deallocation by payload free function
         payload->d = NULL;
 
-        client->state = DISCORD_STATE_CONNECTED;
+        if (!shard->session) {
+            DISCORD_LOGE("Fail to store session");
+            return ESP_ERR_NO_MEM;
+        }
+
+        shard->state = DISCORD_STATE_CONNECTED;
+        dcgw_session_checkpoint(shard); // new session, previous checkpoint is useless
+
+        DISCORD_LOGD("Identified [%s#%s (%s), shard: %d, session: %s]",
+            shard->session->user->username,
+            shard->session->user->discriminator,
+            shard->session->user->id,
+            shard->id,
+            shard->session->session_id);
 
-        DISCORD_LOGD("Identified [%s#%s (%s), session: %s]",
-            client->session->user->username,
-            client->session->user->discriminator,
-            client->session->user->id,
-            client->session->session_id);
+        discord_session_t *session_clone = dcgw_session_clone(shard->session);
+        DISCORD_SHARD_EVENT_FIRE(shard, DISCORD_EVENT_CONNECTED, session_clone);
+        discord_session_free(session_clone);
+
+        return ESP_OK;
+    }
 
-        discord_session_t *_s = client->session;
+    if (DISCORD_EVENT_RESUMED == payload->t) {
+        if (!shard->session) { // should not happen, RESUME is sent only when session exist
+            return ESP_FAIL;
+        }
 
-        discord_session_t *session_clone = cu_ctor(discord_session_t,
-            .session_id = strdup(_s->session_id),
-            .user = cu_ctor(discord_user_t,
-                .id = strdup(_s->user->id),
-                .bot = _s->user->bot,
-                .username = strdup(_s->user->username),
-                .discriminator = strdup(_s->user->discriminator)));
+        shard->state = DISCORD_STATE_CONNECTED;
 
-        // todo: memcheck
+        DISCORD_LOGD("Resumed [shard: %d, session: %s, seq: %d]",
+            shard->id,
+            shard->session->session_id,
+            shard->last_sequence_number);
 
-        DISCORD_EVENT_FIRE(DISCORD_EVENT_CONNECTED, session_clone);
+        discord_session_t *session_clone = dcgw_session_clone(shard->session);
+        DISCORD_SHARD_EVENT_FIRE(shard, DISCORD_EVENT_CONNECTED, session_clone);
         discord_session_free(session_clone);
 
         return ESP_OK;
     }
 
+    if (DISCORD_EVENT_GUILD_MEMBERS_CHUNK == payload->t) {
+        dcgw_member_chunk(shard->client, (discord_member_chunk_t *)payload->d);
+    }
+
     if (payload->t > DISCORD_EVENT_CONNECTED) {
         // client is connected. fire the event!
-        DISCORD_EVENT_FIRE(payload->t, payload->d);
+        DISCORD_SHARD_EVENT_FIRE(shard, payload->t, payload->d);
     }
 
     return ESP_OK;
@@ -498,23 +2039,77 @@ esp_err_t dcgw_handle_payload(discord_handle_t client, discord_payload_t *payloa
     if (!payload)
         return ESP_FAIL;
 
-    DISCORD_LOGD("Received payload (op: %d)", payload->op);
+    if (!client->shards || payload->shard >= client->shards_len) {
+        discord_payload_free(payload);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    discord_shard_t *shard = &client->shards[payload->shard];
+
+    if (payload->connection != shard->gw_connection
+        && (payload->op != DISCORD_OP_DISPATCH || payload->t == DISCORD_EVENT_READY
+            || payload->t == DISCORD_EVENT_RESUMED)) {
+        // other dispatch payloads survive reconnection, because their sequence numbers are already acknowledged
+        DISCORD_LOGD("Payload of closed connection dropped (op: %d)", payload->op);
+        discord_payload_free(payload);
+        return ESP_OK;
+    }
+
+    DISCORD_LOGD("Received payload (shard: %d, op: %d)", shard->id, payload->op);
 
     switch (payload->op) {
         case DISCORD_OP_HELLO:
-            dcgw_heartbeat_start(client, (discord_hello_t *)payload->d);
+            dcgw_heartbeat_start(shard, (discord_hello_t *)payload->d);
             discord_payload_free(payload);
             payload = NULL;
-            dcgw_identify(client);
+
+            if (dcgw_session_is_resumable(shard)) {
+                dcgw_resume(shard);
+            }
+            else {
+                dcgw_identify(shard);
+            }
+            break;
+
+        case DISCORD_OP_HEARTBEAT:
+            // gateway asks for heartbeat right away. regular schedule is kept
+            DISCORD_LOGD("Gateway requested heartbeat (shard %d)", shard->id);
+
+            if (shard->heartbeater.running) {
+                dcgw_heartbeat_send(shard);
+            }
             break;
 
         case DISCORD_OP_HEARTBEAT_ACK:
-            DISCORD_LOGD("Heartbeat ack received");
-            client->heartbeater.received_ack = true;
+            shard->heartbeater.received_ack = true;
+
+            if (shard->heartbeater.sent_ms) {
+                uint32_t rtt = (uint32_t)(discord_tick_ms() - shard->heartbeater.sent_ms);
+                shard->heartbeater.sent_ms = 0;
+                dcgw_latency_record(client, rtt);
+                DISCORD_LOGD("Heartbeat ack received (rtt=%" PRIu32 "ms)", rtt);
+            }
+            else {
+                DISCORD_LOGD("Heartbeat ack received");
+            }
             break;
 
         case DISCORD_OP_DISPATCH:
-            dcgw_dispatch(client, payload);
+            if (dcgw_whether_payload_should_be_dispatched(shard, payload)) {
+                dcgw_dispatch(shard, payload);
+            }
+            else {
+                DISCORD_LOGD("Payload ignored");
+            }
+            break;
+
+        case DISCORD_OP_RECONNECT:
+            DISCORD_LOGW("Gateway requested reconnection (shard %d)", shard->id);
+            dcgw_close(shard, DISCORD_CLOSE_REASON_RECONNECT);
+            break;
+
+        case DISCORD_OP_INVALID_SESSION:
+            dcgw_handle_invalid_session(shard, (discord_invalid_session_t *)payload->d);
             break;
 
         default:
@@ -1,4 +1,5 @@
 #include "discord/private/_json.h"
+#include "discord/private/_json_schema.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "discord/private/_discord.h"
@@ -7,692 +8,558 @@
 
 DISCORD_LOG_DEFINE_BASE();
 
-static struct
-{
-    const char *name;
-    discord_event_t event;
-} discord_event_name_map[] = {
-    { "READY", DISCORD_EVENT_READY },
-    { "MESSAGE_CREATE", DISCORD_EVENT_MESSAGE_RECEIVED },
-    { "MESSAGE_DELETE", DISCORD_EVENT_MESSAGE_DELETED },
-    { "MESSAGE_UPDATE", DISCORD_EVENT_MESSAGE_UPDATED },
-    { "MESSAGE_REACTION_ADD", DISCORD_EVENT_MESSAGE_REACTION_ADDED },
-    { "MESSAGE_REACTION_REMOVE", DISCORD_EVENT_MESSAGE_REACTION_REMOVED },
-    { "VOICE_STATE_UPDATE", DISCORD_EVENT_VOICE_STATE_UPDATED },
-};
-
-static discord_event_t discord_model_event_by_name(const char *name)
-{
-    size_t map_len = sizeof(discord_event_name_map) / sizeof(discord_event_name_map[0]);
-
-    for (size_t i = 0; i < map_len; i++) {
-        if (estr_eq(name, discord_event_name_map[i].name)) {
-            return discord_event_name_map[i].event;
-        }
-    }
+#define DC_EVENT_SLOTS_LEN (256) /*<! Power of two, at least twice the number of names to keep probing short */
 
-    return DISCORD_EVENT_UNKNOWN;
-}
-
-cJSON *discord_payload_to_cjson(discord_payload_t *payload)
+static uint32_t dc_event_name_hash(const char *name, size_t len)
 {
-    if (!payload)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "op", payload->op);
-
-    const char *d = "d";
-
-    switch (payload->op) {
-        case DISCORD_OP_HEARTBEAT:
-            cJSON_AddItemToObject(root, d, discord_heartbeat_to_cjson((discord_heartbeat_t *)payload->d));
-            break;
+    uint32_t hash = 2166136261u; // FNV-1a
 
-        case DISCORD_OP_IDENTIFY:
-            cJSON_AddItemToObject(root, d, discord_identify_to_cjson((discord_identify_t *)payload->d));
-            break;
-
-        default:
-            DISCORD_LOGW("Cannot recognize payload type");
-            cJSON_Delete(root);
-            root = NULL;
-            break;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
     }
 
-    return root;
+    return hash;
 }
 
-discord_payload_t *discord_payload_from_cjson(cJSON *cjson)
+/**
+ * @brief Open addressing hash table of event names, laid out at compile time. Name goes to the slot
+ *        dc_event_name_hash(name) & (DC_EVENT_SLOTS_LEN - 1) or, if it is taken, to the next free one.
+ *        Rebuild it whenever DISCORD_EVENT_CATALOGUE changes. test_json_events checks that every name resolves
+ */
+static const struct
 {
-    discord_payload_t *pl = cu_ctor(discord_payload_t, .op = cJSON_GetObjectItem(cjson, "op")->valueint);
-
-    // todo: memcheck
-
-    cJSON *s = cJSON_GetObjectItem(cjson, "s");
-
-    pl->s = cJSON_IsNumber(s) ? s->valueint : DISCORD_NULL_SEQUENCE_NUMBER;
-
-    if (pl->s <= 0) {
-        pl->s = DISCORD_NULL_SEQUENCE_NUMBER;
-    }
-
-    cJSON *d = cJSON_GetObjectItem(cjson, "d");
-
-    switch (pl->op) {
-        case DISCORD_OP_HELLO:
-            pl->d =
-                cu_ctor(discord_hello_t, .heartbeat_interval = cJSON_GetObjectItem(d, "heartbeat_interval")->valueint);
-            break;
-
-        case DISCORD_OP_DISPATCH:
-            pl->t = discord_model_event_by_name(cJSON_GetObjectItem(cjson, "t")->valuestring);
-            pl->d = discord_dispatch_event_data_from_cjson(pl->t, d);
-            break;
-
-        case DISCORD_OP_HEARTBEAT_ACK:
-            // Ignore
-            break;
-
-        default:
-            DISCORD_LOGW("Cannot recognize payload type. Unable to set payload data.");
-            break;
-    }
-
-    return pl;
-}
+    const char *name; /*<! NULL if slot is empty */
+    discord_event_t event;
+} dc_event_slots[DC_EVENT_SLOTS_LEN] = {
+    [0] = { "MESSAGE_UPDATE", DISCORD_EVENT_MESSAGE_UPDATED },
+    [1] = { "THREAD_MEMBER_UPDATE", DISCORD_EVENT_THREAD_MEMBER_UPDATE },
+    [6] = { "GUILD_INTEGRATIONS_UPDATE", DISCORD_EVENT_GUILD_INTEGRATIONS_UPDATE },
+    [7] = { "GUILD_AUDIT_LOG_ENTRY_CREATE", DISCORD_EVENT_GUILD_AUDIT_LOG_ENTRY_CREATE },
+    [8] = { "INTERACTION_CREATE", DISCORD_EVENT_INTERACTION_CREATE },
+    [13] = { "GUILD_SOUNDBOARD_SOUND_CREATE", DISCORD_EVENT_GUILD_SOUNDBOARD_SOUND_CREATE },
+    [17] = { "INTEGRATION_DELETE", DISCORD_EVENT_INTEGRATION_DELETE },
+    [23] = { "GUILD_SCHEDULED_EVENT_USER_ADD", DISCORD_EVENT_GUILD_SCHEDULED_EVENT_USER_ADD },
+    [26] = { "GUILD_SOUNDBOARD_SOUND_DELETE", DISCORD_EVENT_GUILD_SOUNDBOARD_SOUND_DELETE },
+    [30] = { "THREAD_CREATE", DISCORD_EVENT_THREAD_CREATE },
+    [31] = { "STAGE_INSTANCE_CREATE", DISCORD_EVENT_STAGE_INSTANCE_CREATE },
+    [33] = { "SUBSCRIPTION_CREATE", DISCORD_EVENT_SUBSCRIPTION_CREATE },
+    [34] = { "ENTITLEMENT_DELETE", DISCORD_EVENT_ENTITLEMENT_DELETE },
+    [35] = { "THREAD_UPDATE", DISCORD_EVENT_THREAD_UPDATE },
+    [36] = { "STAGE_INSTANCE_UPDATE", DISCORD_EVENT_STAGE_INSTANCE_UPDATE },
+    [38] = { "GUILD_EMOJIS_UPDATE", DISCORD_EVENT_GUILD_EMOJIS_UPDATE },
+    [41] = { "MESSAGE_POLL_VOTE_ADD", DISCORD_EVENT_MESSAGE_POLL_VOTE_ADD },
+    [44] = { "AUTO_MODERATION_RULE_DELETE", DISCORD_EVENT_AUTO_MODERATION_RULE_DELETE },
+    [46] = { "MESSAGE_REACTION_ADD", DISCORD_EVENT_MESSAGE_REACTION_ADDED },
+    [48] = { "SUBSCRIPTION_UPDATE", DISCORD_EVENT_SUBSCRIPTION_UPDATE },
+    [51] = { "GUILD_ROLE_UPDATE", DISCORD_EVENT_GUILD_ROLE_UPDATE },
+    [54] = { "MESSAGE_REACTION_REMOVE_EMOJI", DISCORD_EVENT_MESSAGE_REACTION_REMOVE_EMOJI },
+    [55] = { "MESSAGE_POLL_VOTE_REMOVE", DISCORD_EVENT_MESSAGE_POLL_VOTE_REMOVE },
+    [57] = { "VOICE_STATE_UPDATE", DISCORD_EVENT_VOICE_STATE_UPDATED },
+    [58] = { "TYPING_START", DISCORD_EVENT_TYPING_START },
+    [62] = { "AUTO_MODERATION_RULE_UPDATE", DISCORD_EVENT_AUTO_MODERATION_RULE_UPDATE },
+    [64] = { "CHANNEL_UPDATE", DISCORD_EVENT_CHANNEL_UPDATE },
+    [68] = { "GUILD_SOUNDBOARD_SOUND_UPDATE", DISCORD_EVENT_GUILD_SOUNDBOARD_SOUND_UPDATE },
+    [69] = { "ENTITLEMENT_CREATE", DISCORD_EVENT_ENTITLEMENT_CREATE },
+    [75] = { "CHANNEL_PINS_UPDATE", DISCORD_EVENT_CHANNEL_PINS_UPDATE },
+    [76] = { "THREAD_LIST_SYNC", DISCORD_EVENT_THREAD_LIST_SYNC },
+    [78] = { "GUILD_ROLE_CREATE", DISCORD_EVENT_GUILD_ROLE_CREATE },
+    [81] = { "MESSAGE_CREATE", DISCORD_EVENT_MESSAGE_RECEIVED },
+    [83] = { "GUILD_SOUNDBOARD_SOUNDS_UPDATE", DISCORD_EVENT_GUILD_SOUNDBOARD_SOUNDS_UPDATE },
+    [88] = { "APPLICATION_COMMAND_PERMISSIONS_UPDATE", DISCORD_EVENT_APPLICATION_COMMAND_PERMISSIONS_UPDATE },
+    [92] = { "GUILD_SCHEDULED_EVENT_CREATE", DISCORD_EVENT_GUILD_SCHEDULED_EVENT_CREATE },
+    [98] = { "GUILD_DELETE", DISCORD_EVENT_GUILD_DELETE },
+    [102] = { "GUILD_BAN_ADD", DISCORD_EVENT_GUILD_BAN_ADD },
+    [103] = { "MESSAGE_REACTION_REMOVE", DISCORD_EVENT_MESSAGE_REACTION_REMOVED },
+    [114] = { "GUILD_MEMBERS_CHUNK", DISCORD_EVENT_GUILD_MEMBERS_CHUNK },
+    [117] = { "INVITE_CREATE", DISCORD_EVENT_INVITE_CREATE },
+    [124] = { "ENTITLEMENT_UPDATE", DISCORD_EVENT_ENTITLEMENT_UPDATE },
+    [125] = { "GUILD_SCHEDULED_EVENT_USER_REMOVE", DISCORD_EVENT_GUILD_SCHEDULED_EVENT_USER_REMOVE },
+    [128] = { "PRESENCE_UPDATE", DISCORD_EVENT_PRESENCE_UPDATE },
+    [133] = { "GUILD_CREATE", DISCORD_EVENT_GUILD_CREATE },
+    [134] = { "SUBSCRIPTION_DELETE", DISCORD_EVENT_SUBSCRIPTION_DELETE },
+    [135] = { "USER_UPDATE", DISCORD_EVENT_USER_UPDATE },
+    [145] = { "CHANNEL_CREATE", DISCORD_EVENT_CHANNEL_CREATE },
+    [146] = { "INTEGRATION_CREATE", DISCORD_EVENT_INTEGRATION_CREATE },
+    [150] = { "MESSAGE_DELETE", DISCORD_EVENT_MESSAGE_DELETED },
+    [151] = { "AUTO_MODERATION_RULE_CREATE", DISCORD_EVENT_AUTO_MODERATION_RULE_CREATE },
+    [157] = { "GUILD_MEMBER_UPDATE", DISCORD_EVENT_GUILD_MEMBER_UPDATE },
+    [163] = { "GUILD_SCHEDULED_EVENT_DELETE", DISCORD_EVENT_GUILD_SCHEDULED_EVENT_DELETE },
+    [165] = { "GUILD_ROLE_DELETE", DISCORD_EVENT_GUILD_ROLE_DELETE },
+    [167] = { "GUILD_MEMBER_ADD", DISCORD_EVENT_GUILD_MEMBER_ADD },
+    [169] = { "SOUNDBOARD_SOUNDS", DISCORD_EVENT_SOUNDBOARD_SOUNDS },
+    [172] = { "GUILD_MEMBER_REMOVE", DISCORD_EVENT_GUILD_MEMBER_REMOVE },
+    [187] = { "AUTO_MODERATION_ACTION_EXECUTION", DISCORD_EVENT_AUTO_MODERATION_ACTION_EXECUTION },
+    [188] = { "GUILD_UPDATE", DISCORD_EVENT_GUILD_UPDATE },
+    [191] = { "INTEGRATION_UPDATE", DISCORD_EVENT_INTEGRATION_UPDATE },
+    [212] = { "READY", DISCORD_EVENT_READY },
+    [213] = { "THREAD_DELETE", DISCORD_EVENT_THREAD_DELETE },
+    [214] = { "CHANNEL_DELETE", DISCORD_EVENT_CHANNEL_DELETE },
+    [215] = { "STAGE_INSTANCE_DELETE", DISCORD_EVENT_STAGE_INSTANCE_DELETE },
+    [217] = { "GUILD_SCHEDULED_EVENT_UPDATE", DISCORD_EVENT_GUILD_SCHEDULED_EVENT_UPDATE },
+    [231] = { "THREAD_MEMBERS_UPDATE", DISCORD_EVENT_THREAD_MEMBERS_UPDATE },
+    [234] = { "RESUMED", DISCORD_EVENT_RESUMED },
+    [235] = { "MESSAGE_DELETE_BULK", DISCORD_EVENT_MESSAGE_DELETE_BULK },
+    [236] = { "MESSAGE_REACTION_REMOVE_ALL", DISCORD_EVENT_MESSAGE_REACTION_REMOVE_ALL },
+    [239] = { "GUILD_BAN_REMOVE", DISCORD_EVENT_GUILD_BAN_REMOVE },
+    [241] = { "WEBHOOKS_UPDATE", DISCORD_EVENT_WEBHOOKS_UPDATE },
+    [242] = { "INVITE_DELETE", DISCORD_EVENT_INVITE_DELETE },
+    [247] = { "GUILD_STICKERS_UPDATE", DISCORD_EVENT_GUILD_STICKERS_UPDATE },
+    [248] = { "VOICE_SERVER_UPDATE", DISCORD_EVENT_VOICE_SERVER_UPDATE },
+    [250] = { "VOICE_CHANNEL_EFFECT_SEND", DISCORD_EVENT_VOICE_CHANNEL_EFFECT_SEND },
+};
 
-discord_payload_data_t discord_dispatch_event_data_from_cjson(discord_event_t e, cJSON *cjson)
+static discord_event_t discord_model_event_by_name(const char *name, size_t len)
 {
-    switch (e) {
-        case DISCORD_EVENT_READY:
-            return discord_session_from_cjson(cjson);
-
-        case DISCORD_EVENT_MESSAGE_RECEIVED:
-        case DISCORD_EVENT_MESSAGE_UPDATED:
-        case DISCORD_EVENT_MESSAGE_DELETED:
-            return discord_message_from_cjson(cjson);
-
-        case DISCORD_EVENT_MESSAGE_REACTION_ADDED:
-        case DISCORD_EVENT_MESSAGE_REACTION_REMOVED:
-            return discord_message_reaction_from_cjson(cjson);
-
-        case DISCORD_EVENT_VOICE_STATE_UPDATED:
-            return discord_voice_state_from_cjson(cjson);
+    uint32_t slot = dc_event_name_hash(name, len) & (DC_EVENT_SLOTS_LEN - 1);
 
-        default:
-            DISCORD_LOGW("Cannot recognize event type");
-            return NULL;
+    for (const char *candidate; (candidate = dc_event_slots[slot].name); slot = (slot + 1) & (DC_EVENT_SLOTS_LEN - 1)) {
+        if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+            return dc_event_slots[slot].event;
+        }
     }
-}
-
-cJSON *discord_heartbeat_to_cjson(discord_heartbeat_t *heartbeat)
-{
-    int hb = *((int *)(heartbeat));
-
-    // todo: memcheck
-    return hb == DISCORD_NULL_SEQUENCE_NUMBER ? cJSON_CreateNull() : cJSON_CreateNumber(hb);
-}
-
-cJSON *discord_identify_properties_to_cjson(discord_identify_properties_t *properties)
-{
-    cJSON *root = cJSON_CreateObject();
-
-    // todo: memchecks
-    cJSON_AddItemToObject(root, "os", cJSON_CreateStringReference(properties->os));
-    cJSON_AddItemToObject(root, "browser", cJSON_CreateStringReference(properties->browser));
-    cJSON_AddItemToObject(root, "device", cJSON_CreateStringReference(properties->device));
-
-    return root;
-}
-
-cJSON *discord_identify_to_cjson(discord_identify_t *identify)
-{
-    cJSON *root = cJSON_CreateObject();
-
-    // todo: memchecks
-    cJSON_AddItemToObject(root, "token", cJSON_CreateStringReference(identify->token));
-    cJSON_AddNumberToObject(root, "intents", identify->intents);
-    cJSON_AddItemToObject(root, "properties", discord_identify_properties_to_cjson(identify->properties));
 
-    return root;
-}
-
-discord_session_t *discord_session_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
-
-    cJSON *_id = cJSON_GetObjectItem(root, "session_id");
-
-    discord_session_t *session = cu_ctor(discord_session_t,
-        .session_id = _id->valuestring,
-        .user = discord_user_from_cjson(cJSON_GetObjectItem(root, "user")));
-
-    // todo: memcheck
-
-    _id->valuestring = NULL;
-
-    return session;
+    return DISCORD_EVENT_UNKNOWN;
 }
 
-discord_user_t *discord_user_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
-
-    cJSON *_id = cJSON_GetObjectItem(root, "id");
-    cJSON *_bot = cJSON_GetObjectItem(root, "bot");
-    cJSON *_username = cJSON_GetObjectItem(root, "username");
-    cJSON *_discriminator = cJSON_GetObjectItem(root, "discriminator");
-
-    discord_user_t *user = cu_ctor(discord_user_t,
-        .id = _id->valuestring,
-        .bot = _bot && _bot->valueint,
-        .username = _username->valuestring,
-        .discriminator = _discriminator->valuestring);
-
-    // todo: memcheck
-
-    _id->valuestring = _username->valuestring = _discriminator->valuestring = NULL;
-
-    return user;
-}
+/**
+ * @brief Object keys read by the decoders in this file. Gateway messages which do not fit
+ *        into the buffer are stripped down to these keys, so keep the list in sync with decoders
+ */
+const char *const discord_json_keys[] = {
+    "attachments", "author", "bot", "channel_id", "chunk_count", "chunk_index", "content", "content_type", "d", "deaf",
+    "discriminator", "emoji", "filename", "guild_id", "heartbeat_interval", "id", "member", "message_id", "mute", "name",
+    "nick", "nonce", "op", "permissions", "position", "resume_gateway_url", "roles", "s", "self_deaf", "self_mute",
+    "session_id", "size", "t", "type", "url", "user", "user_id", "username", NULL,
+};
 
-cJSON *discord_user_to_cjson(discord_user_t *user)
+static const char *dc_json_skip_space(const char *p, const char *end)
 {
-    cJSON *root = cJSON_CreateObject();
-
-    cJSON_AddItemToObject(root, "id", cJSON_CreateStringReference(user->id));
-    cJSON_AddItemToObject(root, "username", cJSON_CreateStringReference(user->username));
-    cJSON_AddItemToObject(root, "discriminator", cJSON_CreateStringReference(user->discriminator));
-    cJSON_AddBoolToObject(root, "bot", user->bot);
-
-    // todo: memchecks
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
 
-    return root;
+    return p;
 }
 
-discord_member_t *discord_member_from_cjson(cJSON *root)
+/**
+ * @brief Returns pointer to the character after the closing quote of string which starts at p
+ */
+static const char *dc_json_skip_string(const char *p, const char *end)
 {
-    if (!root)
-        return NULL;
-
-    cJSON *_nick = cJSON_GetObjectItem(root, "nick");
-    cJSON *_permissions = cJSON_GetObjectItem(root, "permissions");
-
-    discord_member_t *member = cu_ctor(discord_member_t,
-        .nick = _nick ? _nick->valuestring : NULL,
-        .permissions = _permissions ? _permissions->valuestring : NULL);
-
-    // todo: memcheck
-
-    if (_nick)
-        _nick->valuestring = NULL;
-    if (_permissions)
-        _permissions->valuestring = NULL;
-
-    cJSON *_roles = cJSON_GetObjectItem(root, "roles");
-
-    if (cJSON_IsArray(_roles) && ((member->_roles_len = cJSON_GetArraySize(_roles)) > 0)) {
-        member->roles = calloc(member->_roles_len, sizeof(char *));
-
-        // todo: memcheck
-
-        for (discord_role_len_t i = 0; i < member->_roles_len; i++) {
-            cJSON *_role = cJSON_GetArrayItem(_roles, i);
-            member->roles[i] = _role->valuestring;
-            _role->valuestring = NULL;
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+        }
+        else if (*p == '"') {
+            return p + 1;
         }
     }
 
-    return member;
+    return end;
 }
 
-cJSON *discord_member_to_cjson(discord_member_t *member)
+/**
+ * @brief Returns pointer to the character after the value which starts at p
+ */
+static const char *dc_json_skip_value(const char *p, const char *end)
 {
-    if (!member)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
-
-    if (member->nick)
-        cJSON_AddItemToObject(root, "nick", cJSON_CreateStringReference(member->nick));
-    if (member->permissions)
-        cJSON_AddItemToObject(root, "permissions", cJSON_CreateStringReference(member->permissions));
-
-    // todo: memchecks
-
-    return root;
-}
+    if (p >= end) {
+        return end;
+    }
 
-discord_attachment_t *discord_attachment_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
+    if (*p == '"') {
+        return dc_json_skip_string(p, end);
+    }
 
-    cJSON *_id = cJSON_GetObjectItem(root, "id");
-    cJSON *_fname = cJSON_GetObjectItem(root, "filename");
-    cJSON *_ctype = cJSON_GetObjectItem(root, "content_type");
-    cJSON *_url = cJSON_GetObjectItem(root, "url");
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
 
-    discord_attachment_t *attachment = cu_ctor(discord_attachment_t,
-        .id = _id->valuestring,
-        .filename = _fname->valuestring,
-        .content_type = _ctype ? _ctype->valuestring : NULL,
-        .size = cJSON_GetObjectItem(root, "size")->valueint,
-        .url = _url->valuestring);
+        while (p < end) {
+            if (*p == '"') {
+                p = dc_json_skip_string(p, end);
+                continue;
+            }
 
-    // todo: memcheck
+            if (*p == '{' || *p == '[') {
+                depth++;
+            }
+            else if ((*p == '}' || *p == ']') && --depth == 0) {
+                return p + 1;
+            }
 
-    _id->valuestring = _fname->valuestring = _url->valuestring = NULL;
+            p++;
+        }
 
-    if (_ctype != NULL) {
-        _ctype->valuestring = NULL;
+        return end;
     }
 
-    return attachment;
-}
-
-cJSON *discord_attachment_to_cjson(discord_attachment_t *attachment)
-{
-    if (!attachment)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
-
-    if (attachment->id)
-        cJSON_AddItemToObject(root, "id", cJSON_CreateStringReference(attachment->id));
-    if (attachment->filename)
-        cJSON_AddItemToObject(root, "filename", cJSON_CreateStringReference(attachment->filename));
-
-    // todo: memchecks
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') {
+        p++;
+    }
 
-    return root;
+    return p;
 }
 
-static cJSON *discord_embed_footer_to_cjson(discord_embed_footer_t *footer)
+static bool dc_json_parse_int(const char *p, const char *end, int *out)
 {
-    if (!footer)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
+    bool negative = p < end && *p == '-';
+    int value = 0;
 
-    if (footer->text)
-        cJSON_AddItemToObject(root, "text", cJSON_CreateStringReference(footer->text));
-    if (footer->icon_url)
-        cJSON_AddItemToObject(root, "icon_url", cJSON_CreateStringReference(footer->icon_url));
-
-    return root;
-}
+    if (negative) {
+        p++;
+    }
 
-static cJSON *discord_embed_image_to_cjson(discord_embed_image_t *image)
-{
-    if (!image)
-        return NULL;
+    if (p >= end || *p < '0' || *p > '9') {
+        return false;
+    }
 
-    cJSON *root = cJSON_CreateObject();
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p++ - '0');
+    }
 
-    if (image->url)
-        cJSON_AddItemToObject(root, "url", cJSON_CreateStringReference(image->url));
+    *out = negative ? -value : value;
 
-    return root;
+    return true;
 }
 
-static cJSON *discord_embed_author_to_cjson(discord_embed_author_t *author)
+esp_err_t discord_payload_header_from_json(const char *json, size_t length, discord_payload_header_t *out)
 {
-    if (!author)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
-
-    if (author->name)
-        cJSON_AddItemToObject(root, "name", cJSON_CreateStringReference(author->name));
-    if (author->url)
-        cJSON_AddItemToObject(root, "url", cJSON_CreateStringReference(author->url));
-    if (author->icon_url)
-        cJSON_AddItemToObject(root, "icon_url", cJSON_CreateStringReference(author->icon_url));
+    if (!json || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    return root;
-}
+    const char *p = json;
+    const char *end = json + length;
+    int found = 0;
 
-static cJSON *discord_embed_field_to_cjson(discord_embed_field_t *field)
-{
-    if (!field)
-        return NULL;
+    out->op = -1;
+    out->s = DISCORD_NULL_SEQUENCE_NUMBER;
+    out->t = DISCORD_EVENT_NONE;
 
-    cJSON *root = cJSON_CreateObject();
+    p = dc_json_skip_space(p, end);
 
-    if (field->name)
-        cJSON_AddItemToObject(root, "name", cJSON_CreateStringReference(field->name));
-    if (field->value)
-        cJSON_AddItemToObject(root, "value", cJSON_CreateStringReference(field->value));
-    cJSON_AddBoolToObject(root, "inline", field->is_inline);
+    if (p >= end || *p++ != '{') {
+        return ESP_FAIL;
+    }
 
-    return root;
-}
+    while (found < 3) {
+        p = dc_json_skip_space(p, end);
 
-cJSON *discord_embed_to_cjson(discord_embed_t *embed)
-{
-    if (!embed)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
-
-    if (embed->title)
-        cJSON_AddItemToObject(root, "title", cJSON_CreateStringReference(embed->title));
-    if (embed->description)
-        cJSON_AddItemToObject(root, "description", cJSON_CreateStringReference(embed->description));
-    if (embed->url)
-        cJSON_AddItemToObject(root, "url", cJSON_CreateStringReference(embed->url));
-    cJSON_AddNumberToObject(root, "color", embed->color);
-    if (embed->footer)
-        cJSON_AddItemToObject(root, "footer", discord_embed_footer_to_cjson(embed->footer));
-    if (embed->image)
-        cJSON_AddItemToObject(root, "image", discord_embed_image_to_cjson(embed->image));
-    if (embed->thumbnail)
-        cJSON_AddItemToObject(root, "thumbnail", discord_embed_image_to_cjson(embed->thumbnail));
-    if (embed->author)
-        cJSON_AddItemToObject(root, "author", discord_embed_author_to_cjson(embed->author));
-
-    if (embed->_fields_len > 0) {
-        cJSON *fields = cJSON_CreateArray();
-
-        for (uint8_t i = 0; i < embed->_fields_len; i++) {
-            cJSON_AddItemToArray(fields, discord_embed_field_to_cjson(embed->fields[i]));
+        if (p < end && *p == ',') {
+            p = dc_json_skip_space(p + 1, end);
         }
 
-        cJSON_AddItemToObject(root, "fields", fields);
-    }
-
-    return root;
-}
-
-discord_guild_t *discord_guild_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
+        if (p >= end || *p != '"') {
+            break; // end of object or malformed JSON
+        }
 
-    cJSON *_id = cJSON_GetObjectItem(root, "id");
-    cJSON *_name = cJSON_GetObjectItem(root, "name");
-    cJSON *_permissions = cJSON_GetObjectItem(root, "permissions");
+        const char *key = p + 1;
+        p = dc_json_skip_string(p, end);
+        size_t key_len = p - key - 1;
 
-    discord_guild_t *guild = cu_ctor(discord_guild_t,
-        .id = _id->valuestring,
-        .name = _name->valuestring,
-        .permissions = _permissions == NULL ? NULL : _permissions->valuestring);
+        p = dc_json_skip_space(p, end);
 
-    // todo: memcheck
+        if (p >= end || *p++ != ':') {
+            return ESP_FAIL;
+        }
 
-    _id->valuestring = _name->valuestring = NULL;
+        p = dc_json_skip_space(p, end);
+        const char *value = p;
+        p = dc_json_skip_value(p, end);
 
-    if (_permissions) {
-        _permissions->valuestring = NULL;
+        if (key_len == 2 && strncmp(key, "op", 2) == 0) {
+            if (!dc_json_parse_int(value, p, &out->op)) {
+                return ESP_FAIL;
+            }
+            found++;
+        }
+        else if (key_len == 1 && key[0] == 's') {
+            if (!dc_json_parse_int(value, p, &out->s) || out->s <= 0) {
+                out->s = DISCORD_NULL_SEQUENCE_NUMBER;
+            }
+            found++;
+        }
+        else if (key_len == 1 && key[0] == 't') {
+            if (*value == '"' && p - value >= 2) {
+                out->t = discord_model_event_by_name(value + 1, p - value - 2);
+            }
+            found++;
+        }
     }
 
-    return guild;
+    return out->op >= 0 ? ESP_OK : ESP_FAIL;
 }
 
-cJSON *discord_guild_to_cjson(discord_guild_t *guild)
-{
-    if (!guild)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
-
-    cJSON_AddItemToObject(root, "id", cJSON_CreateStringReference(guild->id));
-    cJSON_AddItemToObject(root, "name", cJSON_CreateStringReference(guild->name));
-
-    if (guild->permissions) {
-        cJSON_AddItemToObject(root, "permissions", cJSON_CreateStringReference(guild->permissions));
-    }
+/*
+ * Model schemas. Nested models must be described before the models which contain them
+ */
 
-    // todo: memchecks
+#define DC_D  DISCORD_JSON_DECODE
+#define DC_E  DISCORD_JSON_ENCODE
+#define DC_DE (DISCORD_JSON_DECODE | DISCORD_JSON_ENCODE)
 
-    return root;
-}
+static const discord_json_field_t dc_hello_fields[] = {
+    DISCORD_JSON_INT(discord_hello_t, heartbeat_interval, "heartbeat_interval", DC_D, 0),
+};
+static DISCORD_JSON_SCHEMA(dc_hello_schema, discord_hello_t, dc_hello_fields);
 
-discord_channel_t *discord_channel_from_cjson(cJSON *root)
+discord_payload_t *discord_payload_from_cjson(cJSON *cjson, discord_arena_handle_t arena)
 {
-    if (!root)
-        return NULL;
-
-    cJSON *_id = cJSON_GetObjectItem(root, "id");
-    cJSON *_type = cJSON_GetObjectItem(root, "type");
-    cJSON *_name = cJSON_GetObjectItem(root, "name");
-
-    discord_channel_t *channel = cu_ctor(discord_channel_t,
-        .id = _id->valuestring,
-        .type = (discord_channel_type_t)_type->valueint,
-        .name = _name == NULL ? NULL : _name->valuestring, );
+    cJSON *op = cJSON_GetObjectItem(cjson, "op");
+    discord_payload_t *pl = discord_arena_ctor(arena,
+        discord_payload_t,
+        .arena = arena,
+        .op = cJSON_IsNumber(op) ? op->valueint : -1);
 
     // todo: memcheck
 
-    _id->valuestring = NULL;
-
-    if (_name) {
-        _name->valuestring = NULL;
-    }
-
-    return channel;
-}
-
-cJSON *discord_channel_to_cjson(discord_channel_t *channel)
-{
-    if (!channel)
-        return NULL;
-
-    cJSON *root = cJSON_CreateObject();
+    cJSON *s = cJSON_GetObjectItem(cjson, "s");
 
-    cJSON_AddItemToObject(root, "id", cJSON_CreateStringReference(channel->id));
-    cJSON_AddItemToObject(root, "type", cJSON_CreateNumber(channel->type));
+    pl->s = cJSON_IsNumber(s) ? s->valueint : DISCORD_NULL_SEQUENCE_NUMBER;
 
-    if (channel->name) {
-        cJSON_AddItemToObject(root, "name", cJSON_CreateStringReference(channel->name));
+    if (pl->s <= 0) {
+        pl->s = DISCORD_NULL_SEQUENCE_NUMBER;
     }
 
-    // todo: memchecks
-
-    return root;
-}
-
-discord_role_t *discord_role_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
-
-    cJSON *_id = cJSON_GetObjectItem(root, "id");
-    cJSON *_name = cJSON_GetObjectItem(root, "name");
-    cJSON *_pos = cJSON_GetObjectItem(root, "position");
-    cJSON *_permissions = cJSON_GetObjectItem(root, "permissions");
-
-    discord_role_t *role = cu_ctor(discord_role_t,
-        .id = _id->valuestring,
-        .name = _name->valuestring,
-        .position = _pos->valueint,
-        .permissions = _permissions->valuestring);
-
-    // todo: memcheck
-
-    _id->valuestring = _name->valuestring = _permissions->valuestring = NULL;
+    cJSON *d = cJSON_GetObjectItem(cjson, "d");
 
-    return role;
-}
+    switch (pl->op) {
+        case DISCORD_OP_HELLO:
+            pl->d = discord_json_schema_decode(&dc_hello_schema, d, arena);
+            break;
 
-cJSON *discord_role_to_cjson(discord_role_t *role)
-{
-    if (!role)
-        return NULL;
+        case DISCORD_OP_DISPATCH: {
+            const char *t = cJSON_GetStringValue(cJSON_GetObjectItem(cjson, "t"));
+            pl->t = t ? discord_model_event_by_name(t, strlen(t)) : DISCORD_EVENT_UNKNOWN;
+            pl->d = discord_dispatch_event_data_from_cjson(pl->t, d, arena);
+        } break;
 
-    cJSON *root = cJSON_CreateObject();
+        case DISCORD_OP_INVALID_SESSION:
+            pl->d = discord_arena_ctor(arena, discord_invalid_session_t, .resumable = cJSON_IsTrue(d));
+            break;
 
-    if (role->id)
-        cJSON_AddItemToObject(root, "id", cJSON_CreateStringReference(role->id));
-    cJSON_AddItemToObject(root, "name", cJSON_CreateStringReference(role->name));
-    cJSON_AddNumberToObject(root, "position", role->position);
-    cJSON_AddItemToObject(root, "permissions", cJSON_CreateStringReference(role->permissions));
+        case DISCORD_OP_HEARTBEAT:
+        case DISCORD_OP_HEARTBEAT_ACK:
+        case DISCORD_OP_RECONNECT:
+            // Ignore
+            break;
 
-    // todo: memchecks
+        default:
+            DISCORD_LOGW("Cannot recognize payload type. Unable to set payload data.");
+            break;
+    }
 
-    return root;
+    return pl;
 }
 
-discord_message_t *discord_message_from_cjson(cJSON *root)
+discord_payload_data_t discord_dispatch_event_data_from_cjson(
+    discord_event_t e, cJSON *cjson, discord_arena_handle_t arena)
 {
-    if (!root)
-        return NULL;
-
-    cJSON *_id = cJSON_GetObjectItem(root, "id");
-    cJSON *_content = cJSON_GetObjectItem(root, "content");
-    cJSON *_cid = cJSON_GetObjectItem(root, "channel_id");
-    cJSON *_gid = cJSON_GetObjectItem(root, "guild_id");
-    cJSON *_type = cJSON_GetObjectItem(root, "type");
-
-    discord_message_t *message = cu_ctor(discord_message_t,
-        .id = _id ? _id->valuestring : NULL,
-        .type = (discord_message_type_t)(_type ? _type->valueint : DISCORD_MESSAGE_UNDEFINED),
-        .content = _content ? _content->valuestring : NULL,
-        .channel_id = _cid->valuestring,
-        .author = discord_user_from_cjson(cJSON_GetObjectItem(root, "author")),
-        .guild_id = _gid ? _gid->valuestring : NULL,
-        .member = discord_member_from_cjson(cJSON_GetObjectItem(root, "member")));
-
-    // todo: memchecks
-
-    _cid->valuestring = NULL;
-
-    if (_content)
-        _content->valuestring = NULL;
-    if (_id)
-        _id->valuestring = NULL;
-    if (_gid)
-        _gid->valuestring = NULL;
-
-    cJSON *_attachments = cJSON_GetObjectItem(root, "attachments");
-
-    if (cJSON_IsArray(_attachments) && ((message->_attachments_len = cJSON_GetArraySize(_attachments)) > 0)) {
-        message->attachments = calloc(message->_attachments_len, sizeof(discord_attachment_t *));
+    switch (e) {
+        case DISCORD_EVENT_READY:
+            return discord_session_from_cjson(cjson, arena);
 
-        // todo: memcheck
+        case DISCORD_EVENT_RESUMED:
+            return NULL;
 
-        for (uint8_t i = 0; i < message->_attachments_len; i++) {
-            message->attachments[i] = discord_attachment_from_cjson(cJSON_GetArrayItem(_attachments, i));
-        }
-    }
+        case DISCORD_EVENT_MESSAGE_RECEIVED:
+        case DISCORD_EVENT_MESSAGE_UPDATED:
+        case DISCORD_EVENT_MESSAGE_DELETED:
+            return discord_message_from_cjson(cjson, arena);
 
-    return message;
-}
+        case DISCORD_EVENT_MESSAGE_REACTION_ADDED:
+        case DISCORD_EVENT_MESSAGE_REACTION_REMOVED:
+            return discord_message_reaction_from_cjson(cjson, arena);
 
-cJSON *discord_message_to_cjson(discord_message_t *msg)
-{
-    cJSON *root = cJSON_CreateObject();
-
-    if (msg->id)
-        cJSON_AddItemToObject(root, "id", cJSON_CreateStringReference(msg->id));
-    cJSON_AddItemToObject(root, "content", cJSON_CreateStringReference(msg->content));
-    cJSON_AddItemToObject(root, "channel_id", cJSON_CreateStringReference(msg->channel_id));
-    if (msg->author)
-        cJSON_AddItemToObject(root, "author", discord_user_to_cjson(msg->author));
-    if (msg->guild_id)
-        cJSON_AddItemToObject(root, "guild_id", cJSON_CreateStringReference(msg->guild_id));
-    if (msg->member)
-        cJSON_AddItemToObject(root, "member", discord_member_to_cjson(msg->member));
-
-    if (msg->_attachments_len > 0 && msg->attachments) {
-        cJSON *attachments = cJSON_CreateArray();
-
-        for (uint8_t i = 0; i < msg->_attachments_len; i++) {
-            cJSON_AddItemToArray(attachments, discord_attachment_to_cjson(msg->attachments[i]));
-        }
+        case DISCORD_EVENT_VOICE_STATE_UPDATED:
+            return discord_voice_state_from_cjson(cjson, arena);
 
-        cJSON_AddItemToObject(root, "attachments", attachments);
-    }
+        case DISCORD_EVENT_GUILD_MEMBERS_CHUNK:
+            return discord_member_chunk_from_cjson(cjson, arena);
 
-    if (msg->_embeds_len > 0 && msg->embeds) {
-        cJSON *embeds = cJSON_CreateArray();
+        case DISCORD_EVENT_GUILD_CREATE:
+        case DISCORD_EVENT_GUILD_UPDATE:
+        case DISCORD_EVENT_GUILD_DELETE:
+            return discord_guild_from_cjson(cjson, arena);
 
-        for (uint8_t i = 0; i < msg->_embeds_len; i++) {
-            cJSON_AddItemToArray(embeds, discord_embed_to_cjson(msg->embeds[i]));
-        }
+        case DISCORD_EVENT_CHANNEL_CREATE:
+        case DISCORD_EVENT_CHANNEL_UPDATE:
+        case DISCORD_EVENT_CHANNEL_DELETE:
+            return discord_channel_from_cjson(cjson, arena);
 
-        cJSON_AddItemToObject(root, "embeds", embeds);
+        default:
+            return NULL; // event without model is fired with NULL data
     }
-
-    // todo: memchecks
-
-    return root;
 }
 
-discord_emoji_t *discord_emoji_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
-
-    cJSON *_name = cJSON_GetObjectItem(root, "name");
-
-    if (!_name) {
-        DISCORD_LOGW("Missing name");
-        return NULL;
-    }
+static const discord_json_field_t dc_user_fields[] = {
+    DISCORD_JSON_STRING(discord_user_t, id, "id", DC_DE),
+    DISCORD_JSON_BOOL(discord_user_t, bot, "bot", DC_DE),
+    DISCORD_JSON_STRING(discord_user_t, username, "username", DC_DE),
+    DISCORD_JSON_STRING(discord_user_t, discriminator, "discriminator", DC_DE),
+};
+static DISCORD_JSON_SCHEMA(dc_user_schema, discord_user_t, dc_user_fields);
 
-    discord_emoji_t *emoji = cu_ctor(discord_emoji_t, .name = _name->valuestring);
+static const discord_json_field_t dc_session_fields[] = {
+    DISCORD_JSON_STRING(discord_session_t, session_id, "session_id", DC_D),
+    DISCORD_JSON_STRING(discord_session_t, resume_gateway_url, "resume_gateway_url", DC_D),
+    DISCORD_JSON_OBJECT(discord_session_t, user, "user", DC_D, dc_user_schema),
+};
+static DISCORD_JSON_SCHEMA(dc_session_schema, discord_session_t, dc_session_fields);
 
-    // todo: memcheck
+static const discord_json_field_t dc_member_fields[] = {
+    DISCORD_JSON_OBJECT(discord_member_t, user, "user", DC_DE, dc_user_schema),
+    DISCORD_JSON_STRING(discord_member_t, nick, "nick", DC_DE),
+    DISCORD_JSON_STRING(discord_member_t, permissions, "permissions", DC_DE),
+    DISCORD_JSON_STRING_LIST(discord_member_t, roles, _roles_len, "roles", DC_D),
+};
+static DISCORD_JSON_SCHEMA(dc_member_schema, discord_member_t, dc_member_fields);
 
-    _name->valuestring = NULL;
+static const discord_json_field_t dc_member_chunk_fields[] = {
+    DISCORD_JSON_STRING(discord_member_chunk_t, guild_id, "guild_id", DC_D),
+    DISCORD_JSON_STRING(discord_member_chunk_t, nonce, "nonce", DC_D),
+    DISCORD_JSON_INT(discord_member_chunk_t, chunk_index, "chunk_index", DC_D, 0),
+    DISCORD_JSON_INT(discord_member_chunk_t, chunk_count, "chunk_count", DC_D, 1),
+};
+static DISCORD_JSON_SCHEMA(dc_member_chunk_schema, discord_member_chunk_t, dc_member_chunk_fields);
+
+static const discord_json_field_t dc_attachment_fields[] = {
+    DISCORD_JSON_STRING(discord_attachment_t, id, "id", DC_DE),
+    DISCORD_JSON_STRING(discord_attachment_t, filename, "filename", DC_DE),
+    DISCORD_JSON_STRING(discord_attachment_t, content_type, "content_type", DC_D),
+    DISCORD_JSON_INT(discord_attachment_t, size, "size", DC_D, 0),
+    DISCORD_JSON_STRING(discord_attachment_t, url, "url", DC_D),
+};
+static DISCORD_JSON_SCHEMA(dc_attachment_schema, discord_attachment_t, dc_attachment_fields);
 
-    return emoji;
-}
+static const discord_json_field_t dc_embed_footer_fields[] = {
+    DISCORD_JSON_STRING(discord_embed_footer_t, text, "text", DC_E),
+    DISCORD_JSON_STRING(discord_embed_footer_t, icon_url, "icon_url", DC_E),
+};
+static DISCORD_JSON_SCHEMA(dc_embed_footer_schema, discord_embed_footer_t, dc_embed_footer_fields);
 
-discord_message_reaction_t *discord_message_reaction_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
+static const discord_json_field_t dc_embed_image_fields[] = {
+    DISCORD_JSON_STRING(discord_embed_image_t, url, "url", DC_E),
+};
+static DISCORD_JSON_SCHEMA(dc_embed_image_schema, discord_embed_image_t, dc_embed_image_fields);
 
-    cJSON *_uid = cJSON_GetObjectItem(root, "user_id");
-    cJSON *_mid = cJSON_GetObjectItem(root, "message_id");
-    cJSON *_cid = cJSON_GetObjectItem(root, "channel_id");
+static const discord_json_field_t dc_embed_author_fields[] = {
+    DISCORD_JSON_STRING(discord_embed_author_t, name, "name", DC_E),
+    DISCORD_JSON_STRING(discord_embed_author_t, url, "url", DC_E),
+    DISCORD_JSON_STRING(discord_embed_author_t, icon_url, "icon_url", DC_E),
+};
+static DISCORD_JSON_SCHEMA(dc_embed_author_schema, discord_embed_author_t, dc_embed_author_fields);
 
-    discord_message_reaction_t *react = cu_ctor(discord_message_reaction_t,
-        .user_id = _uid->valuestring,
-        .message_id = _mid->valuestring,
-        .channel_id = _cid->valuestring,
-        .emoji = discord_emoji_from_cjson(cJSON_GetObjectItem(root, "emoji")));
+static const discord_json_field_t dc_embed_field_fields[] = {
+    DISCORD_JSON_STRING(discord_embed_field_t, name, "name", DC_E),
+    DISCORD_JSON_STRING(discord_embed_field_t, value, "value", DC_E),
+    DISCORD_JSON_BOOL(discord_embed_field_t, is_inline, "inline", DC_E),
+};
+static DISCORD_JSON_SCHEMA(dc_embed_field_schema, discord_embed_field_t, dc_embed_field_fields);
+
+static const discord_json_field_t dc_embed_fields[] = {
+    DISCORD_JSON_STRING(discord_embed_t, title, "title", DC_E),
+    DISCORD_JSON_STRING(discord_embed_t, description, "description", DC_E),
+    DISCORD_JSON_STRING(discord_embed_t, url, "url", DC_E),
+    DISCORD_JSON_INT(discord_embed_t, color, "color", DC_E, 0),
+    DISCORD_JSON_OBJECT(discord_embed_t, footer, "footer", DC_E, dc_embed_footer_schema),
+    DISCORD_JSON_OBJECT(discord_embed_t, image, "image", DC_E, dc_embed_image_schema),
+    DISCORD_JSON_OBJECT(discord_embed_t, thumbnail, "thumbnail", DC_E, dc_embed_image_schema),
+    DISCORD_JSON_OBJECT(discord_embed_t, author, "author", DC_E, dc_embed_author_schema),
+    DISCORD_JSON_OBJECT_LIST(discord_embed_t, fields, _fields_len, "fields", DC_E, dc_embed_field_schema),
+};
+static DISCORD_JSON_SCHEMA(dc_embed_schema, discord_embed_t, dc_embed_fields);
 
-    // todo: memcheck
+static const discord_json_field_t dc_guild_fields[] = {
+    DISCORD_JSON_STRING(discord_guild_t, id, "id", DC_DE),
+    DISCORD_JSON_STRING(discord_guild_t, name, "name", DC_DE),
+    DISCORD_JSON_STRING(discord_guild_t, permissions, "permissions", DC_DE),
+};
+static DISCORD_JSON_SCHEMA(dc_guild_schema, discord_guild_t, dc_guild_fields);
 
-    _uid->valuestring = _mid->valuestring = _cid->valuestring = NULL;
+static const discord_json_field_t dc_channel_fields[] = {
+    DISCORD_JSON_STRING(discord_channel_t, id, "id", DC_DE),
+    DISCORD_JSON_INT(discord_channel_t, type, "type", DC_DE, 0),
+    DISCORD_JSON_STRING(discord_channel_t, name, "name", DC_DE),
+};
+static DISCORD_JSON_SCHEMA(dc_channel_schema, discord_channel_t, dc_channel_fields);
 
-    return react;
-}
+static const discord_json_field_t dc_role_fields[] = {
+    DISCORD_JSON_STRING(discord_role_t, id, "id", DC_DE),
+    DISCORD_JSON_STRING(discord_role_t, name, "name", DC_DE),
+    DISCORD_JSON_INT(discord_role_t, position, "position", DC_DE, 0),
+    DISCORD_JSON_STRING(discord_role_t, permissions, "permissions", DC_DE),
+};
+static DISCORD_JSON_SCHEMA(dc_role_schema, discord_role_t, dc_role_fields);
+
+static const discord_json_field_t dc_message_fields[] = {
+    DISCORD_JSON_STRING(discord_message_t, id, "id", DC_DE),
+    DISCORD_JSON_INT(discord_message_t, type, "type", DC_D, DISCORD_MESSAGE_UNDEFINED),
+    DISCORD_JSON_STRING(discord_message_t, content, "content", DC_DE),
+    DISCORD_JSON_STRING(discord_message_t, channel_id, "channel_id", DC_DE),
+    DISCORD_JSON_OBJECT(discord_message_t, author, "author", DC_DE, dc_user_schema),
+    DISCORD_JSON_STRING(discord_message_t, guild_id, "guild_id", DC_DE),
+    DISCORD_JSON_OBJECT(discord_message_t, member, "member", DC_DE, dc_member_schema),
+    DISCORD_JSON_OBJECT_LIST(
+        discord_message_t, attachments, _attachments_len, "attachments", DC_DE, dc_attachment_schema),
+    DISCORD_JSON_OBJECT_LIST(discord_message_t, embeds, _embeds_len, "embeds", DC_E, dc_embed_schema),
+};
+static DISCORD_JSON_SCHEMA(dc_message_schema, discord_message_t, dc_message_fields);
 
-discord_voice_state_t *discord_voice_state_from_cjson(cJSON *root)
-{
-    if (!root)
-        return NULL;
-
-    cJSON *_gid = cJSON_GetObjectItem(root, "guild_id");
-    cJSON *_cid = cJSON_GetObjectItem(root, "channel_id");
-    cJSON *_uid = cJSON_GetObjectItem(root, "user_id");
-    cJSON *_member = cJSON_GetObjectItem(root, "member");
-
-    discord_voice_state_t *state = cu_ctor(discord_voice_state_t,
-        .guild_id = _gid->valuestring,
-        .channel_id = _cid ? _cid->valuestring : NULL,
-        .user_id = _uid->valuestring,
-        .member = discord_member_from_cjson(_member),
-        .deaf = (bool)cJSON_GetObjectItem(root, "deaf")->valueint,
-        .mute = (bool)cJSON_GetObjectItem(root, "mute")->valueint,
-        .self_deaf = (bool)cJSON_GetObjectItem(root, "self_deaf")->valueint,
-        .self_mute = (bool)cJSON_GetObjectItem(root, "self_mute")->valueint);
+static const discord_json_field_t dc_emoji_fields[] = {
+    DISCORD_JSON_STRING(discord_emoji_t, name, "name", DC_D | DISCORD_JSON_REQUIRED),
+};
+static DISCORD_JSON_SCHEMA(dc_emoji_schema, discord_emoji_t, dc_emoji_fields);
 
-    // todo: memcheck
+static const discord_json_field_t dc_message_reaction_fields[] = {
+    DISCORD_JSON_STRING(discord_message_reaction_t, user_id, "user_id", DC_D),
+    DISCORD_JSON_STRING(discord_message_reaction_t, message_id, "message_id", DC_D),
+    DISCORD_JSON_STRING(discord_message_reaction_t, channel_id, "channel_id", DC_D),
+    DISCORD_JSON_OBJECT(discord_message_reaction_t, emoji, "emoji", DC_D, dc_emoji_schema),
+};
+static DISCORD_JSON_SCHEMA(dc_message_reaction_schema, discord_message_reaction_t, dc_message_reaction_fields);
+
+static const discord_json_field_t dc_voice_state_fields[] = {
+    DISCORD_JSON_STRING(discord_voice_state_t, guild_id, "guild_id", DC_D),
+    DISCORD_JSON_STRING(discord_voice_state_t, channel_id, "channel_id", DC_D),
+    DISCORD_JSON_STRING(discord_voice_state_t, user_id, "user_id", DC_D),
+    DISCORD_JSON_OBJECT(discord_voice_state_t, member, "member", DC_D, dc_member_schema),
+    DISCORD_JSON_BOOL(discord_voice_state_t, deaf, "deaf", DC_D),
+    DISCORD_JSON_BOOL(discord_voice_state_t, mute, "mute", DC_D),
+    DISCORD_JSON_BOOL(discord_voice_state_t, self_deaf, "self_deaf", DC_D),
+    DISCORD_JSON_BOOL(discord_voice_state_t, self_mute, "self_mute", DC_D),
+};
+static DISCORD_JSON_SCHEMA(dc_voice_state_schema, discord_voice_state_t, dc_voice_state_fields);
 
-    _gid->valuestring = _uid->valuestring = NULL;
+#define DC_JSON_DECODER(model)                                                                                         \
+    discord_##model##_t *discord_##model##_from_cjson(cJSON *root, discord_arena_handle_t arena)                       \
+    {                                                                                                                  \
+        return discord_json_schema_decode(&dc_##model##_schema, root, arena);                                          \
+    }
 
-    if (_cid) {
-        _cid->valuestring = NULL;
+#define DC_JSON_ENCODER(model)                                                                                         \
+    cJSON *discord_##model##_to_cjson(discord_##model##_t *model)                                                      \
+    {                                                                                                                  \
+        return discord_json_schema_encode(&dc_##model##_schema, model);                                                \
     }
 
-    return state;
-}
+DC_JSON_DECODER(session)
+DC_JSON_DECODER(user)
+DC_JSON_ENCODER(user)
+DC_JSON_DECODER(member)
+DC_JSON_ENCODER(member)
+DC_JSON_DECODER(member_chunk)
+DC_JSON_DECODER(attachment)
+DC_JSON_ENCODER(attachment)
+DC_JSON_ENCODER(embed)
+DC_JSON_DECODER(guild)
+DC_JSON_ENCODER(guild)
+DC_JSON_DECODER(channel)
+DC_JSON_ENCODER(channel)
+DC_JSON_DECODER(role)
+DC_JSON_ENCODER(role)
+DC_JSON_DECODER(message)
+DC_JSON_ENCODER(message)
+DC_JSON_DECODER(emoji)
+DC_JSON_DECODER(message_reaction)
+DC_JSON_DECODER(voice_state)
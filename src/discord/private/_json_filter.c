@@ -0,0 +1,334 @@
+#include "discord/private/_json_filter.h"
+#include "discord/private/_discord.h"
+#include "estr.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define DISCORD_JSON_FILTER_MAX_DEPTH (64)
+#define DISCORD_JSON_FILTER_KEY_SIZE  (32)
+
+typedef enum {
+    DISCORD_JSON_FILTER_VALUE,      /*<! Expecting value (document root or after colon) */
+    DISCORD_JSON_FILTER_ELEMENT,    /*<! Expecting array element or end of array */
+    DISCORD_JSON_FILTER_KEY,        /*<! Expecting object key or end of object */
+    DISCORD_JSON_FILTER_KEY_STRING, /*<! Inside of object key */
+    DISCORD_JSON_FILTER_COLON,      /*<! Expecting colon after object key */
+    DISCORD_JSON_FILTER_STRING,     /*<! Inside of string value */
+    DISCORD_JSON_FILTER_SCALAR,     /*<! Inside of number or literal */
+    DISCORD_JSON_FILTER_AFTER,      /*<! Expecting comma or end of container */
+    DISCORD_JSON_FILTER_SKIP,       /*<! Skipping value of not allowed key */
+    DISCORD_JSON_FILTER_ERROR,
+} discord_json_filter_state_t;
+
+struct discord_json_filter
+{
+    const char *const *keys;
+    discord_json_filter_state_t state;
+    uint64_t objects;  /*<! Bit per depth. Set if container is an object */
+    uint64_t nonempty; /*<! Bit per depth. Set if at least one member is already written */
+    uint8_t depth;
+    uint8_t skip_depth; /*<! Nesting inside of skipped value */
+    bool skip_string;   /*<! Skipped value is currently inside of a string */
+    bool keep;          /*<! Last parsed key is allowed */
+    bool escape;
+    uint8_t key_len;
+    char key[DISCORD_JSON_FILTER_KEY_SIZE];
+};
+
+#define _bit(depth) (1ULL << (depth))
+
+discord_json_filter_handle_t discord_json_filter_create(const char *const *keys)
+{
+    discord_json_filter_handle_t filter = calloc(1, sizeof(struct discord_json_filter));
+
+    if (filter) {
+        filter->keys = keys;
+        discord_json_filter_reset(filter);
+    }
+
+    return filter;
+}
+
+void discord_json_filter_reset(discord_json_filter_handle_t filter)
+{
+    if (!filter)
+        return;
+
+    filter->state = DISCORD_JSON_FILTER_VALUE;
+    filter->objects = 0;
+    filter->nonempty = 0;
+    filter->depth = 0;
+    filter->skip_depth = 0;
+    filter->skip_string = false;
+    filter->keep = false;
+    filter->escape = false;
+    filter->key_len = 0;
+}
+
+static bool dc_json_filter_is_allowed(discord_json_filter_handle_t filter)
+{
+    if (filter->key_len >= DISCORD_JSON_FILTER_KEY_SIZE) {
+        return false; // key was truncated
+    }
+
+    filter->key[filter->key_len] = '\0';
+
+    for (const char *const *key = filter->keys; *key; key++) {
+        if (estr_eq(filter->key, *key)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline bool dc_json_filter_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * @brief Enter nested container. Returns false if maximum depth is reached
+ */
+static bool dc_json_filter_push(discord_json_filter_handle_t filter, bool object)
+{
+    if (filter->depth + 1 >= DISCORD_JSON_FILTER_MAX_DEPTH) {
+        DISCORD_LOGW("JSON nested too deep");
+        return false;
+    }
+
+    filter->depth++;
+    filter->nonempty &= ~_bit(filter->depth);
+
+    if (object) {
+        filter->objects |= _bit(filter->depth);
+    }
+    else {
+        filter->objects &= ~_bit(filter->depth);
+    }
+
+    filter->state = object ? DISCORD_JSON_FILTER_KEY : DISCORD_JSON_FILTER_ELEMENT;
+
+    return true;
+}
+
+esp_err_t discord_json_filter_write(discord_json_filter_handle_t filter, const char *in, size_t in_len, char *out,
+    size_t out_size, size_t *out_len)
+{
+    if (!filter || !in || !out || !out_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t len = *out_len;
+    esp_err_t err = ESP_OK;
+
+#define _emit(c)                                                                                                       \
+    do {                                                                                                               \
+        if (len < out_size) {                                                                                          \
+            out[len++] = (c);                                                                                          \
+        }                                                                                                              \
+        else {                                                                                                         \
+            err = ESP_ERR_INVALID_SIZE;                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+#define _emit_comma()                                                                                                  \
+    do {                                                                                                               \
+        if (filter->nonempty & _bit(filter->depth)) {                                                                  \
+            _emit(',');                                                                                                \
+        }                                                                                                              \
+        filter->nonempty |= _bit(filter->depth);                                                                       \
+    } while (0)
+
+    for (size_t i = 0; i < in_len && filter->state != DISCORD_JSON_FILTER_ERROR;) {
+        char c = in[i];
+
+        switch (filter->state) {
+            case DISCORD_JSON_FILTER_ELEMENT:
+                if (c == ']') {
+                    _emit(c);
+                    filter->depth--;
+                    filter->state = DISCORD_JSON_FILTER_AFTER;
+                    break;
+                }
+
+                if (dc_json_filter_is_space(c)) {
+                    break;
+                }
+
+                _emit_comma();
+                filter->state = DISCORD_JSON_FILTER_VALUE;
+                continue; // process the same character as value
+
+            case DISCORD_JSON_FILTER_VALUE:
+                if (dc_json_filter_is_space(c)) {
+                    break;
+                }
+
+                _emit(c);
+
+                if (c == '{' || c == '[') {
+                    if (!dc_json_filter_push(filter, c == '{')) {
+                        filter->state = DISCORD_JSON_FILTER_ERROR;
+                    }
+                }
+                else if (c == '"') {
+                    filter->state = DISCORD_JSON_FILTER_STRING;
+                }
+                else {
+                    filter->state = DISCORD_JSON_FILTER_SCALAR;
+                }
+                break;
+
+            case DISCORD_JSON_FILTER_KEY:
+                if (c == '}') {
+                    _emit(c);
+                    filter->depth--;
+                    filter->state = DISCORD_JSON_FILTER_AFTER;
+                }
+                else if (c == '"') {
+                    filter->key_len = 0;
+                    filter->state = DISCORD_JSON_FILTER_KEY_STRING;
+                }
+                else if (!dc_json_filter_is_space(c)) {
+                    filter->state = DISCORD_JSON_FILTER_ERROR;
+                }
+                break;
+
+            case DISCORD_JSON_FILTER_KEY_STRING:
+                if (!filter->escape && c == '"') {
+                    if ((filter->keep = dc_json_filter_is_allowed(filter))) {
+                        _emit_comma();
+                        _emit('"');
+                        for (uint8_t k = 0; k < filter->key_len; k++) {
+                            _emit(filter->key[k]);
+                        }
+                        _emit('"');
+                    }
+
+                    filter->state = DISCORD_JSON_FILTER_COLON;
+                    break;
+                }
+
+                filter->escape = !filter->escape && c == '\\';
+
+                if (filter->key_len < DISCORD_JSON_FILTER_KEY_SIZE) {
+                    filter->key[filter->key_len++] = c;
+                }
+                break;
+
+            case DISCORD_JSON_FILTER_COLON:
+                if (c == ':') {
+                    if (filter->keep) {
+                        _emit(c);
+                        filter->state = DISCORD_JSON_FILTER_VALUE;
+                    }
+                    else {
+                        filter->skip_depth = 0;
+                        filter->skip_string = false;
+                        filter->state = DISCORD_JSON_FILTER_SKIP;
+                    }
+                }
+                else if (!dc_json_filter_is_space(c)) {
+                    filter->state = DISCORD_JSON_FILTER_ERROR;
+                }
+                break;
+
+            case DISCORD_JSON_FILTER_STRING:
+                _emit(c);
+
+                if (!filter->escape && c == '"') {
+                    filter->state = DISCORD_JSON_FILTER_AFTER;
+                }
+
+                filter->escape = !filter->escape && c == '\\';
+                break;
+
+            case DISCORD_JSON_FILTER_SCALAR:
+                if (c == ',' || c == '}' || c == ']' || dc_json_filter_is_space(c)) {
+                    filter->state = DISCORD_JSON_FILTER_AFTER;
+                    continue; // delimiter belongs to the container
+                }
+
+                _emit(c);
+                break;
+
+            case DISCORD_JSON_FILTER_AFTER:
+                if (c == ',') {
+                    filter->state = (filter->objects & _bit(filter->depth)) ? DISCORD_JSON_FILTER_KEY
+                                                                           : DISCORD_JSON_FILTER_ELEMENT;
+                }
+                else if (c == '}' || c == ']') {
+                    if (filter->depth == 0) {
+                        filter->state = DISCORD_JSON_FILTER_ERROR;
+                        break;
+                    }
+
+                    _emit(c);
+                    filter->depth--;
+                }
+                else if (!dc_json_filter_is_space(c)) {
+                    filter->state = DISCORD_JSON_FILTER_ERROR;
+                }
+                break;
+
+            case DISCORD_JSON_FILTER_SKIP:
+                if (filter->skip_string) {
+                    if (!filter->escape && c == '"') {
+                        filter->skip_string = false;
+
+                        if (filter->skip_depth == 0) {
+                            filter->state = DISCORD_JSON_FILTER_AFTER;
+                        }
+                    }
+
+                    filter->escape = !filter->escape && c == '\\';
+                    break;
+                }
+
+                if (c == '"') {
+                    filter->skip_string = true;
+                }
+                else if (c == '{' || c == '[') {
+                    filter->skip_depth++;
+                }
+                else if (c == '}' || c == ']') {
+                    if (filter->skip_depth == 0) {
+                        filter->state = DISCORD_JSON_FILTER_AFTER;
+                        continue; // skipped scalar was the last member
+                    }
+
+                    if (--filter->skip_depth == 0) {
+                        filter->state = DISCORD_JSON_FILTER_AFTER;
+                    }
+                }
+                else if (c == ',' && filter->skip_depth == 0) {
+                    filter->state = DISCORD_JSON_FILTER_AFTER;
+                    continue;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        i++;
+    }
+
+#undef _emit_comma
+#undef _emit
+
+    *out_len = len;
+
+    if (filter->state == DISCORD_JSON_FILTER_ERROR) {
+        DISCORD_LOGW("Fail to filter malformed JSON");
+        return ESP_FAIL;
+    }
+
+    return err;
+}
+
+void discord_json_filter_free(discord_json_filter_handle_t filter)
+{
+    free(filter);
+}
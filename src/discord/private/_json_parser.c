@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "discord/private/_json_parser.h"
+#include "discord/private/_discord.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define DISCORD_JSON_PARSER_MAX_DEPTH (32)
+
+typedef struct
+{
+    char *p;
+    char *end;
+    discord_arena_handle_t arena;
+    uint8_t depth;
+} dc_json_parser_t;
+
+static cJSON *dc_json_parse_value(dc_json_parser_t *parser);
+
+static void dc_json_skip_space(dc_json_parser_t *parser)
+{
+    while (parser->p < parser->end
+        && (*parser->p == ' ' || *parser->p == '\t' || *parser->p == '\n' || *parser->p == '\r')) {
+        parser->p++;
+    }
+}
+
+static int dc_json_parse_hex4(const char *p)
+{
+    int value = 0;
+
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        value <<= 4;
+
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        }
+        else {
+            return -1;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief Unescape \uXXXX sequence (or surrogate pair) at src into UTF-8 at dst.
+ *        Encoded character is never longer than the escape sequence, so this is safe in place
+ * @return Number of consumed source characters after the backslash or 0 on error
+ */
+static size_t dc_json_unescape_unicode(const char *src, const char *end, char **dst)
+{
+    if (end - src < 5) {
+        return 0;
+    }
+
+    long codepoint = dc_json_parse_hex4(src + 1);
+    size_t consumed = 5;
+
+    if (codepoint < 0) {
+        return 0;
+    }
+
+    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) { // high surrogate, low one must follow
+        if (end - src < 11 || src[5] != '\\' || src[6] != 'u') {
+            return 0;
+        }
+
+        long low = dc_json_parse_hex4(src + 7);
+
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return 0;
+        }
+
+        codepoint = 0x10000 + (((codepoint & 0x3FF) << 10) | (low & 0x3FF));
+        consumed = 11;
+    }
+
+    char *out = *dst;
+
+    if (codepoint < 0x80) {
+        *out++ = (char)codepoint;
+    }
+    else if (codepoint < 0x800) {
+        *out++ = (char)(0xC0 | (codepoint >> 6));
+        *out++ = (char)(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000) {
+        *out++ = (char)(0xE0 | (codepoint >> 12));
+        *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (codepoint & 0x3F));
+    }
+    else {
+        *out++ = (char)(0xF0 | (codepoint >> 18));
+        *out++ = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (codepoint & 0x3F));
+    }
+
+    *dst = out;
+
+    return consumed;
+}
+
+/**
+ * @brief Unescape string in place. Parser must point to the opening quote
+ * @return Pointer to the NUL terminated string or NULL if string is malformed
+ */
+static char *dc_json_parse_string(dc_json_parser_t *parser)
+{
+    char *start = ++parser->p;
+    char *src = start;
+    char *dst = start;
+
+    while (src < parser->end) {
+        if (*src == '"') {
+            *dst = '\0'; // dst is never after src, so closing quote is the latest position of terminator
+            parser->p = src + 1;
+            return start;
+        }
+
+        if (*src != '\\') {
+            *dst++ = *src++;
+            continue;
+        }
+
+        if (++src >= parser->end) {
+            break;
+        }
+
+        switch (*src) {
+            case '"':
+            case '\\':
+            case '/':
+                *dst++ = *src;
+                break;
+
+            case 'b':
+                *dst++ = '\b';
+                break;
+
+            case 'f':
+                *dst++ = '\f';
+                break;
+
+            case 'n':
+                *dst++ = '\n';
+                break;
+
+            case 'r':
+                *dst++ = '\r';
+                break;
+
+            case 't':
+                *dst++ = '\t';
+                break;
+
+            case 'u': {
+                size_t consumed = dc_json_unescape_unicode(src, parser->end, &dst);
+
+                if (!consumed) {
+                    return NULL;
+                }
+
+                src += consumed;
+                continue;
+            }
+
+            default:
+                return NULL;
+        }
+
+        src++;
+    }
+
+    return NULL;
+}
+
+static cJSON *dc_json_new_item(dc_json_parser_t *parser, int type)
+{
+    cJSON *item = discord_arena_alloc(parser->arena, sizeof(cJSON));
+
+    if (item) {
+        item->type = type;
+    }
+
+    return item;
+}
+
+static void dc_json_append(cJSON *parent, cJSON *item)
+{
+    if (!parent->child) {
+        parent->child = item;
+    }
+    else {
+        parent->child->prev->next = item;
+        item->prev = parent->child->prev;
+    }
+
+    parent->child->prev = item; // cJSON keeps the last item in prev of the first one
+}
+
+static cJSON *dc_json_parse_container(dc_json_parser_t *parser, bool object)
+{
+    if (++parser->depth > DISCORD_JSON_PARSER_MAX_DEPTH) {
+        DISCORD_LOGW("JSON nested too deep");
+        return NULL;
+    }
+
+    cJSON *container = dc_json_new_item(parser, object ? cJSON_Object : cJSON_Array);
+    char closing = object ? '}' : ']';
+
+    if (!container) {
+        return NULL;
+    }
+
+    parser->p++; // skip opening bracket
+    dc_json_skip_space(parser);
+
+    if (parser->p < parser->end && *parser->p == closing) {
+        parser->p++;
+        parser->depth--;
+        return container;
+    }
+
+    while (parser->p < parser->end) {
+        char *key = NULL;
+
+        if (object) {
+            if (*parser->p != '"' || !(key = dc_json_parse_string(parser))) {
+                return NULL;
+            }
+
+            dc_json_skip_space(parser);
+
+            if (parser->p >= parser->end || *parser->p++ != ':') {
+                return NULL;
+            }
+        }
+
+        cJSON *item = dc_json_parse_value(parser);
+
+        if (!item) {
+            return NULL;
+        }
+
+        if (key) {
+            item->string = key;
+            item->type |= cJSON_StringIsConst;
+        }
+
+        dc_json_append(container, item);
+        dc_json_skip_space(parser);
+
+        if (parser->p >= parser->end) {
+            break;
+        }
+
+        if (*parser->p == closing) {
+            parser->p++;
+            parser->depth--;
+            return container;
+        }
+
+        if (*parser->p++ != ',') {
+            break;
+        }
+
+        dc_json_skip_space(parser);
+    }
+
+    return NULL;
+}
+
+static cJSON *dc_json_parse_number(dc_json_parser_t *parser)
+{
+    char *number_end = NULL;
+    double number = strtod(parser->p, &number_end);
+
+    if (number_end == parser->p || number_end > parser->end) {
+        return NULL;
+    }
+
+    cJSON *item = dc_json_new_item(parser, cJSON_Number);
+
+    if (item) {
+        item->valuedouble = number;
+
+        // same saturation as cJSON
+        if (number >= INT_MAX) {
+            item->valueint = INT_MAX;
+        }
+        else if (number <= (double)INT_MIN) {
+            item->valueint = INT_MIN;
+        }
+        else {
+            item->valueint = (int)number;
+        }
+    }
+
+    parser->p = number_end;
+
+    return item;
+}
+
+static cJSON *dc_json_parse_literal(dc_json_parser_t *parser, const char *literal, int type)
+{
+    size_t len = strlen(literal);
+
+    if ((size_t)(parser->end - parser->p) < len || strncmp(parser->p, literal, len) != 0) {
+        return NULL;
+    }
+
+    parser->p += len;
+
+    cJSON *item = dc_json_new_item(parser, type);
+
+    if (item && type == cJSON_True) {
+        item->valueint = 1;
+    }
+
+    return item;
+}
+
+static cJSON *dc_json_parse_value(dc_json_parser_t *parser)
+{
+    dc_json_skip_space(parser);
+
+    if (parser->p >= parser->end) {
+        return NULL;
+    }
+
+    switch (*parser->p) {
+        case '{':
+            return dc_json_parse_container(parser, true);
+
+        case '[':
+            return dc_json_parse_container(parser, false);
+
+        case 't':
+            return dc_json_parse_literal(parser, "true", cJSON_True);
+
+        case 'f':
+            return dc_json_parse_literal(parser, "false", cJSON_False);
+
+        case 'n':
+            return dc_json_parse_literal(parser, "null", cJSON_NULL);
+
+        case '"': {
+            char *str = dc_json_parse_string(parser);
+            cJSON *item = str ? dc_json_new_item(parser, cJSON_String | cJSON_IsReference) : NULL;
+
+            if (item) {
+                item->valuestring = str;
+            }
+
+            return item;
+        }
+
+        default:
+            return dc_json_parse_number(parser);
+    }
+}
+
+cJSON *discord_json_parse_in_place(char *json, size_t length, discord_arena_handle_t arena)
+{
+    if (!json || !arena) {
+        return NULL;
+    }
+
+    dc_json_parser_t parser = {
+        .p = json,
+        .end = json + length,
+        .arena = arena,
+    };
+
+    cJSON *root = dc_json_parse_value(&parser);
+
+    if (!root) {
+        DISCORD_LOGW("JSON parsing (syntax?) error");
+    }
+
+    return root;
+}
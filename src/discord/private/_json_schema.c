@@ -0,0 +1,338 @@
+#include <string.h>
+#include "discord/private/_json_schema.h"
+#include "discord/private/_discord.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define _member(obj, offset) ((void *)((char *)(obj) + (offset)))
+
+char *discord_json_take_string(cJSON *item, discord_arena_handle_t arena)
+{
+    if (!item || !item->valuestring) {
+        return NULL;
+    }
+
+    if (arena) {
+        return item->type & cJSON_IsReference ? item->valuestring : discord_arena_strdup(arena, item->valuestring);
+    }
+
+    char *str = item->valuestring;
+    item->valuestring = NULL;
+
+    return str;
+}
+
+static void dc_json_schema_set_int(void *member, uint8_t size, int64_t value)
+{
+    switch (size) {
+        case 1:
+            *(uint8_t *)member = (uint8_t)value;
+            break;
+
+        case 2:
+            *(uint16_t *)member = (uint16_t)value;
+            break;
+
+        case 4:
+            *(int32_t *)member = (int32_t)value;
+            break;
+
+        case 8:
+            *(int64_t *)member = value;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int64_t dc_json_schema_get_int(const void *member, uint8_t size)
+{
+    switch (size) {
+        case 1:
+            return *(const uint8_t *)member;
+
+        case 2:
+            return *(const uint16_t *)member;
+
+        case 4:
+            return *(const int32_t *)member;
+
+        case 8:
+            return *(const int64_t *)member;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Find field by key. Models have just a few fields, so comparing the first character is enough to skip
+ *        almost all of them
+ */
+static const discord_json_field_t *dc_json_schema_field(const discord_json_schema_t *schema, const char *key)
+{
+    if (!key) {
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < schema->fields_len; i++) {
+        const discord_json_field_t *field = &schema->fields[i];
+
+        if ((field->flags & DISCORD_JSON_DECODE) && field->key[0] == key[0] && strcmp(field->key, key) == 0) {
+            return field;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @return Number of elements in the array, limited to what the length member can hold
+ */
+static size_t dc_json_schema_list_len(const discord_json_field_t *field, cJSON *item)
+{
+    size_t len = cJSON_GetArraySize(item);
+    size_t max = field->len_size >= sizeof(size_t) ? SIZE_MAX : ((size_t)1 << (field->len_size * 8)) - 1;
+
+    return len > max ? max : len;
+}
+
+static void dc_json_schema_decode_list(
+    const discord_json_field_t *field, void *obj, cJSON *item, discord_arena_handle_t arena)
+{
+    size_t len = dc_json_schema_list_len(field, item);
+
+    if (len == 0) {
+        return;
+    }
+
+    void **list = discord_arena_calloc(arena, len, sizeof(void *));
+
+    if (!list) {
+        return;
+    }
+
+    size_t i = 0;
+    cJSON *element;
+
+    cJSON_ArrayForEach(element, item)
+    {
+        if (i >= len) {
+            break;
+        }
+
+        list[i++] = field->type == DISCORD_JSON_FIELD_STRING_LIST
+                        ? (cJSON_IsString(element) ? discord_json_take_string(element, arena) : NULL)
+                        : discord_json_schema_decode(field->schema, element, arena);
+    }
+
+    *(void ***)_member(obj, field->offset) = list;
+    dc_json_schema_set_int(_member(obj, field->len_offset), field->len_size, len);
+}
+
+static void dc_json_schema_decode_field(
+    const discord_json_field_t *field, void *obj, cJSON *item, discord_arena_handle_t arena)
+{
+    void *member = _member(obj, field->offset);
+
+    switch (field->type) {
+        case DISCORD_JSON_FIELD_STRING:
+            if (cJSON_IsString(item)) {
+                *(char **)member = discord_json_take_string(item, arena);
+            }
+            break;
+
+        case DISCORD_JSON_FIELD_INT:
+            if (cJSON_IsNumber(item)) {
+                dc_json_schema_set_int(member, field->size, (int64_t)item->valuedouble);
+            }
+            break;
+
+        case DISCORD_JSON_FIELD_BOOL:
+            *(bool *)member = cJSON_IsTrue(item);
+            break;
+
+        case DISCORD_JSON_FIELD_OBJECT:
+            *(void **)member = discord_json_schema_decode(field->schema, item, arena);
+            break;
+
+        case DISCORD_JSON_FIELD_STRING_LIST:
+        case DISCORD_JSON_FIELD_OBJECT_LIST:
+            if (cJSON_IsArray(item)) {
+                dc_json_schema_decode_list(field, obj, item, arena);
+            }
+            break;
+    }
+}
+
+static bool dc_json_schema_has_required(const discord_json_schema_t *schema, const void *obj)
+{
+    for (uint8_t i = 0; i < schema->fields_len; i++) {
+        const discord_json_field_t *field = &schema->fields[i];
+
+        if ((field->flags & DISCORD_JSON_REQUIRED) && field->type != DISCORD_JSON_FIELD_INT
+            && field->type != DISCORD_JSON_FIELD_BOOL && !*(void *const *)_member(obj, field->offset)) {
+            DISCORD_LOGW("Missing %s", field->key);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void *discord_json_schema_decode(const discord_json_schema_t *schema, cJSON *root, discord_arena_handle_t arena)
+{
+    if (!schema || !cJSON_IsObject(root)) {
+        return NULL;
+    }
+
+    void *obj = discord_arena_calloc(arena, 1, schema->size);
+
+    if (!obj) {
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < schema->fields_len; i++) {
+        const discord_json_field_t *field = &schema->fields[i];
+
+        if (field->type == DISCORD_JSON_FIELD_INT && field->def) {
+            dc_json_schema_set_int(_member(obj, field->offset), field->size, field->def);
+        }
+    }
+
+    cJSON *item;
+
+    cJSON_ArrayForEach(item, root)
+    {
+        const discord_json_field_t *field = dc_json_schema_field(schema, item->string);
+
+        if (field) {
+            dc_json_schema_decode_field(field, obj, item, arena);
+        }
+    }
+
+    if (!dc_json_schema_has_required(schema, obj)) {
+        if (!arena) {
+            discord_json_schema_free(schema, obj);
+        }
+
+        return NULL;
+    }
+
+    return obj;
+}
+
+static cJSON *dc_json_schema_encode_list(const discord_json_field_t *field, const void *obj)
+{
+    void *const *list = *(void *const *const *)_member(obj, field->offset);
+    size_t len = dc_json_schema_get_int(_member(obj, field->len_offset), field->len_size);
+
+    if (!list || len == 0) {
+        return NULL;
+    }
+
+    cJSON *array = cJSON_CreateArray();
+
+    for (size_t i = 0; array && i < len; i++) {
+        cJSON_AddItemToArray(array,
+            field->type == DISCORD_JSON_FIELD_STRING_LIST ? cJSON_CreateStringReference(list[i])
+                                                          : discord_json_schema_encode(field->schema, list[i]));
+    }
+
+    return array;
+}
+
+cJSON *discord_json_schema_encode(const discord_json_schema_t *schema, const void *obj)
+{
+    if (!schema || !obj) {
+        return NULL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+
+    for (uint8_t i = 0; root && i < schema->fields_len; i++) {
+        const discord_json_field_t *field = &schema->fields[i];
+        const void *member = _member(obj, field->offset);
+        cJSON *item = NULL;
+
+        if (!(field->flags & DISCORD_JSON_ENCODE)) {
+            continue;
+        }
+
+        switch (field->type) {
+            case DISCORD_JSON_FIELD_STRING:
+                item = *(char *const *)member ? cJSON_CreateStringReference(*(char *const *)member) : NULL;
+                break;
+
+            case DISCORD_JSON_FIELD_INT:
+                item = cJSON_CreateNumber(dc_json_schema_get_int(member, field->size));
+                break;
+
+            case DISCORD_JSON_FIELD_BOOL:
+                item = cJSON_CreateBool(*(const bool *)member);
+                break;
+
+            case DISCORD_JSON_FIELD_OBJECT:
+                item = discord_json_schema_encode(field->schema, *(void *const *)member);
+                break;
+
+            case DISCORD_JSON_FIELD_STRING_LIST:
+            case DISCORD_JSON_FIELD_OBJECT_LIST:
+                item = dc_json_schema_encode_list(field, obj);
+                break;
+        }
+
+        if (item) {
+            cJSON_AddItemToObjectCS(root, field->key, item); // keys are string literals, no need to copy them
+        }
+    }
+
+    // todo: memchecks
+
+    return root;
+}
+
+void discord_json_schema_free(const discord_json_schema_t *schema, void *obj)
+{
+    if (!schema || !obj) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < schema->fields_len; i++) {
+        const discord_json_field_t *field = &schema->fields[i];
+        void *member = _member(obj, field->offset);
+
+        switch (field->type) {
+            case DISCORD_JSON_FIELD_STRING:
+                free(*(char **)member);
+                break;
+
+            case DISCORD_JSON_FIELD_OBJECT:
+                discord_json_schema_free(field->schema, *(void **)member);
+                break;
+
+            case DISCORD_JSON_FIELD_STRING_LIST:
+            case DISCORD_JSON_FIELD_OBJECT_LIST: {
+                void **list = *(void ***)member;
+                size_t len = dc_json_schema_get_int(_member(obj, field->len_offset), field->len_size);
+
+                for (size_t j = 0; list && j < len; j++) {
+                    if (field->type == DISCORD_JSON_FIELD_STRING_LIST) {
+                        free(list[j]);
+                    }
+                    else {
+                        discord_json_schema_free(field->schema, list[j]);
+                    }
+                }
+
+                free(list);
+            } break;
+
+            default:
+                break;
+        }
+    }
+
+    free(obj);
+}
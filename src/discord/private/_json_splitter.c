@@ -0,0 +1,289 @@
+#include <string.h>
+#include "discord/private/_json_splitter.h"
+#include "discord/private/_discord.h"
+#include "estr.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define DISCORD_JSON_SPLITTER_MAX_DEPTH  (64)
+#define DISCORD_JSON_SPLITTER_TOKEN_SIZE (32)
+
+// depths of interesting containers. root object is on depth 1
+#define DC_SPLITTER_DATA_DEPTH  (2) /*<! Object "d" */
+#define DC_SPLITTER_ARRAY_DEPTH (3) /*<! Split array, its elements are one level deeper */
+#define DC_SPLITTER_ROOT_DEPTH  (1) /*<! Split array when the root itself is split */
+
+typedef enum {
+    DC_SPLITTER_KEY_OTHER,
+    DC_SPLITTER_KEY_T,
+    DC_SPLITTER_KEY_D,
+} dc_splitter_key_t;
+
+struct discord_json_splitter
+{
+    discord_json_splitter_config_t config;
+    uint8_t array_depth; /*<! Depth of split array */
+    size_t dropped;      /*<! Elements which did not fit into element_size since reset */
+    uint64_t objects; /*<! Bit per depth. Set if container is an object */
+    uint8_t depth;
+    bool in_string;
+    bool escape;
+    bool expect_key;
+    dc_splitter_key_t root_key; /*<! Last key of the root object */
+    bool event_matched;         /*<! Value of "t" matches the event */
+    bool in_data;               /*<! Inside of "d" object */
+    bool target_key;            /*<! Last key of "d" is the key of split array */
+    bool splitting;             /*<! Inside of split array */
+    bool in_element;
+    bool element_overflow;
+    size_t element_len;
+    uint8_t token_len;
+    char token[DISCORD_JSON_SPLITTER_TOKEN_SIZE];
+    char element[]; /*<! Must be the last member, element_size + 1 bytes */
+};
+
+#define _bit(depth) (1ULL << (depth))
+
+discord_json_splitter_handle_t discord_json_splitter_create(const discord_json_splitter_config_t *config)
+{
+    if (!config || !config->event != !config->key || !config->element_cb) {
+        return NULL;
+    }
+
+    discord_json_splitter_handle_t splitter
+        = calloc(1, sizeof(struct discord_json_splitter) + config->element_size + 1);
+
+    if (splitter) {
+        splitter->config = *config;
+        splitter->array_depth = config->event ? DC_SPLITTER_ARRAY_DEPTH : DC_SPLITTER_ROOT_DEPTH;
+        discord_json_splitter_reset(splitter);
+    }
+
+    return splitter;
+}
+
+void discord_json_splitter_reset(discord_json_splitter_handle_t splitter)
+{
+    if (!splitter)
+        return;
+
+    splitter->objects = 0;
+    splitter->depth = 0;
+    splitter->in_string = false;
+    splitter->escape = false;
+    splitter->expect_key = false;
+    splitter->root_key = DC_SPLITTER_KEY_OTHER;
+    splitter->event_matched = false;
+    splitter->in_data = false;
+    splitter->target_key = false;
+    splitter->splitting = false;
+    splitter->in_element = false;
+    splitter->element_overflow = false;
+    splitter->element_len = 0;
+    splitter->token_len = 0;
+    splitter->dropped = 0;
+}
+
+static bool dc_json_splitter_token_is(discord_json_splitter_handle_t splitter, const char *str)
+{
+    if (splitter->token_len >= DISCORD_JSON_SPLITTER_TOKEN_SIZE) {
+        return false; // token was truncated
+    }
+
+    splitter->token[splitter->token_len] = '\0';
+
+    return estr_eq(splitter->token, str);
+}
+
+/**
+ * @brief Keys of root and "d" objects, and value of "t" are the only strings splitter is interested in
+ */
+static void dc_json_splitter_string_end(discord_json_splitter_handle_t splitter)
+{
+    if (splitter->expect_key) {
+        if (splitter->depth == 1) {
+            splitter->root_key = dc_json_splitter_token_is(splitter, "t")   ? DC_SPLITTER_KEY_T
+                                 : dc_json_splitter_token_is(splitter, "d") ? DC_SPLITTER_KEY_D
+                                                                            : DC_SPLITTER_KEY_OTHER;
+        }
+        else if (splitter->depth == DC_SPLITTER_DATA_DEPTH && splitter->in_data) {
+            splitter->target_key = dc_json_splitter_token_is(splitter, splitter->config.key);
+        }
+    }
+    else if (splitter->depth == 1 && splitter->root_key == DC_SPLITTER_KEY_T) {
+        splitter->event_matched = dc_json_splitter_token_is(splitter, splitter->config.event);
+    }
+}
+
+static void dc_json_splitter_element_append(discord_json_splitter_handle_t splitter, char c)
+{
+    if (splitter->element_len >= splitter->config.element_size) {
+        splitter->element_overflow = true;
+        return;
+    }
+
+    splitter->element[splitter->element_len++] = c;
+}
+
+static void dc_json_splitter_element_done(discord_json_splitter_handle_t splitter)
+{
+    splitter->in_element = false;
+
+    if (splitter->element_overflow) {
+        DISCORD_LOGW("Element dropped. It does not fit into %d bytes", (int)splitter->config.element_size);
+        splitter->dropped++;
+        return;
+    }
+
+    splitter->element[splitter->element_len] = '\0';
+    splitter->config.element_cb(splitter->config.arg, splitter->element, splitter->element_len);
+}
+
+/**
+ * @brief Process one character
+ * @return True if character stays in the message, false if it is cut out
+ */
+static bool dc_json_splitter_char(discord_json_splitter_handle_t splitter, char c, esp_err_t *err)
+{
+    bool was_in_element = splitter->in_element;
+    bool keep = !splitter->splitting
+                || (!was_in_element && splitter->depth == splitter->array_depth && !splitter->in_string && c == ']');
+
+    if (splitter->in_string) {
+        if (splitter->escape) {
+            splitter->escape = false;
+        }
+        else if (c == '\\') {
+            splitter->escape = true;
+        }
+        else if (c == '"') {
+            splitter->in_string = false;
+            dc_json_splitter_string_end(splitter);
+        }
+
+        if (splitter->in_string && splitter->depth <= DC_SPLITTER_DATA_DEPTH
+            && splitter->token_len < DISCORD_JSON_SPLITTER_TOKEN_SIZE) {
+            splitter->token[splitter->token_len++] = c;
+        }
+
+        if (was_in_element) {
+            dc_json_splitter_element_append(splitter, c);
+        }
+
+        return keep;
+    }
+
+    switch (c) {
+        case '"':
+            splitter->in_string = true;
+            splitter->token_len = 0;
+            break;
+
+        case '{':
+        case '[':
+            if (splitter->depth >= DISCORD_JSON_SPLITTER_MAX_DEPTH - 1) {
+                *err = ESP_FAIL;
+                return keep;
+            }
+
+            if (splitter->splitting && splitter->depth == splitter->array_depth) {
+                splitter->in_element = true;
+                splitter->element_overflow = false;
+                splitter->element_len = 0;
+            }
+
+            splitter->depth++;
+            splitter->expect_key = c == '{';
+
+            if (c == '{') {
+                splitter->objects |= _bit(splitter->depth);
+            }
+            else {
+                splitter->objects &= ~_bit(splitter->depth);
+            }
+
+            if (splitter->depth == splitter->array_depth) {
+                splitter->splitting = c == '['
+                                      && (splitter->array_depth == DC_SPLITTER_ROOT_DEPTH
+                                          || (splitter->in_data && splitter->target_key && splitter->event_matched));
+            }
+            else if (splitter->depth == DC_SPLITTER_DATA_DEPTH) {
+                splitter->in_data = c == '{' && splitter->root_key == DC_SPLITTER_KEY_D;
+            }
+            break;
+
+        case '}':
+        case ']':
+            if (splitter->depth > 0) {
+                splitter->depth--;
+            }
+
+            splitter->expect_key = false;
+
+            if (splitter->depth == splitter->array_depth - 1) {
+                splitter->splitting = false;
+            }
+            else if (splitter->depth == DC_SPLITTER_DATA_DEPTH - 1) {
+                splitter->in_data = false;
+            }
+            break;
+
+        case ':':
+            splitter->expect_key = false;
+            break;
+
+        case ',':
+            splitter->expect_key = splitter->objects & _bit(splitter->depth);
+            break;
+
+        default:
+            break;
+    }
+
+    if (was_in_element || splitter->in_element) {
+        dc_json_splitter_element_append(splitter, c);
+
+        if (splitter->in_element && splitter->depth == splitter->array_depth) {
+            dc_json_splitter_element_done(splitter);
+        }
+    }
+
+    return keep;
+}
+
+esp_err_t discord_json_splitter_write(discord_json_splitter_handle_t splitter, const char *in, size_t in_len)
+{
+    if (!splitter || (!in && in_len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    size_t run = 0; // start of the current run of characters which stay in the message
+
+    for (size_t i = 0; i < in_len && err == ESP_OK; i++) {
+        if (!dc_json_splitter_char(splitter, in[i], &err)) {
+            if (i > run && splitter->config.write_cb
+                && (err = splitter->config.write_cb(splitter->config.arg, in + run, i - run)) != ESP_OK) {
+                return err;
+            }
+
+            run = i + 1;
+        }
+    }
+
+    if (err == ESP_OK && in_len > run && splitter->config.write_cb) {
+        err = splitter->config.write_cb(splitter->config.arg, in + run, in_len - run);
+    }
+
+    return err;
+}
+
+size_t discord_json_splitter_dropped(discord_json_splitter_handle_t splitter)
+{
+    return splitter ? splitter->dropped : 0;
+}
+
+void discord_json_splitter_free(discord_json_splitter_handle_t splitter)
+{
+    free(splitter);
+}
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <string.h>
+#include "discord/private/_json_writer.h"
+#include "discord/private/_discord.h"
+#include "discord/presence.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+void discord_json_writer_init(discord_json_writer_t *writer, char *buf, size_t size)
+{
+    writer->buf = buf;
+    writer->size = buf ? size : 0;
+    writer->len = 0;
+}
+
+static void dc_json_writer_char(discord_json_writer_t *writer, char c)
+{
+    if (writer->len + 1 < writer->size) { // keep one byte for the terminator
+        writer->buf[writer->len] = c;
+    }
+
+    writer->len++;
+}
+
+static void dc_json_writer_mem(discord_json_writer_t *writer, const char *data, size_t len)
+{
+    if (writer->len + len < writer->size) {
+        memcpy(writer->buf + writer->len, data, len);
+    }
+
+    writer->len += len;
+}
+
+void discord_json_writer_raw(discord_json_writer_t *writer, const char *str)
+{
+    dc_json_writer_mem(writer, str, strlen(str));
+}
+
+void discord_json_writer_string(discord_json_writer_t *writer, const char *str)
+{
+    if (!str) {
+        discord_json_writer_raw(writer, "null");
+        return;
+    }
+
+    dc_json_writer_char(writer, '"');
+
+    for (const char *p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+
+        switch (c) {
+            case '"':
+                discord_json_writer_raw(writer, "\\\"");
+                break;
+
+            case '\\':
+                discord_json_writer_raw(writer, "\\\\");
+                break;
+
+            case '\n':
+                discord_json_writer_raw(writer, "\\n");
+                break;
+
+            case '\r':
+                discord_json_writer_raw(writer, "\\r");
+                break;
+
+            case '\t':
+                discord_json_writer_raw(writer, "\\t");
+                break;
+
+            default:
+                if (c < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    discord_json_writer_raw(writer, escaped);
+                }
+                else {
+                    dc_json_writer_char(writer, (char)c);
+                }
+                break;
+        }
+    }
+
+    dc_json_writer_char(writer, '"');
+}
+
+void discord_json_writer_int(discord_json_writer_t *writer, int value)
+{
+    char digits[12]; // "-2147483648"
+    char *p = digits + sizeof(digits);
+    unsigned int u = value < 0 ? 0U - (unsigned int)value : (unsigned int)value;
+
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    dc_json_writer_mem(writer, p, digits + sizeof(digits) - p);
+}
+
+void discord_json_writer_bool(discord_json_writer_t *writer, bool value)
+{
+    discord_json_writer_raw(writer, value ? "true" : "false");
+}
+
+esp_err_t discord_json_writer_end(discord_json_writer_t *writer)
+{
+    if (writer->len >= writer->size) {
+        if (writer->size > 0) {
+            writer->buf[0] = '\0'; // never leave truncated JSON behind
+        }
+
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    writer->buf[writer->len] = '\0';
+
+    return ESP_OK;
+}
+
+static void dc_json_write_heartbeat(discord_json_writer_t *writer, discord_heartbeat_t *heartbeat)
+{
+    int hb = *((int *)(heartbeat));
+
+    if (hb == DISCORD_NULL_SEQUENCE_NUMBER) {
+        discord_json_writer_raw(writer, "null");
+    }
+    else {
+        discord_json_writer_int(writer, hb);
+    }
+}
+
+static void dc_json_write_identify(discord_json_writer_t *writer, discord_identify_t *identify)
+{
+    discord_json_writer_raw(writer, "{\"token\":");
+    discord_json_writer_string(writer, identify->token);
+    discord_json_writer_raw(writer, ",\"intents\":");
+    discord_json_writer_int(writer, identify->intents);
+    discord_json_writer_raw(writer, ",\"properties\":{\"os\":");
+    discord_json_writer_string(writer, identify->properties->os);
+    discord_json_writer_raw(writer, ",\"browser\":");
+    discord_json_writer_string(writer, identify->properties->browser);
+    discord_json_writer_raw(writer, ",\"device\":");
+    discord_json_writer_string(writer, identify->properties->device);
+    discord_json_writer_raw(writer, "}");
+
+    if (identify->shard_count > 1) {
+        discord_json_writer_raw(writer, ",\"shard\":[");
+        discord_json_writer_int(writer, identify->shard_id);
+        discord_json_writer_raw(writer, ",");
+        discord_json_writer_int(writer, identify->shard_count);
+        discord_json_writer_raw(writer, "]");
+    }
+
+    discord_json_writer_raw(writer, "}");
+}
+
+static void dc_json_write_resume(discord_json_writer_t *writer, discord_resume_t *resume)
+{
+    discord_json_writer_raw(writer, "{\"token\":");
+    discord_json_writer_string(writer, resume->token);
+    discord_json_writer_raw(writer, ",\"session_id\":");
+    discord_json_writer_string(writer, resume->session_id);
+    discord_json_writer_raw(writer, ",\"seq\":");
+    discord_json_writer_int(writer, resume->seq);
+    discord_json_writer_raw(writer, "}");
+}
+
+static void dc_json_write_activity(discord_json_writer_t *writer, discord_activity_t *activity)
+{
+    discord_json_writer_raw(writer, "{\"name\":");
+    discord_json_writer_string(writer, activity->name);
+    discord_json_writer_raw(writer, ",\"type\":");
+    discord_json_writer_int(writer, activity->type);
+
+    if (activity->state) {
+        discord_json_writer_raw(writer, ",\"state\":");
+        discord_json_writer_string(writer, activity->state);
+    }
+
+    if (activity->url) {
+        discord_json_writer_raw(writer, ",\"url\":");
+        discord_json_writer_string(writer, activity->url);
+    }
+
+    discord_json_writer_raw(writer, "}");
+}
+
+static void dc_json_write_presence(discord_json_writer_t *writer, discord_presence_t *presence)
+{
+    static const char *const statuses[] = {
+        [DISCORD_PRESENCE_ONLINE] = "online",
+        [DISCORD_PRESENCE_DND] = "dnd",
+        [DISCORD_PRESENCE_IDLE] = "idle",
+        [DISCORD_PRESENCE_INVISIBLE] = "invisible",
+        [DISCORD_PRESENCE_OFFLINE] = "offline",
+    };
+
+    const char *status = (unsigned)presence->status <= DISCORD_PRESENCE_OFFLINE ? statuses[presence->status]
+                                                                               : statuses[DISCORD_PRESENCE_ONLINE];
+
+    discord_json_writer_raw(writer, "{\"since\":null,\"activities\":[");
+
+    if (presence->activity) {
+        dc_json_write_activity(writer, presence->activity);
+    }
+
+    discord_json_writer_raw(writer, "],\"status\":");
+    discord_json_writer_string(writer, status);
+    discord_json_writer_raw(writer, ",\"afk\":");
+    discord_json_writer_bool(writer, presence->afk);
+    discord_json_writer_raw(writer, "}");
+}
+
+static void dc_json_write_request_guild_members(
+    discord_json_writer_t *writer, discord_request_guild_members_t *request_guild_members)
+{
+    discord_member_request_t *request = request_guild_members->request;
+
+    discord_json_writer_raw(writer, "{\"guild_id\":");
+    discord_json_writer_string(writer, request->guild_id);
+
+    if (request->_user_ids_len > 0 && request->user_ids) {
+        discord_json_writer_raw(writer, ",\"user_ids\":[");
+
+        for (uint8_t i = 0; i < request->_user_ids_len; i++) {
+            if (i > 0) {
+                discord_json_writer_raw(writer, ",");
+            }
+
+            discord_json_writer_string(writer, request->user_ids[i]);
+        }
+
+        discord_json_writer_raw(writer, "]");
+    }
+    else {
+        discord_json_writer_raw(writer, ",\"query\":");
+        discord_json_writer_string(writer, request->query ? request->query : "");
+        discord_json_writer_raw(writer, ",\"limit\":");
+        discord_json_writer_int(writer, request->limit);
+    }
+
+    discord_json_writer_raw(writer, ",\"nonce\":");
+    discord_json_writer_string(writer, request_guild_members->nonce);
+    discord_json_writer_raw(writer, "}");
+}
+
+esp_err_t discord_json_write_payload(discord_json_writer_t *writer, discord_payload_t *payload)
+{
+    if (!writer || !payload || !payload->d) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switch (payload->op) {
+        case DISCORD_OP_HEARTBEAT:
+        case DISCORD_OP_IDENTIFY:
+        case DISCORD_OP_RESUME:
+        case DISCORD_OP_PRESENCE_UPDATE:
+        case DISCORD_OP_REQUEST_GUILD_MEMBERS:
+            break;
+
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    discord_json_writer_raw(writer, "{\"op\":");
+    discord_json_writer_int(writer, payload->op);
+    discord_json_writer_raw(writer, ",\"d\":");
+
+    switch (payload->op) {
+        case DISCORD_OP_HEARTBEAT:
+            dc_json_write_heartbeat(writer, (discord_heartbeat_t *)payload->d);
+            break;
+
+        case DISCORD_OP_IDENTIFY:
+            dc_json_write_identify(writer, (discord_identify_t *)payload->d);
+            break;
+
+        case DISCORD_OP_RESUME:
+            dc_json_write_resume(writer, (discord_resume_t *)payload->d);
+            break;
+
+        case DISCORD_OP_REQUEST_GUILD_MEMBERS:
+            dc_json_write_request_guild_members(writer, (discord_request_guild_members_t *)payload->d);
+            break;
+
+        default:
+            dc_json_write_presence(writer, (discord_presence_t *)payload->d);
+            break;
+    }
+
+    discord_json_writer_raw(writer, "}");
+
+    return discord_json_writer_end(writer);
+}
+
+char *discord_json_write_payload_alloc(discord_payload_t *payload)
+{
+    discord_json_writer_t writer;
+    discord_json_writer_init(&writer, NULL, 0);
+
+    if (discord_json_write_payload(&writer, payload) != ESP_ERR_INVALID_SIZE) { // measuring always overflows
+        DISCORD_LOGW("Cannot write payload");
+        return NULL;
+    }
+
+    size_t size = writer.len + 1;
+    char *json = malloc(size);
+
+    if (!json) {
+        return NULL;
+    }
+
+    discord_json_writer_init(&writer, json, size);
+    discord_json_write_payload(&writer, payload);
+
+    return json;
+}
@@ -11,6 +11,8 @@
 #include "discord/message_reaction.h"
 #include "discord/role.h"
 #include "discord/voice_state.h"
+#include "discord/guild.h"
+#include "discord/channel.h"
 
 DISCORD_LOG_DEFINE_BASE();
 
@@ -19,6 +21,11 @@ void discord_payload_free(discord_payload_t *payload)
     if (!payload)
         return;
 
+    if (payload->arena) {
+        discord_arena_release(payload->arena); // payload itself lives in the arena
+        return;
+    }
+
     switch (payload->op) {
         case DISCORD_OP_HELLO:
             discord_hello_free((discord_hello_t *)payload->d);
@@ -30,6 +37,8 @@ void discord_payload_free(discord_payload_t *payload)
 
         case DISCORD_OP_HEARTBEAT:
         case DISCORD_OP_HEARTBEAT_ACK:
+        case DISCORD_OP_RECONNECT:
+        case DISCORD_OP_REQUEST_GUILD_MEMBERS: // data is owned by the sender
             // Ignore
             break;
 
@@ -37,6 +46,14 @@ void discord_payload_free(discord_payload_t *payload)
             discord_identify_free((discord_identify_t *)payload->d);
             break;
 
+        case DISCORD_OP_RESUME:
+            discord_resume_free((discord_resume_t *)payload->d);
+            break;
+
+        case DISCORD_OP_INVALID_SESSION:
+            free(payload->d);
+            break;
+
         default:
             DISCORD_LOGW("Cannot recognize payload type. Possible memory leak.");
             break;
@@ -54,6 +71,10 @@ void discord_dispatch_event_data_free(discord_payload_t *payload)
         case DISCORD_EVENT_READY:
             return discord_session_free((discord_session_t *)payload->d);
 
+        case DISCORD_EVENT_RESUMED:
+            // Ignore
+            return;
+
         case DISCORD_EVENT_MESSAGE_RECEIVED:
         case DISCORD_EVENT_MESSAGE_UPDATED:
         case DISCORD_EVENT_MESSAGE_DELETED:
@@ -66,8 +87,23 @@ void discord_dispatch_event_data_free(discord_payload_t *payload)
         case DISCORD_EVENT_VOICE_STATE_UPDATED:
             return discord_voice_state_free((discord_voice_state_t *)payload->d);
 
+        case DISCORD_EVENT_GUILD_MEMBERS_CHUNK:
+            return discord_member_chunk_free((discord_member_chunk_t *)payload->d);
+
+        case DISCORD_EVENT_GUILD_CREATE:
+        case DISCORD_EVENT_GUILD_UPDATE:
+        case DISCORD_EVENT_GUILD_DELETE:
+            return discord_guild_free((discord_guild_t *)payload->d);
+
+        case DISCORD_EVENT_CHANNEL_CREATE:
+        case DISCORD_EVENT_CHANNEL_UPDATE:
+        case DISCORD_EVENT_CHANNEL_DELETE:
+            return discord_channel_free((discord_channel_t *)payload->d);
+
         default:
-            DISCORD_LOGW("Cannot recognize event type");
+            if (payload->d) { // events without model have no data
+                DISCORD_LOGW("Cannot recognize event type");
+            }
             return;
     }
 }
@@ -100,3 +136,13 @@ void discord_identify_free(discord_identify_t *identify)
     discord_identify_properties_free(identify->properties);
     free(identify);
 }
+
+void discord_resume_free(discord_resume_t *resume)
+{
+    if (!resume)
+        return;
+
+    free(resume->token);
+    free(resume->session_id);
+    free(resume);
+}
@@ -0,0 +1,260 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "discord/private/_ratelimit.h"
+
+#define DC_FNV_OFFSET (2166136261U)
+#define DC_FNV_PRIME  (16777619U)
+
+static uint32_t dc_ratelimit_hash(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * DC_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static bool dc_ratelimit_segment_is(const char *segment, size_t len, const char *name)
+{
+    return strlen(name) == len && strncmp(segment, name, len) == 0;
+}
+
+static bool dc_ratelimit_segment_is_id(const char *segment, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (segment[i] < '0' || segment[i] > '9') {
+            return false;
+        }
+    }
+
+    return len > 0;
+}
+
+uint32_t discord_ratelimit_route(int method, const char *uri, uint32_t *out_major)
+{
+    uint8_t method_byte = (uint8_t)method;
+    uint32_t hash = dc_ratelimit_hash(DC_FNV_OFFSET, &method_byte, 1);
+    uint32_t major = 0;
+    bool major_next = false;
+    bool reaction = false; // emoji and user of reaction routes are not part of the route
+
+    for (const char *p = uri; p && *p && *p != '?';) {
+        if (*p == '/') {
+            p++;
+            continue;
+        }
+
+        size_t len = strcspn(p, "/?");
+
+        if (major_next && !major) {
+            major = dc_ratelimit_hash(DC_FNV_OFFSET, p, len);
+            hash = dc_ratelimit_hash(hash, p, len);
+        }
+        else if (reaction || dc_ratelimit_segment_is_id(p, len)) {
+            hash = dc_ratelimit_hash(hash, ":id", 3);
+        }
+        else {
+            hash = dc_ratelimit_hash(hash, p, len);
+        }
+
+        major_next = dc_ratelimit_segment_is(p, len, "channels") || dc_ratelimit_segment_is(p, len, "guilds")
+                     || dc_ratelimit_segment_is(p, len, "webhooks");
+        reaction = reaction || dc_ratelimit_segment_is(p, len, "reactions");
+        hash = dc_ratelimit_hash(hash, "/", 1);
+        p += len;
+    }
+
+    if (out_major) {
+        *out_major = major;
+    }
+
+    return hash ? hash : 1;
+}
+
+static discord_ratelimit_route_t *dc_ratelimit_route_get(discord_ratelimit_t *ratelimit, uint32_t route, bool insert)
+{
+    discord_ratelimit_route_t *oldest = &ratelimit->routes[0];
+
+    for (int i = 0; i < DISCORD_RATELIMIT_ROUTES; i++) {
+        discord_ratelimit_route_t *entry = &ratelimit->routes[i];
+
+        if (entry->route == route) {
+            return entry;
+        }
+
+        if (entry->used_ms < oldest->used_ms) {
+            oldest = entry;
+        }
+    }
+
+    if (!insert) {
+        return NULL;
+    }
+
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->route = route;
+
+    return oldest;
+}
+
+static discord_ratelimit_bucket_t *dc_ratelimit_bucket_get(discord_ratelimit_t *ratelimit, uint32_t bucket, bool insert)
+{
+    discord_ratelimit_bucket_t *oldest = &ratelimit->buckets[0];
+
+    for (int i = 0; i < DISCORD_RATELIMIT_ROUTES; i++) {
+        discord_ratelimit_bucket_t *entry = &ratelimit->buckets[i];
+
+        if (entry->bucket == bucket) {
+            return entry;
+        }
+
+        if (entry->used_ms < oldest->used_ms) {
+            oldest = entry;
+        }
+    }
+
+    if (!insert) {
+        return NULL;
+    }
+
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->bucket = bucket;
+
+    return oldest;
+}
+
+uint32_t discord_ratelimit_acquire(discord_ratelimit_t *ratelimit, uint32_t route, uint64_t now_ms)
+{
+    if (now_ms < ratelimit->global_reset_ms) {
+        return ratelimit->global_reset_ms - now_ms;
+    }
+
+    if (now_ms - ratelimit->global_window_ms >= DISCORD_RATELIMIT_GLOBAL_PERIOD) {
+        ratelimit->global_window_ms = now_ms;
+        ratelimit->global_count = 0;
+    }
+
+    if (ratelimit->global_count >= DISCORD_RATELIMIT_GLOBAL) {
+        return ratelimit->global_window_ms + DISCORD_RATELIMIT_GLOBAL_PERIOD - now_ms;
+    }
+
+    discord_ratelimit_route_t *entry = dc_ratelimit_route_get(ratelimit, route, false);
+    discord_ratelimit_bucket_t *bucket = NULL;
+
+    if (entry && entry->bucket) {
+        bucket = dc_ratelimit_bucket_get(ratelimit, entry->bucket, false);
+    }
+
+    if (bucket && now_ms < bucket->reset_ms) {
+        if (bucket->remaining == 0) {
+            return bucket->reset_ms - now_ms;
+        }
+
+        bucket->remaining--; // response will tell the exact value
+    }
+
+    if (entry) {
+        entry->used_ms = now_ms;
+    }
+
+    if (bucket) {
+        bucket->used_ms = now_ms;
+    }
+
+    ratelimit->global_count++;
+
+    return 0;
+}
+
+void discord_ratelimit_headers_reset(discord_ratelimit_headers_t *headers)
+{
+    memset(headers, 0, sizeof(*headers));
+    headers->remaining = -1;
+    headers->reset_after_ms = -1;
+    headers->retry_after_ms = -1;
+}
+
+/**
+ * @brief Convert seconds with fraction (e.g. "1.234") to milliseconds, rounded up
+ */
+static int dc_ratelimit_parse_ms(const char *value)
+{
+    double seconds = strtod(value, NULL);
+
+    return seconds > 0 ? (int)(seconds * 1000.0 + 0.999) : 0;
+}
+
+void discord_ratelimit_headers_set(discord_ratelimit_headers_t *headers, const char *key, const char *value)
+{
+    if (!headers || !key || !value) {
+        return;
+    }
+
+    if (strcasecmp(key, "X-RateLimit-Bucket") == 0) {
+        headers->bucket = dc_ratelimit_hash(DC_FNV_OFFSET, value, strlen(value));
+    }
+    else if (strcasecmp(key, "X-RateLimit-Remaining") == 0) {
+        headers->remaining = atoi(value);
+    }
+    else if (strcasecmp(key, "X-RateLimit-Reset-After") == 0) {
+        headers->reset_after_ms = dc_ratelimit_parse_ms(value);
+    }
+    else if (strcasecmp(key, "Retry-After") == 0) {
+        headers->retry_after_ms = dc_ratelimit_parse_ms(value);
+    }
+    else if (strcasecmp(key, "X-RateLimit-Global") == 0) {
+        headers->global = strcasecmp(value, "true") == 0;
+    }
+    else if (strcasecmp(key, "X-RateLimit-Scope") == 0) {
+        headers->global = headers->global || strcasecmp(value, "global") == 0;
+    }
+}
+
+uint32_t discord_ratelimit_update(discord_ratelimit_t *ratelimit, uint32_t route, uint32_t major,
+    const discord_ratelimit_headers_t *headers, int status, uint64_t now_ms)
+{
+    discord_ratelimit_bucket_t *bucket = NULL;
+
+    if (headers->bucket) {
+        uint32_t id = dc_ratelimit_hash(headers->bucket, &major, sizeof(major)); // same bucket, other major is other
+        id = id ? id : 1;
+
+        discord_ratelimit_route_t *entry = dc_ratelimit_route_get(ratelimit, route, true);
+        entry->bucket = id;
+        entry->used_ms = now_ms;
+
+        bucket = dc_ratelimit_bucket_get(ratelimit, id, true);
+        bucket->used_ms = now_ms;
+
+        if (headers->remaining >= 0) {
+            bucket->remaining = headers->remaining > UINT16_MAX ? UINT16_MAX : headers->remaining;
+        }
+
+        if (headers->reset_after_ms >= 0) {
+            bucket->reset_ms = now_ms + headers->reset_after_ms;
+        }
+    }
+
+    if (status != 429) {
+        return 0;
+    }
+
+    int wait_ms = headers->retry_after_ms >= 0 ? headers->retry_after_ms : headers->reset_after_ms;
+    wait_ms = wait_ms > 0 ? wait_ms : 1000; // nothing told, wait a bit anyway
+
+    if (headers->global) {
+        ratelimit->global_reset_ms = now_ms + wait_ms;
+    }
+    else if (bucket) {
+        bucket->remaining = 0;
+
+        if (bucket->reset_ms < now_ms + wait_ms) {
+            bucket->reset_ms = now_ms + wait_ms;
+        }
+    }
+
+    return wait_ms;
+}
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "nvs_flash.h"
+#include "discord/private/_session_store.h"
+#include "discord/private/_discord.h"
+#include "cutils.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define DC_SESSION_STORE_VERSION (1)
+#define DC_SESSION_STORE_STRINGS (5) /*<! session_id, resume_gateway_url, user id, username, discriminator */
+#define DC_SESSION_STORE_SYNCED  (1704067200) /*<! 2024-01-01. Earlier wall clock has not been synchronized yet */
+
+/**
+ * @brief Blob header. NUL terminated strings follow it
+ */
+typedef struct
+{
+    uint8_t version;
+    uint8_t bot;
+    uint16_t shard_count;
+    int32_t seq;
+    int64_t saved_at; /*<! Seconds of wall clock, 0 if it was not synchronized */
+} dc_session_store_header_t;
+
+/**
+ * @brief Get wall clock, or 0 if it has not been synchronized (e.g. by SNTP) since boot
+ */
+static int64_t dc_session_store_now()
+{
+    int64_t now = time(NULL);
+
+    return now >= DC_SESSION_STORE_SYNCED ? now : 0;
+}
+
+static void dc_session_store_key(uint16_t shard_id, char *key, size_t size)
+{
+    snprintf(key, size, DISCORD_NVS_KEY_SESSION "%u", shard_id);
+}
+
+esp_err_t discord_session_store_save(uint16_t shard_id, uint16_t shard_count, discord_session_t *session, int seq)
+{
+    if (!session || !session->session_id || !session->user) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *strings[DC_SESSION_STORE_STRINGS] = {
+        session->session_id,
+        session->resume_gateway_url ? session->resume_gateway_url : "",
+        session->user->id ? session->user->id : "",
+        session->user->username ? session->user->username : "",
+        session->user->discriminator ? session->user->discriminator : "",
+    };
+
+    size_t size = sizeof(dc_session_store_header_t);
+
+    for (int i = 0; i < DC_SESSION_STORE_STRINGS; i++) {
+        size += strlen(strings[i]) + 1;
+    }
+
+    char *blob = malloc(size);
+
+    if (!blob) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    dc_session_store_header_t header = {
+        .version = DC_SESSION_STORE_VERSION,
+        .bot = session->user->bot,
+        .shard_count = shard_count,
+        .seq = seq,
+        .saved_at = dc_session_store_now(),
+    };
+
+    memcpy(blob, &header, sizeof(header));
+    char *p = blob + sizeof(header);
+
+    for (int i = 0; i < DC_SESSION_STORE_STRINGS; i++) {
+        size_t len = strlen(strings[i]) + 1;
+        memcpy(p, strings[i], len);
+        p += len;
+    }
+
+    char key[16];
+    dc_session_store_key(shard_id, key, sizeof(key));
+
+    nvs_handle_t nvs;
+    esp_err_t err;
+
+    if ((err = nvs_open(DISCORD_NVS_NAMESPACE, NVS_READWRITE, &nvs)) == ESP_OK) {
+        if ((err = nvs_set_blob(nvs, key, blob, size)) == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+
+        nvs_close(nvs);
+    }
+
+    free(blob);
+
+    if (err != ESP_OK) {
+        DISCORD_LOGW("Fail to save session checkpoint (err=%d)", err);
+    }
+
+    return err;
+}
+
+static discord_session_t *dc_session_store_parse(const char *blob, size_t size)
+{
+    const char *strings[DC_SESSION_STORE_STRINGS];
+    const char *p = blob + sizeof(dc_session_store_header_t);
+    const char *end = blob + size;
+
+    for (int i = 0; i < DC_SESSION_STORE_STRINGS; i++) {
+        const char *nul = memchr(p, '\0', end - p);
+
+        if (!nul) {
+            return NULL;
+        }
+
+        strings[i] = p;
+        p = nul + 1;
+    }
+
+    dc_session_store_header_t header;
+    memcpy(&header, blob, sizeof(header));
+
+    discord_session_t *session = cu_ctor(discord_session_t, .user = NULL);
+
+    if (!session || !(session->user = cu_ctor(discord_user_t, .bot = header.bot))
+        || !(session->session_id = strdup(strings[0]))
+        || (*strings[1] && !(session->resume_gateway_url = strdup(strings[1])))
+        || !(session->user->id = strdup(strings[2])) || !(session->user->username = strdup(strings[3]))
+        || !(session->user->discriminator = strdup(strings[4]))) {
+        DISCORD_LOGE("Fail to allocate restored session");
+        discord_session_free(session);
+        return NULL;
+    }
+
+    return session;
+}
+
+esp_err_t discord_session_store_load(
+    uint16_t shard_id, uint16_t shard_count, uint32_t max_age, discord_session_t **out_session, int *out_seq)
+{
+    if (!out_session || !out_seq) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char key[16];
+    dc_session_store_key(shard_id, key, sizeof(key));
+
+    nvs_handle_t nvs;
+    esp_err_t err;
+    char *blob = NULL;
+    size_t size = 0;
+
+    if ((err = nvs_open(DISCORD_NVS_NAMESPACE, NVS_READONLY, &nvs)) != ESP_OK) {
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+    }
+
+    if ((err = nvs_get_blob(nvs, key, NULL, &size)) == ESP_OK) {
+        if (size <= sizeof(dc_session_store_header_t)) {
+            err = ESP_ERR_NOT_FOUND;
+        }
+        else if (!(blob = malloc(size))) {
+            err = ESP_ERR_NO_MEM;
+        }
+        else {
+            err = nvs_get_blob(nvs, key, blob, &size);
+        }
+    }
+
+    nvs_close(nvs);
+
+    if (err != ESP_OK) {
+        free(blob);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+    }
+
+    dc_session_store_header_t header;
+    memcpy(&header, blob, sizeof(header));
+
+    int64_t now = dc_session_store_now();
+    discord_session_t *session = NULL;
+
+    if (header.version != DC_SESSION_STORE_VERSION || header.shard_count != shard_count) {
+        DISCORD_LOGD("Session checkpoint of shard %d does not match", shard_id);
+    }
+    else if (!now || !header.saved_at || now < header.saved_at) {
+        DISCORD_LOGD("Session checkpoint of shard %d has unknown age. Wall clock is not synchronized", shard_id);
+    }
+    else if (now - header.saved_at > max_age) {
+        DISCORD_LOGD("Session checkpoint of shard %d is too old (%d s)", shard_id, (int)(now - header.saved_at));
+    }
+    else {
+        session = dc_session_store_parse(blob, size);
+    }
+
+    free(blob);
+
+    if (!session) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *out_session = session;
+    *out_seq = header.seq;
+
+    return ESP_OK;
+}
+
+esp_err_t discord_session_store_erase(uint16_t shard_id)
+{
+    char key[16];
+    dc_session_store_key(shard_id, key, sizeof(key));
+
+    nvs_handle_t nvs;
+    esp_err_t err;
+
+    if ((err = nvs_open(DISCORD_NVS_NAMESPACE, NVS_READWRITE, &nvs)) != ESP_OK) {
+        return err;
+    }
+
+    if ((err = nvs_erase_key(nvs, key)) == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+
+    nvs_close(nvs);
+
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+}
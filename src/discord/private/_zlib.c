@@ -0,0 +1,101 @@
+#include "discord/private/_zlib.h"
+#include "discord/private/_discord.h"
+#include "miniz.h"
+
+DISCORD_LOG_DEFINE_BASE();
+
+#define DISCORD_ZLIB_SYNC_FLUSH_SUFFIX (0x0000FFFF)
+
+struct discord_zlib
+{
+    tinfl_decompressor inflator;
+    uint8_t dict[TINFL_LZ_DICT_SIZE];
+    size_t dict_offset;
+    uint32_t tail; /*<! Last four bytes of compressed stream */
+};
+
+discord_zlib_handle_t discord_zlib_create()
+{
+    discord_zlib_handle_t zlib = malloc(sizeof(struct discord_zlib));
+
+    if (zlib) {
+        discord_zlib_reset(zlib);
+    }
+
+    return zlib;
+}
+
+void discord_zlib_reset(discord_zlib_handle_t zlib)
+{
+    if (!zlib)
+        return;
+
+    tinfl_init(&zlib->inflator);
+    zlib->dict_offset = 0;
+    zlib->tail = 0;
+}
+
+esp_err_t discord_zlib_inflate(discord_zlib_handle_t zlib, const void *in, size_t in_len,
+    discord_zlib_write_cb_t write_cb, void *arg)
+{
+    if (!zlib || !in || !write_cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint8_t *in_buf = (const uint8_t *)in;
+    size_t in_offset = 0;
+    esp_err_t err = ESP_OK;
+
+    for (size_t i = in_len > 4 ? in_len - 4 : 0; i < in_len; i++) {
+        zlib->tail = (zlib->tail << 8) | in_buf[i];
+    }
+
+    for (;;) {
+        size_t in_bytes = in_len - in_offset;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - zlib->dict_offset;
+
+        tinfl_status status = tinfl_decompress(&zlib->inflator,
+            in_buf + in_offset,
+            &in_bytes,
+            zlib->dict,
+            zlib->dict + zlib->dict_offset,
+            &out_bytes,
+            TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+
+        in_offset += in_bytes;
+
+        if (out_bytes > 0) {
+            if (err == ESP_OK) {
+                // on error keep inflating to preserve dictionary, but discard output
+                err = write_cb(arg, (const char *)zlib->dict + zlib->dict_offset, out_bytes);
+            }
+
+            zlib->dict_offset = (zlib->dict_offset + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status < TINFL_STATUS_DONE) {
+            DISCORD_LOGE("Inflate failed (status=%d)", status);
+            return ESP_FAIL;
+        }
+
+        if (status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+            continue; // dictionary wrapped, drain the rest
+        }
+
+        if (status == TINFL_STATUS_DONE || in_offset >= in_len) {
+            break;
+        }
+    }
+
+    return err;
+}
+
+bool discord_zlib_is_flushed(discord_zlib_handle_t zlib)
+{
+    return zlib && zlib->tail == DISCORD_ZLIB_SYNC_FLUSH_SUFFIX;
+}
+
+void discord_zlib_free(discord_zlib_handle_t zlib)
+{
+    free(zlib);
+}
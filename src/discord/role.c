@@ -6,6 +6,16 @@
 
 DISCORD_LOG_DEFINE_BASE();
 
+static void *dc_role_parse(const char *data, int data_len)
+{
+    return discord_json_deserialize_(role, data, data_len);
+}
+
+static void dc_role_free(void *role)
+{
+    discord_role_free(role);
+}
+
 esp_err_t discord_role_get_all(
     discord_handle_t client, const char *guild_id, discord_role_t ***out_roles, discord_role_len_t *out_length)
 {
@@ -15,18 +25,18 @@ esp_err_t discord_role_get_all(
     }
 
     esp_err_t err = ESP_OK;
-    discord_api_response_t *res = NULL;
+    void **list = NULL;
+    int len = 0;
 
-    if ((err = dcapi_get(client, estr_cat("/guilds/", guild_id, "/roles"), NULL, &res)) != ESP_OK) {
+    if ((err = dcapi_get_list(
+             client, estr_cat("/guilds/", guild_id, "/roles"), dc_role_parse, dc_role_free, &list, &len))
+        != ESP_OK) {
         DISCORD_LOGE("Fail to fetch roles");
         return err;
     }
 
-    if (dcapi_response_is_success(res) && res->data_len > 0) {
-        *out_roles = discord_json_list_deserialize_(role, res->data, res->data_len, out_length);
-    }
-
-    dcapi_response_free(client, res);
+    *out_roles = (discord_role_t **)list;
+    *out_length = len;
 
     return err;
 }
@@ -7,7 +7,7 @@ esp_err_t discord_session_get_current(discord_handle_t client, const discord_ses
         return ESP_ERR_INVALID_ARG;
     }
 
-    *out_session = client->session;
+    *out_session = client->shards ? client->shards[0].session : NULL; // all shards share the same bot user
     return ESP_OK;
 }
 
@@ -18,5 +18,6 @@ void discord_session_free(discord_session_t *session)
 
     discord_user_free(session->user);
     free(session->session_id);
+    free(session->resume_gateway_url);
     free(session);
 }
@@ -6,6 +6,16 @@
 
 DISCORD_LOG_DEFINE_BASE();
 
+static void *dc_guild_parse(const char *data, int data_len)
+{
+    return discord_json_deserialize_(guild, data, data_len);
+}
+
+static void dc_guild_free(void *guild)
+{
+    discord_guild_free(guild);
+}
+
 esp_err_t discord_user_get_my_guilds(discord_handle_t client, discord_guild_t ***out_guilds, int *out_length)
 {
     if (!client || !out_guilds || !out_length) {
@@ -14,18 +24,17 @@ esp_err_t discord_user_get_my_guilds(discord_handle_t client, discord_guild_t **
     }
 
     esp_err_t err = ESP_OK;
-    discord_api_response_t *res = NULL;
+    void **list = NULL;
+    int len = 0;
 
-    if ((err = dcapi_get(client, strdup("/users/@me/guilds"), NULL, &res)) != ESP_OK) {
+    if ((err = dcapi_get_list(client, strdup("/users/@me/guilds"), dc_guild_parse, dc_guild_free, &list, &len))
+        != ESP_OK) {
         DISCORD_LOGE("Fail to fetch guilds");
         return err;
     }
 
-    if (dcapi_response_is_success(res) && res->data_len > 0) {
-        *out_guilds = discord_json_list_deserialize_(guild, res->data, res->data_len, out_length);
-    }
-
-    dcapi_response_free(client, res);
+    *out_guilds = (discord_guild_t **)list;
+    *out_length = len;
 
     return err;
 }
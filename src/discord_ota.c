@@ -1,6 +1,7 @@
 #include "esp_image_format.h"
 #include "esp_ota_ops.h"
 #include "discord/private/_discord.h"
+#include "discord/private/_gateway.h"
 #include "discord_ota.h"
 #include "discord/session.h"
 #include "nvs_flash.h"
@@ -123,7 +124,7 @@ esp_err_t discord_ota_init(discord_handle_t client, discord_ota_config_t *config
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (client->running || client->state >= DISCORD_STATE_OPEN) {
+    if (client->running || dcgw_is_open(client)) {
         DISCORD_LOGE("Fail to init. Initialization of OTA should be done before Discord login");
         return ESP_ERR_INVALID_STATE;
     }
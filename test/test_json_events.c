@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include "unity.h"
+#include "discord.h"
+#include "discord/private/_json.h"
+
+static discord_event_t event_by_name(const char *name)
+{
+    char json[96];
+    discord_payload_header_t header;
+
+    snprintf(json, sizeof(json), "{\"t\":\"%s\",\"s\":5,\"op\":0,\"d\":{}}", name);
+    TEST_ASSERT_EQUAL(ESP_OK, discord_payload_header_from_json(json, strlen(json), &header));
+
+    return header.t;
+}
+
+TEST_CASE("every event name resolves through the slot table", "[json_events]")
+{
+    static const struct
+    {
+        const char *name;
+        discord_event_t event;
+    } names[] = {
+        { "READY", DISCORD_EVENT_READY },
+        { "RESUMED", DISCORD_EVENT_RESUMED },
+        { "MESSAGE_CREATE", DISCORD_EVENT_MESSAGE_RECEIVED },
+        { "MESSAGE_DELETE", DISCORD_EVENT_MESSAGE_DELETED },
+        { "MESSAGE_UPDATE", DISCORD_EVENT_MESSAGE_UPDATED },
+        { "MESSAGE_REACTION_ADD", DISCORD_EVENT_MESSAGE_REACTION_ADDED },
+        { "MESSAGE_REACTION_REMOVE", DISCORD_EVENT_MESSAGE_REACTION_REMOVED },
+        { "VOICE_STATE_UPDATE", DISCORD_EVENT_VOICE_STATE_UPDATED },
+        { "GUILD_MEMBERS_CHUNK", DISCORD_EVENT_GUILD_MEMBERS_CHUNK },
+#define _TEST_EVENT_NAME(name) { #name, DISCORD_EVENT_##name },
+        DISCORD_EVENT_CATALOGUE(_TEST_EVENT_NAME)
+#undef _TEST_EVENT_NAME
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(names[i].event, event_by_name(names[i].name), names[i].name);
+    }
+}
+
+TEST_CASE("unknown event name and prefix of known one do not resolve", "[json_events]")
+{
+    TEST_ASSERT_EQUAL(DISCORD_EVENT_UNKNOWN, event_by_name("NOT_AN_EVENT"));
+    TEST_ASSERT_EQUAL(DISCORD_EVENT_UNKNOWN, event_by_name("MESSAGE"));
+    TEST_ASSERT_EQUAL(DISCORD_EVENT_UNKNOWN, event_by_name("READYY"));
+}
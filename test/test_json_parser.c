@@ -0,0 +1,104 @@
+#include <string.h>
+#include "unity.h"
+#include "discord/private/_json_parser.h"
+
+static discord_arena_pool_handle_t pool;
+static discord_arena_handle_t arena;
+static char json[256];
+
+/**
+ * @brief Parse copy of text, since parser unescapes strings in place
+ */
+static cJSON *parse(const char *text, size_t len)
+{
+    pool = discord_arena_pool_create(1, 512);
+    arena = discord_arena_pool_acquire(pool);
+    TEST_ASSERT_NOT_NULL(arena);
+    TEST_ASSERT_LESS_THAN(sizeof(json), len);
+
+    memcpy(json, text, len);
+    json[len] = '\0';
+
+    return discord_json_parse_in_place(json, len, arena);
+}
+
+static void release(void)
+{
+    discord_arena_release(arena);
+    discord_arena_pool_free(pool);
+}
+
+static const char *parse_string(const char *text)
+{
+    cJSON *root = parse(text, strlen(text));
+
+    return root && cJSON_IsString(root) ? root->valuestring : NULL;
+}
+
+TEST_CASE("parser unescapes simple escapes", "[json_parser]")
+{
+    TEST_ASSERT_EQUAL_STRING("a\"b\\c/d\b\f\n\r\t", parse_string("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\""));
+    release();
+}
+
+TEST_CASE("parser decodes unicode escapes into UTF-8", "[json_parser]")
+{
+    TEST_ASSERT_EQUAL_STRING("A\xC3\xA9\xE2\x82\xAC", parse_string("\"\\u0041\\u00e9\\u20AC\""));
+    release();
+}
+
+TEST_CASE("parser joins surrogate pair", "[json_parser]")
+{
+    TEST_ASSERT_EQUAL_STRING("\xF0\x9F\x98\x80!", parse_string("\"\\ud83d\\ude00!\""));
+    release();
+}
+
+TEST_CASE("parser rejects broken escapes", "[json_parser]")
+{
+    const char *broken[] = {
+        "\"\\q\"",             // unknown escape
+        "\"\\u12G4\"",         // not a hex digit
+        "\"\\ud83d\"",         // high surrogate alone
+        "\"\\ud83d\\u0041\"",  // high surrogate followed by other than low one
+        "\"\\ud83d\\ude0\"",   // low surrogate cut short
+    };
+
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        TEST_ASSERT_NULL_MESSAGE(parse_string(broken[i]), broken[i]);
+        release();
+    }
+}
+
+TEST_CASE("parser builds tree of nested containers", "[json_parser]")
+{
+    const char *text = "{ \"a\" : [1, -2.5, true, null], \"b\" : { \"c\" : \"d\" } }";
+    cJSON *root = parse(text, strlen(text));
+
+    TEST_ASSERT_TRUE(cJSON_IsObject(root));
+
+    cJSON *a = cJSON_GetObjectItem(root, "a");
+    TEST_ASSERT_TRUE(cJSON_IsArray(a));
+    TEST_ASSERT_EQUAL(4, cJSON_GetArraySize(a));
+    TEST_ASSERT_EQUAL(1, cJSON_GetArrayItem(a, 0)->valueint);
+    TEST_ASSERT_EQUAL_DOUBLE(-2.5, cJSON_GetArrayItem(a, 1)->valuedouble);
+    TEST_ASSERT_TRUE(cJSON_IsTrue(cJSON_GetArrayItem(a, 2)));
+    TEST_ASSERT_TRUE(cJSON_IsNull(cJSON_GetArrayItem(a, 3)));
+
+    cJSON *c = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "b"), "c");
+    TEST_ASSERT_EQUAL_STRING("d", c->valuestring);
+    TEST_ASSERT_TRUE(c->type & cJSON_IsReference); // string lives in the parsed buffer
+    release();
+}
+
+TEST_CASE("parser rejects truncated input", "[json_parser]")
+{
+    const char *text = "{\"a\":[1,{\"b\":\"c\\u0041\\n\"}],\"d\":true,\"e\":null}";
+
+    TEST_ASSERT_NOT_NULL(parse(text, strlen(text)));
+    release();
+
+    for (size_t len = 0; len < strlen(text); len++) {
+        TEST_ASSERT_NULL(parse(text, len));
+        release();
+    }
+}
@@ -0,0 +1,147 @@
+#include <string.h>
+#include "unity.h"
+#include "discord/private/_json_splitter.h"
+
+#define ELEMENTS_MAX (4)
+
+typedef struct
+{
+    char rest[512];
+    size_t rest_len;
+    char elements[ELEMENTS_MAX][128];
+    int elements_len;
+} collected_t;
+
+static collected_t collected;
+
+static esp_err_t write_cb(void *arg, const char *data, size_t len)
+{
+    collected_t *c = (collected_t *)arg;
+
+    TEST_ASSERT_LESS_THAN(sizeof(c->rest), c->rest_len + len);
+    memcpy(c->rest + c->rest_len, data, len);
+    c->rest_len += len;
+    c->rest[c->rest_len] = '\0';
+
+    return ESP_OK;
+}
+
+static void element_cb(void *arg, char *element, size_t len)
+{
+    collected_t *c = (collected_t *)arg;
+
+    TEST_ASSERT_LESS_THAN(ELEMENTS_MAX, c->elements_len);
+    TEST_ASSERT_EQUAL(strlen(element), len);
+    strcpy(c->elements[c->elements_len++], element);
+}
+
+/**
+ * @brief Split message fed in chunks of given size
+ */
+static void split(discord_json_splitter_handle_t splitter, const char *message, size_t chunk_size)
+{
+    memset(&collected, 0, sizeof(collected));
+    discord_json_splitter_reset(splitter);
+
+    for (size_t i = 0; i < strlen(message); i += chunk_size) {
+        size_t len = strlen(message) - i < chunk_size ? strlen(message) - i : chunk_size;
+        TEST_ASSERT_EQUAL(ESP_OK, discord_json_splitter_write(splitter, message + i, len));
+    }
+}
+
+static discord_json_splitter_handle_t create(const char *event, const char *key, size_t element_size)
+{
+    discord_json_splitter_config_t config = {
+        .event = event,
+        .key = key,
+        .element_size = element_size,
+        .write_cb = write_cb,
+        .element_cb = element_cb,
+        .arg = &collected,
+    };
+
+    discord_json_splitter_handle_t splitter = discord_json_splitter_create(&config);
+    TEST_ASSERT_NOT_NULL(splitter);
+
+    return splitter;
+}
+
+TEST_CASE("splitter cuts members out of chunk at any chunk boundary", "[json_splitter]")
+{
+    const char *message = "{\"t\":\"GUILD_MEMBERS_CHUNK\",\"op\":0,\"d\":{\"guild_id\":\"1\","
+                          "\"members\":[{\"user\":{\"id\":\"2\"},\"nick\":\"]}\\\"\"},{\"roles\":[\"3\"]}],"
+                          "\"chunk_index\":0,\"nonce\":\"7\"}}";
+    discord_json_splitter_handle_t splitter = create("GUILD_MEMBERS_CHUNK", "members", 64);
+
+    for (size_t chunk_size = 1; chunk_size <= strlen(message); chunk_size++) {
+        split(splitter, message, chunk_size);
+
+        TEST_ASSERT_EQUAL(2, collected.elements_len);
+        TEST_ASSERT_EQUAL_STRING("{\"user\":{\"id\":\"2\"},\"nick\":\"]}\\\"\"}", collected.elements[0]);
+        TEST_ASSERT_EQUAL_STRING("{\"roles\":[\"3\"]}", collected.elements[1]);
+        TEST_ASSERT_EQUAL_STRING("{\"t\":\"GUILD_MEMBERS_CHUNK\",\"op\":0,\"d\":{\"guild_id\":\"1\","
+                                 "\"members\":[],\"chunk_index\":0,\"nonce\":\"7\"}}",
+            collected.rest);
+    }
+
+    discord_json_splitter_free(splitter);
+}
+
+TEST_CASE("splitter passes other events through", "[json_splitter]")
+{
+    const char *message = "{\"t\":\"MESSAGE_CREATE\",\"d\":{\"members\":[{\"id\":\"1\"}]}}";
+    discord_json_splitter_handle_t splitter = create("GUILD_MEMBERS_CHUNK", "members", 64);
+
+    split(splitter, message, 5);
+
+    TEST_ASSERT_EQUAL(0, collected.elements_len);
+    TEST_ASSERT_EQUAL_STRING(message, collected.rest);
+
+    discord_json_splitter_free(splitter);
+}
+
+TEST_CASE("splitter splits root array", "[json_splitter]")
+{
+    const char *message = " [ {\"id\":\"1\",\"name\":\"[x]\"} , {\"id\":\"2\",\"tags\":[{\"a\":\"}\"}]} ] ";
+    discord_json_splitter_handle_t splitter = create(NULL, NULL, 64);
+
+    for (size_t chunk_size = 1; chunk_size <= strlen(message); chunk_size++) {
+        split(splitter, message, chunk_size);
+
+        TEST_ASSERT_EQUAL(2, collected.elements_len);
+        TEST_ASSERT_EQUAL_STRING("{\"id\":\"1\",\"name\":\"[x]\"}", collected.elements[0]);
+        TEST_ASSERT_EQUAL_STRING("{\"id\":\"2\",\"tags\":[{\"a\":\"}\"}]}", collected.elements[1]);
+        TEST_ASSERT_EQUAL(0, discord_json_splitter_dropped(splitter));
+    }
+
+    discord_json_splitter_free(splitter);
+}
+
+TEST_CASE("splitter drops and counts element bigger than element size", "[json_splitter]")
+{
+    const char *message = "[{\"id\":\"1\"},{\"id\":\"2\",\"name\":\"too long to fit\"},{\"id\":\"3\"}]";
+    discord_json_splitter_handle_t splitter = create(NULL, NULL, 16);
+
+    split(splitter, message, 3);
+
+    TEST_ASSERT_EQUAL(2, collected.elements_len);
+    TEST_ASSERT_EQUAL_STRING("{\"id\":\"1\"}", collected.elements[0]);
+    TEST_ASSERT_EQUAL_STRING("{\"id\":\"3\"}", collected.elements[1]);
+    TEST_ASSERT_EQUAL(1, discord_json_splitter_dropped(splitter));
+
+    discord_json_splitter_reset(splitter);
+    TEST_ASSERT_EQUAL(0, discord_json_splitter_dropped(splitter));
+
+    discord_json_splitter_free(splitter);
+}
+
+TEST_CASE("splitter requires both event and key or none", "[json_splitter]")
+{
+    discord_json_splitter_config_t config = {
+        .event = "GUILD_MEMBERS_CHUNK",
+        .element_size = 64,
+        .element_cb = element_cb,
+    };
+
+    TEST_ASSERT_NULL(discord_json_splitter_create(&config));
+}
@@ -0,0 +1,113 @@
+#include <limits.h>
+#include <string.h>
+#include "unity.h"
+#include "discord/private/_json_writer.h"
+#include "discord/private/_discord.h"
+
+TEST_CASE("writer escapes strings", "[json_writer]")
+{
+    char buf[64];
+    discord_json_writer_t writer;
+
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+    discord_json_writer_string(&writer, "a\"b\\c\nd\re\tf\x01");
+    discord_json_writer_raw(&writer, ",");
+    discord_json_writer_string(&writer, NULL);
+
+    TEST_ASSERT_EQUAL(ESP_OK, discord_json_writer_end(&writer));
+    TEST_ASSERT_EQUAL_STRING("\"a\\\"b\\\\c\\nd\\re\\tf\\u0001\",null", buf);
+}
+
+TEST_CASE("writer writes integers and booleans", "[json_writer]")
+{
+    char buf[64];
+    discord_json_writer_t writer;
+
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+    discord_json_writer_int(&writer, INT_MIN);
+    discord_json_writer_raw(&writer, ",");
+    discord_json_writer_int(&writer, 0);
+    discord_json_writer_raw(&writer, ",");
+    discord_json_writer_int(&writer, INT_MAX);
+    discord_json_writer_raw(&writer, ",");
+    discord_json_writer_bool(&writer, true);
+
+    TEST_ASSERT_EQUAL(ESP_OK, discord_json_writer_end(&writer));
+    TEST_ASSERT_EQUAL_STRING("-2147483648,0,2147483647,true", buf);
+}
+
+TEST_CASE("writer fills buffer exactly", "[json_writer]")
+{
+    char buf[11];
+    discord_json_writer_t writer;
+
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+    discord_json_writer_raw(&writer, "0123456789");
+
+    TEST_ASSERT_EQUAL(ESP_OK, discord_json_writer_end(&writer));
+    TEST_ASSERT_EQUAL_STRING("0123456789", buf);
+}
+
+TEST_CASE("writer reports overflow and keeps counting", "[json_writer]")
+{
+    char buf[8];
+    discord_json_writer_t writer;
+
+    memset(buf, 'x', sizeof(buf));
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+    discord_json_writer_raw(&writer, "0123");
+    discord_json_writer_string(&writer, "4567");
+    discord_json_writer_int(&writer, 89);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, discord_json_writer_end(&writer));
+    TEST_ASSERT_EQUAL(12, writer.len);
+    TEST_ASSERT_EQUAL_STRING("", buf); // truncated JSON is never left behind
+}
+
+TEST_CASE("writer measures output without buffer", "[json_writer]")
+{
+    discord_json_writer_t writer;
+    discord_heartbeat_t seq = 251;
+    discord_payload_t payload = { .op = DISCORD_OP_HEARTBEAT, .d = &seq };
+
+    discord_json_writer_init(&writer, NULL, 0);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, discord_json_write_payload(&writer, &payload));
+    TEST_ASSERT_EQUAL(strlen("{\"op\":1,\"d\":251}"), writer.len);
+}
+
+TEST_CASE("writer writes heartbeat", "[json_writer]")
+{
+    char buf[32];
+    discord_json_writer_t writer;
+    discord_heartbeat_t seq = 251;
+    discord_payload_t payload = { .op = DISCORD_OP_HEARTBEAT, .d = &seq };
+
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+
+    TEST_ASSERT_EQUAL(ESP_OK, discord_json_write_payload(&writer, &payload));
+    TEST_ASSERT_EQUAL_STRING("{\"op\":1,\"d\":251}", buf);
+}
+
+TEST_CASE("writer writes request guild members", "[json_writer]")
+{
+    char buf[128];
+    discord_json_writer_t writer;
+    char *user_ids[] = { "1", "2" };
+    discord_member_request_t request = { .guild_id = "10", .query = "ab\"c", .limit = 5 };
+    discord_request_guild_members_t request_guild_members = { .request = &request, .nonce = "7" };
+    discord_payload_t payload = { .op = DISCORD_OP_REQUEST_GUILD_MEMBERS, .d = &request_guild_members };
+
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+
+    TEST_ASSERT_EQUAL(ESP_OK, discord_json_write_payload(&writer, &payload));
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"op\":8,\"d\":{\"guild_id\":\"10\",\"query\":\"ab\\\"c\",\"limit\":5,\"nonce\":\"7\"}}", buf);
+
+    request.user_ids = user_ids;
+    request._user_ids_len = 2;
+    discord_json_writer_init(&writer, buf, sizeof(buf));
+
+    TEST_ASSERT_EQUAL(ESP_OK, discord_json_write_payload(&writer, &payload));
+    TEST_ASSERT_EQUAL_STRING("{\"op\":8,\"d\":{\"guild_id\":\"10\",\"user_ids\":[\"1\",\"2\"],\"nonce\":\"7\"}}", buf);
+}
@@ -0,0 +1,111 @@
+#include <string.h>
+#include "unity.h"
+#include "esp_http_client.h"
+#include "discord/private/_ratelimit.h"
+
+static uint32_t route(int method, const char *uri, uint32_t *major)
+{
+    uint32_t route = discord_ratelimit_route(method, uri, major);
+    TEST_ASSERT_NOT_EQUAL(0, route);
+
+    return route;
+}
+
+TEST_CASE("rate limit route folds ids except major parameter", "[ratelimit]")
+{
+    uint32_t major_a, major_b, major_c;
+
+    uint32_t a = route(HTTP_METHOD_GET, "/channels/100/messages/1", &major_a);
+    uint32_t b = route(HTTP_METHOD_GET, "/channels/100/messages/2", &major_b);
+    uint32_t c = route(HTTP_METHOD_GET, "/channels/200/messages/1", &major_c);
+
+    TEST_ASSERT_EQUAL(a, b);
+    TEST_ASSERT_EQUAL(major_a, major_b);
+    TEST_ASSERT_NOT_EQUAL(a, c);
+    TEST_ASSERT_NOT_EQUAL(major_a, major_c);
+    TEST_ASSERT_NOT_EQUAL(0, major_a);
+}
+
+TEST_CASE("rate limit route recognizes every major parameter", "[ratelimit]")
+{
+    const char *uris[] = { "/channels/1/messages", "/guilds/1/roles", "/webhooks/1/token" };
+
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        uint32_t major = 0;
+        route(HTTP_METHOD_GET, uris[i], &major);
+        TEST_ASSERT_NOT_EQUAL_MESSAGE(0, major, uris[i]);
+    }
+
+    uint32_t major = 1;
+    route(HTTP_METHOD_GET, "/users/@me/guilds", &major);
+    TEST_ASSERT_EQUAL(0, major);
+}
+
+TEST_CASE("rate limit route depends on method but not on query", "[ratelimit]")
+{
+    TEST_ASSERT_NOT_EQUAL(route(HTTP_METHOD_GET, "/channels/1/messages/2", NULL),
+        route(HTTP_METHOD_DELETE, "/channels/1/messages/2", NULL));
+    TEST_ASSERT_EQUAL(route(HTTP_METHOD_GET, "/guilds/1/members?limit=5", NULL),
+        route(HTTP_METHOD_GET, "/guilds/1/members", NULL));
+}
+
+TEST_CASE("rate limit route folds emoji of reaction", "[ratelimit]")
+{
+    TEST_ASSERT_EQUAL(route(HTTP_METHOD_PUT, "/channels/1/messages/2/reactions/%F0%9F%91%8D/@me", NULL),
+        route(HTTP_METHOD_PUT, "/channels/1/messages/3/reactions/name:123/@me", NULL));
+}
+
+TEST_CASE("rate limit delays exhausted bucket until reset", "[ratelimit]")
+{
+    discord_ratelimit_t ratelimit;
+    discord_ratelimit_headers_t headers;
+    uint32_t major;
+    uint32_t r = route(HTTP_METHOD_POST, "/channels/1/messages", &major);
+
+    memset(&ratelimit, 0, sizeof(ratelimit));
+    discord_ratelimit_headers_reset(&headers);
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Bucket", "abc");
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Remaining", "0");
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Reset-After", "1.5");
+
+    TEST_ASSERT_EQUAL(0, discord_ratelimit_acquire(&ratelimit, r, 1000));
+    TEST_ASSERT_EQUAL(0, discord_ratelimit_update(&ratelimit, r, major, &headers, 200, 1000));
+    TEST_ASSERT_EQUAL(1500, discord_ratelimit_acquire(&ratelimit, r, 1000));
+    TEST_ASSERT_EQUAL(0, discord_ratelimit_acquire(&ratelimit, r, 2500));
+}
+
+TEST_CASE("rate limit global 429 delays every route", "[ratelimit]")
+{
+    discord_ratelimit_t ratelimit;
+    discord_ratelimit_headers_t headers;
+    uint32_t r = route(HTTP_METHOD_GET, "/guilds/1/roles", NULL);
+
+    memset(&ratelimit, 0, sizeof(ratelimit));
+    discord_ratelimit_headers_reset(&headers);
+    discord_ratelimit_headers_set(&headers, "Retry-After", "0.25");
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Global", "true");
+
+    TEST_ASSERT_EQUAL(250, discord_ratelimit_update(&ratelimit, r, 0, &headers, 429, 1000));
+    TEST_ASSERT_EQUAL(250, discord_ratelimit_acquire(&ratelimit, route(HTTP_METHOD_GET, "/users/@me", NULL), 1000));
+}
+
+TEST_CASE("rate limit keeps working after 49 days of uptime", "[ratelimit]")
+{
+    discord_ratelimit_t ratelimit;
+    discord_ratelimit_headers_t headers;
+    uint32_t major;
+    uint32_t r = route(HTTP_METHOD_POST, "/channels/1/messages", &major);
+    uint64_t now = (uint64_t)UINT32_MAX - 500; // reset falls behind the point where 32 bit milliseconds wrap
+
+    memset(&ratelimit, 0, sizeof(ratelimit));
+    discord_ratelimit_headers_reset(&headers);
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Bucket", "abc");
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Remaining", "0");
+    discord_ratelimit_headers_set(&headers, "X-RateLimit-Reset-After", "1");
+
+    TEST_ASSERT_EQUAL(0, discord_ratelimit_acquire(&ratelimit, r, now));
+    TEST_ASSERT_EQUAL(0, discord_ratelimit_update(&ratelimit, r, major, &headers, 200, now));
+    TEST_ASSERT_EQUAL(1000, discord_ratelimit_acquire(&ratelimit, r, now));
+    TEST_ASSERT_EQUAL(400, discord_ratelimit_acquire(&ratelimit, r, now + 600));
+    TEST_ASSERT_EQUAL(0, discord_ratelimit_acquire(&ratelimit, r, now + 1000));
+}